@@ -0,0 +1,128 @@
+//steps the same mixed pile of bodies with different thread counts, and again with the same count, and checks the world ends up
+//in exactly the same state every time. returns 1 (and prints the first step the hashes went different on) if it doesn't
+//
+//usage:
+//	DeterminismTest [steps]			(steps defaults to 2000, which takes about half a minute. run it with 10000 for the full check)
+//
+//fizix has to be built with FZX_DETERMINISTIC as well as this, or the runs are only guaranteed to match on the same machine.
+//on linux, from this folder:
+//	g++ -std=c++20 -O2 -DFZX_DETERMINISTIC -I../glm -I../fizix DeterminismTest.cpp ../fizix/*.cpp -o DeterminismTest -lpthread
+
+#include "fzx.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace fzx;
+
+//the state is hashed this often, so a mismatch says roughly when the runs went different
+constexpr int CHECK_INTERVAL = 500;
+
+struct Run
+{
+	unsigned int threads;
+	std::vector<unsigned long long> hashes;
+};
+
+static PhysicsObject* AddBody(PhysicsSystem& system, Vector2 position, Real rotation, bool isDynamic, Shape* shape, bool isKinematic = false)
+{
+	PhysicsData data(position, rotation, isDynamic);
+	data.isKinematic = isKinematic;
+	PhysicsObject* body = system.CreatePhysicsObject(data);
+	body->AddCollider(shape);
+	return body;
+}
+
+static PolygonShape* Box(Real halfWidth, Real halfHeight)
+{
+	Vector2 points[4] = { { -halfWidth, -halfHeight }, { halfWidth, -halfHeight }, { halfWidth, halfHeight }, { -halfWidth, halfHeight } };
+	return PolygonShape::Create(points, 4);
+}
+
+//a floor and walls, a kinematic platform sweeping through the pile so it never all falls asleep,
+//a hanging chain, and a pile of circles, boxes, triangles, hexagons and capsules dropped on top of each other
+static void RunPile(Run& run, int steps)
+{
+	PhysicsSystem system((Real)1 / 60, Vector2(0, -FZX_DEFAULT_GRAVITY), 4);
+	system.SetThreadCount(run.threads);
+
+	AddBody(system, Vector2(0, 0), 0, false, new PlaneShape(Vector2(0, 1), 0));
+	AddBody(system, Vector2(-20, 10), 0, false, Box(0.5f, 10));
+	AddBody(system, Vector2(20, 10), 0, false, Box(0.5f, 10));
+	PhysicsObject* platform = AddBody(system, Vector2(-15, 2), 0, true, Box(3, 0.25f), true);
+
+	PhysicsObject* previous = AddBody(system, Vector2(0, 30), 0, false, Box(0.5f, 0.5f));
+	for (int i = 1; i <= 8; i++)
+	{
+		PhysicsObject* link = AddBody(system, Vector2((Real)i * 0.8f, 30), 0, true, Box(0.4f, 0.1f));
+		system.CreateJoint(JointDesc(JOINT_TYPE::REVOLUTE, previous, link, Vector2((Real)i * 0.8f - 0.4f, 30)));
+		previous = link;
+	}
+
+	for (int i = 0; i < 300; i++)
+	{
+		Vector2 position((Real)(i % 25) * 1.4f - 17, 4 + (Real)(i / 25) * 1.4f);
+		Real rotation = (Real)(i % 7) * 0.3f;
+		Shape* shape;
+		switch (i % 5)
+		{
+		case 0: shape = new CircleShape(0.5f, Vector2(0, 0)); break;
+		case 1: shape = Box(0.5f, 0.4f); break;
+		case 2: shape = PolygonShape::GetRegularPolygonCollider(0.6f, 3); break;
+		case 3: shape = PolygonShape::GetRegularPolygonCollider(0.55f, 6); break;
+		default: shape = new CapsuleShape(Vector2(-0.4f, 0), Vector2(0.4f, 0), 0.25f); break;
+		}
+		AddBody(system, position, rotation, true, shape);
+	}
+
+	for (int step = 1; step <= steps; step++)
+	{
+		//back and forth across the bottom of the pile
+		platform->SetVelocity(Vector2((step / 600) % 2 == 0 ? 5 : -5, 0));
+		system.Update();
+		if (step % CHECK_INTERVAL == 0 || step == steps)
+			run.hashes.push_back(system.HashState());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int steps = argc > 1 ? atoi(argv[1]) : 2000;
+	if (steps < 1)
+	{
+		fprintf(stderr, "usage: DeterminismTest [steps]\n");
+		return 1;
+	}
+
+#ifndef FZX_DETERMINISTIC
+	printf("FZX_DETERMINISTIC isn't defined, so this only checks that runs on this machine match\n");
+#endif
+
+	//the first run is the reference, the last one repeats it to catch anything left over between runs
+	std::vector<Run> runs = { { 1, {} }, { 2, {} }, { 4, {} }, { 1, {} } };
+	for (auto& run : runs)
+	{
+		RunPile(run, steps);
+		printf("%u thread%s: %016llx\n", run.threads, run.threads == 1 ? "" : "s", run.hashes.back());
+	}
+
+	int failures = 0;
+	for (size_t i = 1; i < runs.size(); i++)
+	{
+		for (size_t h = 0; h < runs[0].hashes.size(); h++)
+		{
+			if (runs[i].hashes[h] != runs[0].hashes[h])
+			{
+				int step = h + 1 == runs[0].hashes.size() ? steps : (int)(h + 1) * CHECK_INTERVAL;
+				fprintf(stderr, "run %zu (%u threads) went different from the first run by step %d\n", i + 1, runs[i].threads, step);
+				failures++;
+				break;
+			}
+		}
+	}
+
+	if (failures)
+		return 1;
+	printf("every run matches after %d steps\n", steps);
+	return 0;
+}
@@ -0,0 +1,104 @@
+//encodes a settling pile of bodies with StateEncoder every frame and decodes it into a copy of the world, then prints
+//how many bytes each frame took and how fast encoding and decoding went. there's no networking, so this only needs fizix
+//
+//usage:
+//	EncoderBench [bodies] [frames]		(bodies defaults to 2000, frames to 600)
+//
+//on linux, from this folder:
+//	g++ -std=c++20 -O2 -I../glm -I../fizix EncoderBench.cpp ../fizix/*.cpp -o EncoderBench -lpthread
+
+#include "fzx.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace fzx;
+
+constexpr unsigned int TICK_RATE = 60;
+
+static void BuildPile(PhysicsSystem& system, int bodyCount)
+{
+	int columns = (int)std::sqrt((Real)bodyCount) + 1;
+	PhysicsData wall(Vector2(0, 0), 0, false);
+	system.CreatePhysicsObject(wall)->AddCollider(new PlaneShape(Vector2(0, 1), 0));
+	system.CreatePhysicsObject(wall)->AddCollider(new PlaneShape(Vector2(1, 0), -1));
+	system.CreatePhysicsObject(wall)->AddCollider(new PlaneShape(Vector2(-1, 0), -columns * 1.2f - 1));
+
+	for (int i = 0; i < bodyCount; i++)
+	{
+		PhysicsData data(Vector2((i % columns) * 1.2f + 0.1f * (i % 3), 1 + (i / columns) * 1.2f), 0.1f * i);
+		PhysicsObject* body = system.CreatePhysicsObject(data);
+		if (i % 2)
+			body->AddCollider(new CircleShape(0.5f, Vector2(0, 0)));
+		else
+			body->AddCollider(PolygonShape::GetRegularPolygonCollider(0.55f, 3 + i % 5));
+	}
+}
+
+//encodes a settling pile every frame and decodes it into a copy of the world, acknowledging each frame straight away
+static int RunBenchmark(int bodyCount, int frames)
+{
+	PhysicsSystem server((Real)1 / TICK_RATE, Vector2(0, -9.8f), 2);
+	PhysicsSystem client((Real)1 / TICK_RATE, Vector2(0, -9.8f), 2);
+	BuildPile(server, bodyCount);
+	BuildPile(client, bodyCount);
+
+	StateEncoder encoder;
+	StateDecoder decoder;
+	std::vector<unsigned char> data;
+	std::vector<unsigned char> snapshot;
+	double encodeSeconds = 0;
+	double decodeSeconds = 0;
+	size_t deltaBytes = 0;
+	size_t fullBytes = 0;
+
+	for (int frame = 0; frame < frames; frame++)
+	{
+		server.Update();
+
+		auto start = std::chrono::steady_clock::now();
+		encoder.Encode(server, frame, data);
+		auto encoded = std::chrono::steady_clock::now();
+		bool decoded = decoder.Decode(data.data(), data.size());
+		decoder.Apply(client);
+		auto end = std::chrono::steady_clock::now();
+
+		if (!decoded)
+		{
+			fprintf(stderr, "frame %d didn't decode\n", frame);
+			return 1;
+		}
+		encoder.Acknowledge(decoder.GetFrame());
+
+		encodeSeconds += std::chrono::duration<double>(encoded - start).count();
+		decodeSeconds += std::chrono::duration<double>(end - encoded).count();
+		if (frame == 0)
+			fullBytes = data.size();
+		else
+			deltaBytes += data.size();
+	}
+	server.SaveSnapshot(snapshot);
+
+	size_t bodies = (size_t)bodyCount + 3;
+	double bodyFrames = (double)bodies * frames;
+	printf("%zu bodies, %d frames\n", bodies, frames);
+	printf("bytes per frame: %zu full, %.1f delta, %zu as raw floats, %zu as a snapshot\n", fullBytes, frames > 1 ? deltaBytes / (double)(frames - 1) : 0.0,
+		bodies * 6 * sizeof(float), snapshot.size());
+	printf("encode: %.1f ns per body, %.2f M bodies/s\n", encodeSeconds * 1e9 / bodyFrames, bodyFrames / encodeSeconds / 1e6);
+	printf("decode + apply: %.1f ns per body, %.2f M bodies/s\n", decodeSeconds * 1e9 / bodyFrames, bodyFrames / decodeSeconds / 1e6);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int bodyCount = argc > 1 ? atoi(argv[1]) : 2000;
+	int frames = argc > 2 ? atoi(argv[2]) : 600;
+	if (bodyCount < 1 || frames < 1)
+	{
+		fprintf(stderr, "usage: EncoderBench [bodies] [frames] (at least one of each)\n");
+		return 1;
+	}
+	return RunBenchmark(bodyCount, frames);
+}
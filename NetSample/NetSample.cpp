@@ -0,0 +1,572 @@
+//headless rollback netcode sample using enet
+//the server runs the authoritative world and sends its state every few ticks. clients run ahead of the server, predicting with their own input,
+//and when the server's state for a tick doesn't match what they predicted they restore it and resimulate back up to the present
+//
+//usage:
+//	NetSample server [port] [seconds]
+//	NetSample client [host] [port] [seconds]
+//	NetSample local [clients] [seconds]		(server and clients in one process, talking over localhost)
+//seconds defaults to 30, 0 runs until killed. each side prints its bandwidth and rollback cost when it finishes
+//(StateEncoder throughput and size are measured by EncoderBench, which doesn't need enet)
+//
+//on linux, with enet from the package manager (libenet-dev), from this folder:
+//	g++ -std=c++20 -O2 -I../glm -I../fizix NetSample.cpp ../fizix/*.cpp -lenet -o NetSample
+//both ends need to be the same build, because snapshots use the build's memory layout
+//(compile fizix and this with -DFZX_DETERMINISTIC if the server and clients are on different platforms)
+
+#include <enet/enet.h>
+#include "fzx.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace fzx;
+
+constexpr unsigned int TICK_RATE = 60;
+//how often the server sends its state, in ticks
+constexpr unsigned int STATE_INTERVAL = 3;
+constexpr unsigned short DEFAULT_PORT = 7777;
+constexpr int MAX_PLAYERS = 4;
+//every input packet carries this many of the newest inputs, so a few lost packets don't matter
+constexpr int INPUT_REDUNDANCY = 8;
+//ticks of input and hashes kept by clients. states older than this can't be checked and are ignored
+constexpr unsigned int HISTORY = 128;
+//clients stay a round trip ahead of the last state they got (it's half a trip old when it arrives, and their input takes another half to get back)
+//plus this many ticks of slack
+constexpr unsigned int INPUT_LEAD = 2;
+
+enum INPUT_BITS : unsigned char
+{
+	INPUT_LEFT = 1,
+	INPUT_RIGHT = 2,
+	INPUT_JUMP = 4
+};
+
+enum class PACKET_TYPE : unsigned char
+{
+	WELCOME,
+	INPUT,
+	STATE
+};
+
+//both ends are the same build, so packets are just copied structs
+struct WelcomePacket
+{
+	PACKET_TYPE type;
+	unsigned char player;
+};
+
+struct InputPacket
+{
+	PACKET_TYPE type;
+	unsigned char count;
+	//tick of inputs[0], inputs[i] is for tick - i
+	unsigned int tick;
+	unsigned char inputs[INPUT_REDUNDANCY];
+};
+
+//followed by the snapshot
+struct StatePacket
+{
+	PACKET_TYPE type;
+	//inputs the server used for each player on the step before tick, clients repeat these to predict everyone else
+	unsigned char inputs[MAX_PLAYERS];
+	unsigned int tick;
+	unsigned long long hash;
+};
+
+//the same world is built on the server and every client, so the bodies have the same ids and restoring a snapshot keeps the player pointers
+struct World
+{
+	PhysicsSystem system;
+	PhysicsObject* players[MAX_PLAYERS];
+
+	World() : system((Real)1 / TICK_RATE, Vector2(0, -9.8f), 2)
+	{
+		PhysicsData wall(Vector2(0, 0), 0, false);
+		system.CreatePhysicsObject(wall)->AddCollider(new PlaneShape(Vector2(0, 1), -10));
+		system.CreatePhysicsObject(wall)->AddCollider(new PlaneShape(Vector2(1, 0), -20));
+		system.CreatePhysicsObject(wall)->AddCollider(new PlaneShape(Vector2(-1, 0), -20));
+
+		for (int i = 0; i < MAX_PLAYERS; i++)
+		{
+			PhysicsData data(Vector2(-12 + i * 8.0f, -8), 0, true, false);
+			players[i] = system.CreatePhysicsObject(data);
+			players[i]->AddCollider(new CapsuleShape(Vector2(0, -0.5f), Vector2(0, 0.5f), 0.5f));
+		}
+
+		//some loose things for the players to push around
+		for (int i = 0; i < 24; i++)
+		{
+			PhysicsData data(Vector2(-15 + (i % 8) * 4.0f, -4 + (i / 8) * 2.5f), 0.3f * i);
+			PhysicsObject* body = system.CreatePhysicsObject(data);
+			if (i % 2)
+				body->AddCollider(new CircleShape(0.7f, Vector2(0, 0)), 0.5f);
+			else
+				body->AddCollider(PolygonShape::GetRegularPolygonCollider(0.8f, 3 + i % 4), 0.5f);
+		}
+	}
+
+	void ApplyInput(int player, unsigned char input)
+	{
+		Real move = (Real)((input & INPUT_RIGHT ? 1 : 0) - (input & INPUT_LEFT ? 1 : 0));
+		players[player]->AddVelocity(Vector2(move * 0.6f, input & INPUT_JUMP ? 0.5f : 0));
+	}
+};
+
+//stand in for a person, changes what it's holding every half second or so
+static unsigned char ScriptedInput(int player, unsigned int tick)
+{
+	unsigned int seed = (tick / 29 + 1) * 2654435761u ^ (player + 1) * 40503u;
+	seed ^= seed >> 13;
+	seed *= 0x5bd1e995;
+	seed ^= seed >> 15;
+	unsigned char input = seed % 3 == 0 ? INPUT_LEFT : seed % 3 == 1 ? INPUT_RIGHT : 0;
+	if (seed % 16 == 0 && tick % 29 < 6)
+		input |= INPUT_JUMP;
+	return input;
+}
+
+//number of ticks that should have happened since start
+static unsigned int TicksSince(enet_uint32 start)
+{
+	return (unsigned int)((unsigned long long)(enet_time_get() - start) * TICK_RATE / 1000);
+}
+
+class Server
+{
+public:
+	bool Start(unsigned short port)
+	{
+		ENetAddress address;
+		address.host = ENET_HOST_ANY;
+		address.port = port;
+		host = enet_host_create(&address, MAX_PLAYERS, 2, 0, 0);
+		if (!host)
+			return false;
+		startTime = enet_time_get();
+		return true;
+	}
+
+	void Update(enet_uint32 timeout)
+	{
+		ENetEvent event;
+		while (enet_host_service(host, &event, timeout) > 0)
+		{
+			timeout = 0;
+			switch (event.type)
+			{
+			case ENET_EVENT_TYPE_CONNECT:
+				Connect(event.peer);
+				break;
+			case ENET_EVENT_TYPE_RECEIVE:
+				Receive(event.peer, event.packet);
+				enet_packet_destroy(event.packet);
+				break;
+			case ENET_EVENT_TYPE_DISCONNECT:
+				if (event.peer->data)
+				{
+					slots[(size_t)event.peer->data - 1].peer = nullptr;
+					event.peer->data = nullptr;
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		unsigned int due = TicksSince(startTime);
+		while (tick < due)
+			Tick();
+		enet_host_flush(host);
+	}
+
+	void Report(double seconds)
+	{
+		printf("server: %u ticks, %u states sent, %u inputs missed, %.1f kB/s up, %.1f kB/s down\n", tick, statesSent, missedInputs,
+			host->totalSentData / seconds / 1024, host->totalReceivedData / seconds / 1024);
+	}
+
+	~Server()
+	{
+		if (host)
+			enet_host_destroy(host);
+	}
+
+private:
+	struct Slot
+	{
+		ENetPeer* peer = nullptr;
+		unsigned char inputs[HISTORY] = {};
+		unsigned int inputTicks[HISTORY] = {};
+		unsigned char lastInput = 0;
+	};
+
+	void Connect(ENetPeer* peer)
+	{
+		for (int i = 0; i < MAX_PLAYERS; i++)
+		{
+			if (slots[i].peer)
+				continue;
+
+			slots[i] = Slot();
+			slots[i].peer = peer;
+			peer->data = (void*)(size_t)(i + 1);
+
+			WelcomePacket welcome = { PACKET_TYPE::WELCOME, (unsigned char)i };
+			enet_peer_send(peer, 0, enet_packet_create(&welcome, sizeof(welcome), ENET_PACKET_FLAG_RELIABLE));
+			return;
+		}
+		enet_peer_disconnect(peer, 0);
+	}
+
+	void Receive(ENetPeer* peer, ENetPacket* packet)
+	{
+		InputPacket input;
+		if (!peer->data || packet->dataLength != sizeof(input))
+			return;
+		memcpy(&input, packet->data, sizeof(input));
+		if (input.type != PACKET_TYPE::INPUT)
+			return;
+
+		Slot& slot = slots[(size_t)peer->data - 1];
+		for (int i = 0; i < input.count && i < INPUT_REDUNDANCY; i++)
+		{
+			unsigned int t = input.tick - i;
+			//only keep inputs for ticks that haven't been simulated yet and fit in the buffer
+			if (t < tick || t >= tick + HISTORY)
+				continue;
+			slot.inputs[t % HISTORY] = input.inputs[i];
+			slot.inputTicks[t % HISTORY] = t;
+		}
+	}
+
+	void Tick()
+	{
+		unsigned char used[MAX_PLAYERS] = {};
+		for (int i = 0; i < MAX_PLAYERS; i++)
+		{
+			Slot& slot = slots[i];
+			if (!slot.peer)
+				continue;
+
+			//if the input didn't arrive in time keep doing what they were doing, which the client will have to correct
+			if (slot.inputTicks[tick % HISTORY] == tick)
+				slot.lastInput = slot.inputs[tick % HISTORY];
+			else
+				missedInputs++;
+			used[i] = slot.lastInput;
+			world.ApplyInput(i, used[i]);
+		}
+		world.system.Update();
+		tick++;
+
+		if (tick % STATE_INTERVAL)
+			return;
+
+		world.system.SaveSnapshot(snapshot);
+		StatePacket state;
+		state.type = PACKET_TYPE::STATE;
+		memcpy(state.inputs, used, sizeof(used));
+		state.tick = tick;
+		state.hash = world.system.HashState();
+
+		//states are unreliable, a newer one will be along soon
+		ENetPacket* packet = enet_packet_create(nullptr, sizeof(state) + snapshot.size(), 0);
+		memcpy(packet->data, &state, sizeof(state));
+		memcpy(packet->data + sizeof(state), snapshot.data(), snapshot.size());
+		enet_host_broadcast(host, 1, packet);
+		statesSent++;
+	}
+
+	ENetHost* host = nullptr;
+	World world;
+	Slot slots[MAX_PLAYERS];
+	std::vector<unsigned char> snapshot;
+	unsigned int tick = 0;
+	enet_uint32 startTime = 0;
+	unsigned int statesSent = 0;
+	unsigned int missedInputs = 0;
+};
+
+class Client
+{
+public:
+	bool Start(const char* hostName, unsigned short port)
+	{
+		host = enet_host_create(nullptr, 1, 2, 0, 0);
+		if (!host)
+			return false;
+
+		ENetAddress address;
+		if (enet_address_set_host(&address, hostName) != 0)
+			return false;
+		address.port = port;
+		server = enet_host_connect(host, &address, 2, 0);
+		return server != nullptr;
+	}
+
+	void Update(enet_uint32 timeout)
+	{
+		ENetEvent event;
+		while (enet_host_service(host, &event, timeout) > 0)
+		{
+			timeout = 0;
+			if (event.type == ENET_EVENT_TYPE_RECEIVE)
+			{
+				Receive(event.packet);
+				enet_packet_destroy(event.packet);
+			}
+			else if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+			{
+				server = nullptr;
+			}
+		}
+
+		if (!synced)
+			return;
+
+		unsigned int due = startTick + TicksSince(startTime);
+		while (tick < due)
+		{
+			inputs[tick % HISTORY] = ScriptedInput(player, tick);
+			SendInput();
+			Simulate(tick);
+			tick++;
+		}
+		enet_host_flush(host);
+	}
+
+	void Report(double seconds)
+	{
+		double corrected = corrections ? corrections : 1;
+		printf("client %d: %u ticks, %u states (%u confirmed, %u corrected, %u resyncs, %u late inputs), %.1f kB/s down, %.1f kB/s up\n", player, tick,
+			statesReceived, confirmed, corrections, resyncs, lateInputs, host->totalReceivedData / seconds / 1024, host->totalSentData / seconds / 1024);
+		printf("client %d: per correction %.1f ticks resimulated, %.3f ms (max %.3f ms)\n", player,
+			resimTicks / corrected, resimSeconds * 1000 / corrected, maxResimSeconds * 1000);
+	}
+
+	inline bool IsConnected() { return server != nullptr; }
+
+	~Client()
+	{
+		if (server)
+			enet_peer_disconnect_now(server, 0);
+		if (host)
+			enet_host_destroy(host);
+	}
+
+private:
+	void Receive(ENetPacket* packet)
+	{
+		if (packet->dataLength >= sizeof(WelcomePacket) && packet->data[0] == (unsigned char)PACKET_TYPE::WELCOME)
+		{
+			WelcomePacket welcome;
+			memcpy(&welcome, packet->data, sizeof(welcome));
+			player = welcome.player;
+			return;
+		}
+
+		StatePacket state;
+		if (player < 0 || packet->dataLength < sizeof(state) || packet->data[0] != (unsigned char)PACKET_TYPE::STATE)
+			return;
+		memcpy(&state, packet->data, sizeof(state));
+		const unsigned char* snapshot = packet->data + sizeof(state);
+		size_t snapshotSize = packet->dataLength - sizeof(state);
+		statesReceived++;
+
+		//everyone else is predicted to keep pressing what they last pressed
+		memcpy(otherInputs, state.inputs, sizeof(otherInputs));
+
+		if (!synced || state.tick > tick)
+		{
+			//first state, or we've fallen behind the server. jump to it and get ahead again
+			if (!world.system.RestoreSnapshot(snapshot, snapshotSize))
+				return;
+			if (synced)
+				resyncs++;
+			synced = true;
+			tick = state.tick;
+			RecordHash(tick);
+			startTime = enet_time_get();
+			startTick = tick + server->roundTripTime * TICK_RATE / 1000 + INPUT_LEAD;
+			return;
+		}
+
+		if (tick - state.tick >= HISTORY)
+			return;
+
+		//the server didn't use our input for that tick, so it must have arrived late. get a bit further ahead
+		if (state.inputs[player] != inputs[(state.tick - 1) % HISTORY])
+		{
+			startTick++;
+			lateInputs++;
+		}
+
+		if (hashTicks[state.tick % HISTORY] == state.tick && hashes[state.tick % HISTORY] == state.hash)
+		{
+			confirmed++;
+			return;
+		}
+
+		//mispredicted, so go back to the server's state and replay our inputs on top of it
+		auto start = std::chrono::steady_clock::now();
+		if (!world.system.RestoreSnapshot(snapshot, snapshotSize))
+			return;
+		RecordHash(state.tick);
+		for (unsigned int t = state.tick; t < tick; t++)
+			Simulate(t);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		corrections++;
+		resimTicks += tick - state.tick;
+		resimSeconds += seconds;
+		if (seconds > maxResimSeconds)
+			maxResimSeconds = seconds;
+	}
+
+	//steps the world from tick t to t + 1
+	void Simulate(unsigned int t)
+	{
+		for (int i = 0; i < MAX_PLAYERS; i++)
+			world.ApplyInput(i, i == player ? inputs[t % HISTORY] : otherInputs[i]);
+		world.system.Update();
+		RecordHash(t + 1);
+	}
+
+	void RecordHash(unsigned int t)
+	{
+		hashes[t % HISTORY] = world.system.HashState();
+		hashTicks[t % HISTORY] = t;
+	}
+
+	void SendInput()
+	{
+		InputPacket packet;
+		packet.type = PACKET_TYPE::INPUT;
+		packet.tick = tick;
+		packet.count = INPUT_REDUNDANCY;
+		for (int i = 0; i < INPUT_REDUNDANCY; i++)
+			packet.inputs[i] = inputs[(tick - i) % HISTORY];
+		enet_peer_send(server, 1, enet_packet_create(&packet, sizeof(packet), ENET_PACKET_FLAG_UNSEQUENCED));
+	}
+
+	ENetHost* host = nullptr;
+	ENetPeer* server = nullptr;
+	World world;
+	int player = -1;
+	bool synced = false;
+	unsigned int tick = 0;
+	//the client's clock, tick startTick happens at startTime
+	unsigned int startTick = 0;
+	enet_uint32 startTime = 0;
+
+	unsigned char inputs[HISTORY] = {};
+	unsigned char otherInputs[MAX_PLAYERS] = {};
+	unsigned long long hashes[HISTORY] = {};
+	unsigned int hashTicks[HISTORY] = {};
+
+	unsigned int statesReceived = 0;
+	unsigned int confirmed = 0;
+	unsigned int corrections = 0;
+	unsigned int resyncs = 0;
+	unsigned int lateInputs = 0;
+	unsigned long long resimTicks = 0;
+	double resimSeconds = 0;
+	double maxResimSeconds = 0;
+};
+
+static bool Finished(enet_uint32 start, unsigned int seconds)
+{
+	return seconds && enet_time_get() - start >= seconds * 1000;
+}
+
+int main(int argc, char** argv)
+{
+	const char* mode = argc > 1 ? argv[1] : "local";
+	if (enet_initialize() != 0)
+	{
+		fprintf(stderr, "couldn't initialise enet\n");
+		return 1;
+	}
+	atexit(enet_deinitialize);
+
+	enet_uint32 start = enet_time_get();
+	if (strcmp(mode, "server") == 0)
+	{
+		unsigned short port = argc > 2 ? (unsigned short)atoi(argv[2]) : DEFAULT_PORT;
+		unsigned int seconds = argc > 3 ? atoi(argv[3]) : 30;
+		Server server;
+		if (!server.Start(port))
+		{
+			fprintf(stderr, "couldn't listen on port %d\n", port);
+			return 1;
+		}
+		while (!Finished(start, seconds))
+			server.Update(1);
+		server.Report((enet_time_get() - start) / 1000.0);
+	}
+	else if (strcmp(mode, "client") == 0)
+	{
+		const char* hostName = argc > 2 ? argv[2] : "127.0.0.1";
+		unsigned short port = argc > 3 ? (unsigned short)atoi(argv[3]) : DEFAULT_PORT;
+		unsigned int seconds = argc > 4 ? atoi(argv[4]) : 30;
+		Client client;
+		if (!client.Start(hostName, port))
+		{
+			fprintf(stderr, "couldn't connect to %s:%d\n", hostName, port);
+			return 1;
+		}
+		while (!Finished(start, seconds) && client.IsConnected())
+			client.Update(1);
+		client.Report((enet_time_get() - start) / 1000.0);
+	}
+	else if (strcmp(mode, "local") == 0)
+	{
+		int clientCount = argc > 2 ? atoi(argv[2]) : 2;
+		unsigned int seconds = argc > 3 ? atoi(argv[3]) : 30;
+		if (clientCount < 1 || clientCount > MAX_PLAYERS)
+		{
+			fprintf(stderr, "between 1 and %d clients\n", MAX_PLAYERS);
+			return 1;
+		}
+
+		Server server;
+		std::vector<Client> clients(clientCount);
+		if (!server.Start(DEFAULT_PORT))
+		{
+			fprintf(stderr, "couldn't listen on port %d\n", DEFAULT_PORT);
+			return 1;
+		}
+		for (Client& client : clients)
+		{
+			if (!client.Start("127.0.0.1", DEFAULT_PORT))
+			{
+				fprintf(stderr, "couldn't connect to localhost\n");
+				return 1;
+			}
+		}
+
+		while (!Finished(start, seconds))
+		{
+			server.Update(0);
+			for (Client& client : clients)
+				client.Update(0);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		double elapsed = (enet_time_get() - start) / 1000.0;
+		server.Report(elapsed);
+		for (Client& client : clients)
+			client.Report(elapsed);
+	}
+	else
+	{
+		fprintf(stderr, "usage: NetSample server [port] [seconds] | client [host] [port] [seconds] | local [clients] [seconds]\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,181 @@
+//headless playback of a session recorded by the PhysicsProgram (press F5 there to save session.fzxlog)
+//every command is applied on the tick it was recorded on, so the world goes through exactly the same steps without the window.
+//this is for finding and profiling the frames that were slow while playing
+//
+//usage:
+//	Replay <log>							(times every step, prints the slowest and checks the final state matches the recording)
+//	Replay <log> <tick> [repeats]			(plays up to tick, then runs that one step repeats times from a snapshot and times it)
+//repeats defaults to 1000
+//
+//on linux, from this folder:
+//	g++ -std=c++20 -O2 -I../glm -I../fizix -I../SimpleFramework Replay.cpp ../SimpleFramework/CommandLog.cpp ../fizix/*.cpp -o Replay
+//the hash only matches the recording if this is the same build as the program that recorded it (or both use FZX_DETERMINISTIC)
+
+#include "fzx.h"
+#include "CommandLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace fzx;
+
+//how many of the slowest steps are printed
+constexpr size_t SLOWEST_COUNT = 10;
+
+struct StepTime
+{
+	unsigned int tick;
+	double ms;
+	size_t bodies;
+};
+
+static double Milliseconds(std::chrono::steady_clock::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+//plays the whole log, timing every step
+static int PlayAll(CommandLog& log, PhysicsSystem& system)
+{
+	std::vector<StepTime> times;
+	times.reserve(log.GetRecordedTicks());
+	double totalMs = 0;
+
+	while (log.GetTick() < log.GetRecordedTicks())
+	{
+		if (!log.PlayCommands())
+		{
+			fprintf(stderr, "desynced on tick %u: a command's body doesn't exist\n", log.GetTick());
+			return 1;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		log.Step();
+		double ms = Milliseconds(std::chrono::steady_clock::now() - start);
+
+		totalMs += ms;
+		times.push_back({ log.GetTick() - 1, ms, system.GetPhysicsObjectCount() });
+	}
+	//commands recorded after the last step (this is where the log was saved)
+	if (!log.PlayCommands())
+	{
+		fprintf(stderr, "desynced after the last tick\n");
+		return 1;
+	}
+
+	printf("%u ticks, %zu commands, %.3f ms per step on average\n", log.GetRecordedTicks(), log.GetCommandCount(),
+		times.empty() ? 0.0 : totalMs / times.size());
+
+	size_t slowest = std::min(SLOWEST_COUNT, times.size());
+	std::partial_sort(times.begin(), times.begin() + slowest, times.end(), [](const StepTime& a, const StepTime& b) { return a.ms > b.ms; });
+	if (slowest > 0)
+		printf("slowest steps (run again with the tick to profile it):\n");
+	for (size_t i = 0; i < slowest; i++)
+		printf("\ttick %u: %.3f ms, %zu bodies\n", times[i].tick, times[i].ms, times[i].bodies);
+
+	unsigned long long hash = system.HashState();
+	if (hash != log.GetRecordedHash())
+	{
+		printf("final state DOESN'T match the recording (%016llx, recorded %016llx)\n", hash, log.GetRecordedHash());
+		return 1;
+	}
+	printf("final state matches the recording (%016llx)\n", hash);
+	return 0;
+}
+
+//plays up to profileTick, then repeats that one step from a snapshot so it can be timed or looked at in a profiler
+static int ProfileTick(CommandLog& log, PhysicsSystem& system, unsigned int profileTick, int repeats)
+{
+	while (log.GetTick() < profileTick)
+	{
+		if (!log.PlayCommands())
+		{
+			fprintf(stderr, "desynced on tick %u: a command's body doesn't exist\n", log.GetTick());
+			return 1;
+		}
+		log.Step();
+	}
+	if (!log.PlayCommands())
+	{
+		fprintf(stderr, "desynced on tick %u: a command's body doesn't exist\n", log.GetTick());
+		return 1;
+	}
+
+	std::vector<unsigned char> snapshot;
+	system.SaveSnapshot(snapshot);
+
+	double totalMs = 0;
+	double fastestMs = 0;
+	double slowestMs = 0;
+	unsigned long long firstHash = 0;
+	bool consistent = true;
+	for (int i = 0; i < repeats; i++)
+	{
+		system.RestoreSnapshot(snapshot.data(), snapshot.size());
+
+		//the system is stepped directly so the log stays on this tick
+		auto start = std::chrono::steady_clock::now();
+		system.Update();
+		double ms = Milliseconds(std::chrono::steady_clock::now() - start);
+
+		totalMs += ms;
+		fastestMs = i == 0 ? ms : std::min(fastestMs, ms);
+		slowestMs = std::max(slowestMs, ms);
+
+		//every repeat starts from the same state so it should end in the same one
+		unsigned long long hash = system.HashState();
+		if (i == 0)
+			firstHash = hash;
+		else if (hash != firstHash)
+			consistent = false;
+	}
+
+	printf("tick %u, %zu bodies, %d repeats: %.3f ms average, %.3f ms fastest, %.3f ms slowest\n", profileTick,
+		system.GetPhysicsObjectCount(), repeats, totalMs / repeats, fastestMs, slowestMs);
+	if (!consistent)
+	{
+		printf("repeats ended in different states, so restoring the snapshot isn't exact\n");
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: Replay <log> [tick [repeats]]\n");
+		return 1;
+	}
+
+	//the settings come from the log, so the system is made before they're known and set after
+	PhysicsSystem system(0);
+	CommandLog log(system);
+	if (!log.Load(argv[1]))
+	{
+		fprintf(stderr, "couldn't load %s\n", argv[1]);
+		return 1;
+	}
+
+	Real deltaTime;
+	Vector2 gravity;
+	int collisionIterations;
+	log.GetSettings(deltaTime, gravity, collisionIterations);
+	system.SetDeltaTime(deltaTime);
+	system.SetGravity(gravity);
+	system.SetCollisionIterations(collisionIterations);
+
+	if (argc < 3)
+		return PlayAll(log, system);
+
+	unsigned int profileTick = (unsigned int)atoi(argv[2]);
+	int repeats = argc > 3 ? atoi(argv[3]) : 1000;
+	if (profileTick >= log.GetRecordedTicks() || repeats < 1)
+	{
+		fprintf(stderr, "the tick has to be below %u and repeats at least 1\n", log.GetRecordedTicks());
+		return 1;
+	}
+	return ProfileTick(log, system, profileTick, repeats);
+}
@@ -0,0 +1,514 @@
+#include "CommandLog.h"
+#include <cstdio>
+#include <cstring>
+
+//"FZXR"
+static const uint32_t LOG_MAGIC = 0x52585A46;
+//version 2 added joint commands, version 1 logs are still read since they can't contain them
+static const uint32_t LOG_VERSION = 2;
+
+//little-endian with 32 bit floats, followed by the commands, shapes and points
+struct LogHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t commandCount;
+	uint32_t shapeCount;
+	uint32_t pointCount;
+	uint32_t recordedTicks;
+	uint32_t hashLow;
+	uint32_t hashHigh;
+	float deltaTime;
+	float gravity[2];
+	uint32_t collisionIterations;
+};
+static_assert(sizeof(LogHeader) == 48, "the header is written straight to the file");
+
+void CommandLog::SetCallbacks(CreateBodyCallback create, DestroyBodyCallback destroy, ClearCallback clear, void* infoPtr)
+{
+	createCallback = create;
+	destroyCallback = destroy;
+	clearCallback = clear;
+	callbackPtr = infoPtr;
+}
+
+void CommandLog::Record(COMMAND_TYPE type, PhysicsObject* body, const float* values, int valueCount, uint32_t other)
+{
+	Command command = {};
+	command.tick = tick;
+	command.type = type;
+	command.body = body ? body->GetID() : 0;
+	command.other = other;
+	for (int i = 0; i < valueCount; i++)
+		command.values[i] = values[i];
+
+	if (!playing)
+		commands.push_back(command);
+	Apply(command);
+}
+
+void CommandLog::Clear()
+{
+	Record(COMMAND_TYPE::CLEAR, nullptr);
+}
+
+PhysicsObject* CommandLog::CreateBody(const PhysicsData& data, const LoggedShape& shape)
+{
+	StoredShape stored = {};
+	stored.type = shape.type;
+	stored.radius = shape.radius;
+	stored.a[0] = shape.a.x;
+	stored.a[1] = shape.a.y;
+	stored.b[0] = shape.b.x;
+	stored.b[1] = shape.b.y;
+	stored.pointCount = shape.pointCount;
+	stored.firstPoint = (uint32_t)points.size();
+	if (shape.type == LOGGED_SHAPE_TYPE::POLYGON)
+	{
+		for (int i = 0; i < shape.pointCount; i++)
+			points.push_back(Vector2((float)shape.points[i].x, (float)shape.points[i].y));
+	}
+	shapes.push_back(stored);
+
+	Command command = {};
+	command.tick = tick;
+	command.type = COMMAND_TYPE::CREATE_BODY;
+	command.flags = (data.isDynamic ? COMMAND_DYNAMIC : 0) | (data.isRotatable ? COMMAND_ROTATABLE : 0) | (data.isKinematic ? COMMAND_KINEMATIC : 0);
+	command.other = (uint32_t)shapes.size() - 1;
+	command.values[0] = (float)data.position.x;
+	command.values[1] = (float)data.position.y;
+	command.values[2] = (float)data.rotation;
+	if (!Apply(command))
+		return nullptr;
+
+	//the id is only known once it has been made
+	command.body = created->GetID();
+	if (!playing)
+		commands.push_back(command);
+	return created;
+}
+
+void CommandLog::DeleteBody(PhysicsObject* body)
+{
+	Record(COMMAND_TYPE::DELETE_BODY, body);
+}
+
+void CommandLog::MergeBodies(PhysicsObject* body, PhysicsObject* other)
+{
+	Record(COMMAND_TYPE::MERGE_BODIES, body, nullptr, 0, other->GetID());
+}
+
+void CommandLog::SetPosition(PhysicsObject* body, Vector2 position)
+{
+	float values[2] = { (float)position.x, (float)position.y };
+	Record(COMMAND_TYPE::SET_POSITION, body, values, 2);
+}
+
+void CommandLog::SetRotation(PhysicsObject* body, Real rotation)
+{
+	float value = (float)rotation;
+	Record(COMMAND_TYPE::SET_ROTATION, body, &value, 1);
+}
+
+void CommandLog::SetVelocity(PhysicsObject* body, Vector2 velocity)
+{
+	float values[2] = { (float)velocity.x, (float)velocity.y };
+	Record(COMMAND_TYPE::SET_VELOCITY, body, values, 2);
+}
+
+void CommandLog::SetAngularVelocity(PhysicsObject* body, Real angularVelocity)
+{
+	float value = (float)angularVelocity;
+	Record(COMMAND_TYPE::SET_ANGULAR_VELOCITY, body, &value, 1);
+}
+
+void CommandLog::SetInverseMass(PhysicsObject* body, Real inverseMass)
+{
+	float value = (float)inverseMass;
+	Record(COMMAND_TYPE::SET_INVERSE_MASS, body, &value, 1);
+}
+
+void CommandLog::SetInverseInertia(PhysicsObject* body, Real inverseInertia)
+{
+	float value = (float)inverseInertia;
+	Record(COMMAND_TYPE::SET_INVERSE_INERTIA, body, &value, 1);
+}
+
+void CommandLog::AddVelocity(PhysicsObject* body, Vector2 velocity)
+{
+	float values[2] = { (float)velocity.x, (float)velocity.y };
+	Record(COMMAND_TYPE::ADD_VELOCITY, body, values, 2);
+}
+
+void CommandLog::AddVelocityAtPosition(PhysicsObject* body, Vector2 velocity, Vector2 point)
+{
+	float values[4] = { (float)velocity.x, (float)velocity.y, (float)point.x, (float)point.y };
+	Record(COMMAND_TYPE::ADD_VELOCITY_AT_POSITION, body, values, 4);
+}
+
+void CommandLog::AddImpulseAtPosition(PhysicsObject* body, Vector2 impulse, Vector2 point)
+{
+	float values[4] = { (float)impulse.x, (float)impulse.y, (float)point.x, (float)point.y };
+	Record(COMMAND_TYPE::ADD_IMPULSE_AT_POSITION, body, values, 4);
+}
+
+Joint* CommandLog::CreateMouseJoint(PhysicsObject* body, Vector2 anchor, Real maxForce, Real frequency)
+{
+	Command command = {};
+	command.tick = tick;
+	command.type = COMMAND_TYPE::CREATE_MOUSE_JOINT;
+	command.body = body->GetID();
+	command.values[0] = (float)anchor.x;
+	command.values[1] = (float)anchor.y;
+	command.values[2] = (float)maxForce;
+	command.values[3] = (float)frequency;
+	if (!Apply(command))
+		return nullptr;
+
+	//like bodies, the id is only known once it has been made
+	command.other = createdJoint->GetID();
+	if (!playing)
+		commands.push_back(command);
+	return createdJoint;
+}
+
+void CommandLog::SetJointTarget(Joint* joint, Vector2 target)
+{
+	float values[2] = { (float)target.x, (float)target.y };
+	Record(COMMAND_TYPE::SET_JOINT_TARGET, nullptr, values, 2, joint->GetID());
+}
+
+void CommandLog::DeleteJoint(Joint* joint)
+{
+	Record(COMMAND_TYPE::DELETE_JOINT, nullptr, nullptr, 0, joint->GetID());
+}
+
+void CommandLog::Step()
+{
+	system.Update();
+	tick++;
+}
+
+PhysicsObject* CommandLog::FindBody(uint32_t id)
+{
+	auto it = bodies.find(id);
+	return it == bodies.end() ? nullptr : it->second;
+}
+
+Joint* CommandLog::FindJoint(uint32_t id)
+{
+	auto it = joints.find(id);
+	return it == joints.end() ? nullptr : it->second;
+}
+
+void CommandLog::ForgetJoints(PhysicsObject* body)
+{
+	for (auto it = joints.begin(); it != joints.end();)
+	{
+		if (it->second->GetBodyA() == body || it->second->GetBodyB() == body)
+			it = joints.erase(it);
+		else
+			++it;
+	}
+}
+
+Shape* CommandLog::BuildShape(const LoggedShape& shape)
+{
+	switch (shape.type)
+	{
+	case LOGGED_SHAPE_TYPE::CIRCLE:
+		return new CircleShape(shape.radius, shape.a);
+	case LOGGED_SHAPE_TYPE::REGULAR_POLYGON:
+		return PolygonShape::GetRegularPolygonCollider(shape.radius, shape.pointCount);
+	case LOGGED_SHAPE_TYPE::POLYGON:
+	{
+		//the constructor wants points it can change
+		std::vector<Vector2> copy(shape.points, shape.points + shape.pointCount);
+		return PolygonShape::Create(copy.data(), shape.pointCount);
+	}
+	case LOGGED_SHAPE_TYPE::CAPSULE:
+		return new CapsuleShape(shape.a, shape.b, shape.radius);
+	case LOGGED_SHAPE_TYPE::PLANE:
+		return new PlaneShape(shape.a, shape.radius);
+	}
+	return nullptr;
+}
+
+bool CommandLog::Apply(const Command& command)
+{
+	const float* v = command.values;
+	switch (command.type)
+	{
+	case COMMAND_TYPE::CLEAR:
+		if (clearCallback)
+			clearCallback(callbackPtr);
+		else
+			system.ClearPhysicsBodies();
+		bodies.clear();
+		joints.clear();
+		return true;
+
+	case COMMAND_TYPE::CREATE_BODY:
+	{
+		if (command.other >= shapes.size())
+			return false;
+		const StoredShape& stored = shapes[command.other];
+		LoggedShape shape;
+		shape.type = stored.type;
+		shape.radius = stored.radius;
+		shape.a = Vector2(stored.a[0], stored.a[1]);
+		shape.b = Vector2(stored.b[0], stored.b[1]);
+		shape.pointCount = stored.pointCount;
+		shape.points = points.data() + stored.firstPoint;
+
+		PhysicsData data(Vector2(v[0], v[1]), v[2], (command.flags & COMMAND_DYNAMIC) != 0, (command.flags & COMMAND_ROTATABLE) != 0);
+		data.isKinematic = (command.flags & COMMAND_KINEMATIC) != 0;
+		created = createCallback ? createCallback(data, callbackPtr) : system.CreatePhysicsObject(data);
+		created->AddCollider(BuildShape(shape));
+		bodies[created->GetID()] = created;
+		//every later command finds its body by id, so a replay that hands out different ids has gone wrong
+		return !playing || created->GetID() == command.body;
+	}
+	case COMMAND_TYPE::SET_JOINT_TARGET:
+	case COMMAND_TYPE::DELETE_JOINT:
+	{
+		Joint* joint = FindJoint(command.other);
+		if (!joint)
+			return false;
+		if (command.type == COMMAND_TYPE::SET_JOINT_TARGET)
+			joint->SetTarget(Vector2(v[0], v[1]));
+		else
+		{
+			joints.erase(command.other);
+			system.DeleteJoint(joint);
+		}
+		return true;
+	}
+	default:
+		break;
+	}
+
+	PhysicsObject* body = FindBody(command.body);
+	if (!body)
+		return false;
+
+	switch (command.type)
+	{
+	case COMMAND_TYPE::DELETE_BODY:
+		bodies.erase(command.body);
+		ForgetJoints(body);
+		if (destroyCallback)
+			destroyCallback(body, callbackPtr);
+		else
+			system.DeletePhysicsBody(body);
+		break;
+	case COMMAND_TYPE::MERGE_BODIES:
+	{
+		PhysicsObject* other = FindBody(command.other);
+		if (!other || other == body)
+			return false;
+
+		//all the shapes are added at once so mass and centring are only calculated once
+		std::vector<ColliderDesc> merged;
+		merged.reserve(other->GetColliderCount());
+		for (unsigned char i = 0; i < other->GetColliderCount(); i++)
+		{
+			//the shapes are shared with the new colliders, only where they are relative to the body changes
+			Collider& c = other->GetCollider(i);
+			Transform& local = c.GetLocalTransform();
+			Vector2 offset = body->GetTransform().InverseTransformPoint(other->GetTransform().TransformPoint(local.position));
+			Real rotation = other->GetRotation() + local.rotation - body->GetRotation();
+
+			merged.push_back(ColliderDesc(c.GetShape(), c.GetDensity(), c.GetIsTrigger(), c.GetCollisionLayer(), c.GetCollisionMask(), offset, rotation));
+		}
+		body->AddColliders(merged.data(), (unsigned char)merged.size());
+
+		bodies.erase(command.other);
+		ForgetJoints(other);
+		if (destroyCallback)
+			destroyCallback(other, callbackPtr);
+		else
+			system.DeletePhysicsBody(other);
+		break;
+	}
+	case COMMAND_TYPE::SET_POSITION:
+		body->SetPosition(Vector2(v[0], v[1]));
+		break;
+	case COMMAND_TYPE::SET_ROTATION:
+		body->SetRotation(v[0]);
+		body->GetTransform().UpdateData();
+		break;
+	case COMMAND_TYPE::SET_VELOCITY:
+		body->SetVelocity(Vector2(v[0], v[1]));
+		break;
+	case COMMAND_TYPE::SET_ANGULAR_VELOCITY:
+		body->SetAngularVelocity(v[0]);
+		break;
+	case COMMAND_TYPE::SET_INVERSE_MASS:
+		body->SetInverseMass(v[0]);
+		break;
+	case COMMAND_TYPE::SET_INVERSE_INERTIA:
+		body->SetInverseInertia(v[0]);
+		break;
+	case COMMAND_TYPE::ADD_VELOCITY:
+		body->AddVelocity(Vector2(v[0], v[1]));
+		break;
+	case COMMAND_TYPE::ADD_VELOCITY_AT_POSITION:
+		body->AddVelocityAtPosition(Vector2(v[0], v[1]), Vector2(v[2], v[3]));
+		break;
+	case COMMAND_TYPE::ADD_IMPULSE_AT_POSITION:
+		body->AddImpulseAtPosition(Vector2(v[0], v[1]), Vector2(v[2], v[3]));
+		break;
+	case COMMAND_TYPE::CREATE_MOUSE_JOINT:
+	{
+		JointDesc desc(JOINT_TYPE::MOUSE, body, nullptr, Vector2(v[0], v[1]));
+		desc.maxForce = v[2];
+		desc.frequency = v[3];
+		createdJoint = system.CreateJoint(desc);
+		if (!createdJoint)
+			return false;
+		joints[createdJoint->GetID()] = createdJoint;
+		return !playing || createdJoint->GetID() == command.other;
+	}
+	default:
+		return false;
+	}
+	return true;
+}
+
+bool CommandLog::PlayCommands()
+{
+	while (nextCommand < commands.size() && commands[nextCommand].tick == tick)
+	{
+		if (!Apply(commands[nextCommand++]))
+			return false;
+	}
+	return true;
+}
+
+void CommandLog::GetSettings(Real& deltaTime, Vector2& gravity, int& collisionIterations)
+{
+	deltaTime = recordedDeltaTime;
+	gravity = Vector2(recordedGravity[0], recordedGravity[1]);
+	collisionIterations = (int)recordedIterations;
+}
+
+bool CommandLog::Save(const char* path)
+{
+	unsigned long long hash = system.HashState();
+	LogHeader header;
+	header.magic = LOG_MAGIC;
+	header.version = LOG_VERSION;
+	header.commandCount = (uint32_t)commands.size();
+	header.shapeCount = (uint32_t)shapes.size();
+	header.pointCount = (uint32_t)points.size();
+	header.recordedTicks = tick;
+	header.hashLow = (uint32_t)hash;
+	header.hashHigh = (uint32_t)(hash >> 32);
+	header.deltaTime = (float)system.GetDeltaTime();
+	header.gravity[0] = (float)system.GetGravity().x;
+	header.gravity[1] = (float)system.GetGravity().y;
+	header.collisionIterations = (uint32_t)system.GetCollisionIterations();
+
+	std::vector<float> pointData(points.size() * 2);
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		pointData[i * 2] = (float)points[i].x;
+		pointData[i * 2 + 1] = (float)points[i].y;
+	}
+
+	//fopen counts as unsafe with SDL checks on
+#ifdef _WIN32
+	FILE* file = nullptr;
+	if (fopen_s(&file, path, "wb") != 0)
+		file = nullptr;
+#else
+	FILE* file = fopen(path, "wb");
+#endif
+	if (!file)
+		return false;
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(commands.data(), sizeof(Command), commands.size(), file) == commands.size()
+		&& fwrite(shapes.data(), sizeof(StoredShape), shapes.size(), file) == shapes.size()
+		&& fwrite(pointData.data(), sizeof(float), pointData.size(), file) == pointData.size();
+	return fclose(file) == 0 && written;
+}
+
+bool CommandLog::Load(const char* path)
+{
+#ifdef _WIN32
+	FILE* file = nullptr;
+	if (fopen_s(&file, path, "rb") != 0)
+		file = nullptr;
+#else
+	FILE* file = fopen(path, "rb");
+#endif
+	if (!file)
+		return false;
+
+	std::vector<unsigned char> data;
+	unsigned char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		data.insert(data.end(), buffer, buffer + read);
+	fclose(file);
+
+	LogHeader header;
+	if (data.size() < sizeof(header))
+		return false;
+	memcpy(&header, data.data(), sizeof(header));
+	if (header.magic != LOG_MAGIC || header.version < 1 || header.version > LOG_VERSION)
+		return false;
+
+	unsigned long long expected = sizeof(header) + (unsigned long long)header.commandCount * sizeof(Command)
+		+ (unsigned long long)header.shapeCount * sizeof(StoredShape) + (unsigned long long)header.pointCount * 2 * sizeof(float);
+	if (data.size() != expected)
+		return false;
+
+	const unsigned char* cursor = data.data() + sizeof(header);
+	std::vector<Command> loadedCommands(header.commandCount);
+	memcpy(loadedCommands.data(), cursor, loadedCommands.size() * sizeof(Command));
+	cursor += loadedCommands.size() * sizeof(Command);
+	std::vector<StoredShape> loadedShapes(header.shapeCount);
+	memcpy(loadedShapes.data(), cursor, loadedShapes.size() * sizeof(StoredShape));
+	cursor += loadedShapes.size() * sizeof(StoredShape);
+	std::vector<Vector2> loadedPoints(header.pointCount);
+	for (size_t i = 0; i < loadedPoints.size(); i++, cursor += 2 * sizeof(float))
+	{
+		float point[2];
+		memcpy(point, cursor, sizeof(point));
+		loadedPoints[i] = Vector2(point[0], point[1]);
+	}
+
+	//commands have to be in tick order and shapes have to fit in the point table, or playback could read past the end
+	for (size_t i = 0; i < loadedCommands.size(); i++)
+	{
+		if ((i > 0 && loadedCommands[i].tick < loadedCommands[i - 1].tick) || loadedCommands[i].tick > header.recordedTicks)
+			return false;
+	}
+	for (const StoredShape& shape : loadedShapes)
+	{
+		if (shape.type > LOGGED_SHAPE_TYPE::PLANE)
+			return false;
+		if (shape.type == LOGGED_SHAPE_TYPE::POLYGON && ((unsigned long long)shape.firstPoint + shape.pointCount > loadedPoints.size() || shape.pointCount < 3))
+			return false;
+		if (shape.type == LOGGED_SHAPE_TYPE::REGULAR_POLYGON && (shape.pointCount < 3 || shape.pointCount > FZX_MAX_VERTICES))
+			return false;
+	}
+
+	commands.swap(loadedCommands);
+	shapes.swap(loadedShapes);
+	points.swap(loadedPoints);
+	bodies.clear();
+	joints.clear();
+	tick = 0;
+	nextCommand = 0;
+	playing = true;
+	recordedTicks = header.recordedTicks;
+	recordedHash = (unsigned long long)header.hashHigh << 32 | header.hashLow;
+	recordedDeltaTime = header.deltaTime;
+	recordedGravity[0] = header.gravity[0];
+	recordedGravity[1] = header.gravity[1];
+	recordedIterations = header.collisionIterations;
+	return true;
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include "fzx.h"
+#include <cstdint>
+#include <unordered_map>
+
+using namespace fzx;
+
+//every change the program makes to the world goes through here and is recorded with the tick it happened on,
+//so a session can be saved and played back exactly without the window (see the Replay project)
+//everything is applied from the recorded values, so the live world and a replay go through exactly the same code.
+//this only depends on fizix so the replayer can build it on its own
+
+enum class LOGGED_SHAPE_TYPE : uint32_t
+{
+	CIRCLE,
+	//PolygonShape::GetRegularPolygonCollider(radius, pointCount)
+	REGULAR_POLYGON,
+	//PolygonShape::Create(points, pointCount)
+	POLYGON,
+	CAPSULE,
+	PLANE
+};
+
+//how a shape was made, rather than the shape itself, so a replay makes an identical one
+struct LoggedShape
+{
+	LOGGED_SHAPE_TYPE type = LOGGED_SHAPE_TYPE::CIRCLE;
+	//circle: centre in a
+	//capsule: radius, ends in a and b
+	//plane: distance in radius, normal in a
+	float radius = 1;
+	Vector2 a = Vector2(0, 0);
+	Vector2 b = Vector2(0, 0);
+	int pointCount = 0;
+	//only for POLYGON, copied when the body is created
+	const Vector2* points = nullptr;
+};
+
+class CommandLog
+{
+public:
+	enum class COMMAND_TYPE : uint16_t
+	{
+		CLEAR,
+		CREATE_BODY,
+		DELETE_BODY,
+		//moves the other body's colliders onto this one, then deletes it
+		MERGE_BODIES,
+		SET_POSITION,
+		SET_ROTATION,
+		SET_VELOCITY,
+		SET_ANGULAR_VELOCITY,
+		SET_INVERSE_MASS,
+		SET_INVERSE_INERTIA,
+		ADD_VELOCITY,
+		ADD_VELOCITY_AT_POSITION,
+		ADD_IMPULSE_AT_POSITION,
+		CREATE_MOUSE_JOINT,
+		SET_JOINT_TARGET,
+		DELETE_JOINT
+	};
+
+	enum COMMAND_FLAGS : uint16_t
+	{
+		COMMAND_DYNAMIC = 1,
+		COMMAND_ROTATABLE = 2,
+		COMMAND_KINEMATIC = 4
+	};
+
+	//written to the file as is, so it has a fixed layout
+	struct Command
+	{
+		//the number of steps before this command
+		uint32_t tick;
+		COMMAND_TYPE type;
+		uint16_t flags;
+		uint32_t body;
+		//MERGE_BODIES: the body being merged in. CREATE_BODY: index of its shape. joint commands: the joint's id
+		uint32_t other;
+		//positions, vectors and values, in the order the function takes them
+		float values[4];
+	};
+	static_assert(sizeof(Command) == 32, "commands are written straight to the file");
+
+	//the program can make its own objects for bodies the log creates and deletes (they default to just the PhysicsSystem's)
+	typedef PhysicsObject* (*CreateBodyCallback)(PhysicsData& data, void* infoPtr);
+	typedef void (*DestroyBodyCallback)(PhysicsObject* body, void* infoPtr);
+	typedef void (*ClearCallback)(void* infoPtr);
+
+	CommandLog(PhysicsSystem& system) : system(system) {}
+	void SetCallbacks(CreateBodyCallback create, DestroyBodyCallback destroy, ClearCallback clear, void* infoPtr);
+
+	//these change the world and record the change. values are rounded to floats first, so they match what is saved
+	void Clear();
+	//only position, rotation, isDynamic, isRotatable and isKinematic are used from data, the rest are PhysicsData's defaults
+	PhysicsObject* CreateBody(const PhysicsData& data, const LoggedShape& shape);
+	void DeleteBody(PhysicsObject* body);
+	void MergeBodies(PhysicsObject* body, PhysicsObject* other);
+	void SetPosition(PhysicsObject* body, Vector2 position);
+	void SetRotation(PhysicsObject* body, Real rotation);
+	void SetVelocity(PhysicsObject* body, Vector2 velocity);
+	void SetAngularVelocity(PhysicsObject* body, Real angularVelocity);
+	void SetInverseMass(PhysicsObject* body, Real inverseMass);
+	void SetInverseInertia(PhysicsObject* body, Real inverseInertia);
+	void AddVelocity(PhysicsObject* body, Vector2 velocity);
+	void AddVelocityAtPosition(PhysicsObject* body, Vector2 velocity, Vector2 point);
+	void AddImpulseAtPosition(PhysicsObject* body, Vector2 impulse, Vector2 point);
+	//joints made here are deleted with their body like any other, so a pointer to one shouldn't be kept past deleting or merging it
+	Joint* CreateMouseJoint(PhysicsObject* body, Vector2 anchor, Real maxForce, Real frequency);
+	void SetJointTarget(Joint* joint, Vector2 target);
+	void DeleteJoint(Joint* joint);
+
+	//steps the world and moves on to the next tick
+	void Step();
+
+	//writes everything recorded so far, with the world's hash so a replay can check it ended up in the same place
+	bool Save(const char* path);
+	//loads a log for playback, replacing anything recorded. the system should be empty and use the settings from GetSettings()
+	bool Load(const char* path);
+	//playback: applies the commands recorded at the current tick. returns false if one couldn't be applied (the replay has desynced)
+	bool PlayCommands();
+
+	inline unsigned int GetTick() { return tick; }
+	//the tick the log was saved on
+	inline unsigned int GetRecordedTicks() { return recordedTicks; }
+	inline unsigned long long GetRecordedHash() { return recordedHash; }
+	inline size_t GetCommandCount() { return commands.size(); }
+	void GetSettings(Real& deltaTime, Vector2& gravity, int& collisionIterations);
+
+	//makes a new shape from its description, owned by the caller
+	static Shape* BuildShape(const LoggedShape& shape);
+
+private:
+	//stored shapes point into the point table
+	struct StoredShape
+	{
+		LOGGED_SHAPE_TYPE type;
+		uint32_t firstPoint;
+		uint32_t pointCount;
+		float radius;
+		float a[2];
+		float b[2];
+	};
+	static_assert(sizeof(StoredShape) == 32, "shapes are written straight to the file");
+
+	void Record(COMMAND_TYPE type, PhysicsObject* body, const float* values = nullptr, int valueCount = 0, uint32_t other = 0);
+	bool Apply(const Command& command);
+	PhysicsObject* FindBody(uint32_t id);
+	Joint* FindJoint(uint32_t id);
+	//the system deletes a body's joints with it, so they have to be taken out of joints first
+	void ForgetJoints(PhysicsObject* body);
+
+	PhysicsSystem& system;
+	std::vector<Command> commands;
+	std::vector<StoredShape> shapes;
+	std::vector<Vector2> points;
+	//bodies the log made, by id
+	std::unordered_map<uint32_t, PhysicsObject*> bodies;
+	std::unordered_map<uint32_t, Joint*> joints;
+	//the last body made by a CREATE_BODY command, and the last joint made by CREATE_MOUSE_JOINT
+	PhysicsObject* created = nullptr;
+	Joint* createdJoint = nullptr;
+
+	unsigned int tick = 0;
+	//playback position in commands
+	size_t nextCommand = 0;
+	bool playing = false;
+	unsigned int recordedTicks = 0;
+	unsigned long long recordedHash = 0;
+	float recordedDeltaTime = 0;
+	float recordedGravity[2] = {};
+	uint32_t recordedIterations = 0;
+
+	CreateBodyCallback createCallback = nullptr;
+	DestroyBodyCallback destroyCallback = nullptr;
+	ClearCallback clearCallback = nullptr;
+	void* callbackPtr = nullptr;
+};
@@ -20,9 +20,11 @@ void GameObject::Render(PhysicsProgram* program)
 {
 	for (int i = 0; i < body->GetColliderCount(); i++)
 	{
-		Shape* shape = body->GetCollider(i).GetShape();
+		Collider& collider = body->GetCollider(i);
+		Shape* shape = collider.GetShape();
+		Transform shapeTransform = collider.GetWorldTransform(body->GetTransform());
 		int type = (int)shape->GetType();
-		(drawFunctions[type])(shape, body->GetTransform(), colour, program);
+		(drawFunctions[type])(shape, shapeTransform, colour, program);
 	}
 
 	auto& lR = program->GetLineRenderer();
@@ -1,24 +1,14 @@
 #include "PhysicsProgram.h"
 #include "PhysicsSystem.h"
 
-PhysicsProgram::PhysicsProgram() : playerInput(PlayerInput(*this)), collisionManager(GetDeltaTime()), GameBase()
+PhysicsProgram::PhysicsProgram() : playerInput(PlayerInput(*this)), collisionManager(GetDeltaTime()), commandLog(collisionManager), GameBase()
 {
 	//text.QueueText("The quick brown fox jumped over the lazy dog", Vector2(25.0f, 25.0f), 0.4f, Vector3(1.0f, 0.1f, 0.1f));
 	//text.Build();
 
 	//collisionManager.SetPhysicsDrawer(PhysicsDrawer(DrawCircle, DrawPolygon, DrawCapsule, DrawPlane, this));
-	//multiple shapes in 1 physics object aren't supported JUST yet
-	PhysicsData data = PhysicsData(Vector2(0, 0), 0, false);
-	CreateGameObject(data, Vector3(1, 1, 1))
-		->GetPhysicsObject()->AddCollider(new PlaneShape(Vector2(1, 0), -gridLimits));
-	CreateGameObject(data, Vector3(1, 1, 1))
-		->GetPhysicsObject()->AddCollider(new PlaneShape(Vector2(0, 1), -gridLimits));
-	CreateGameObject(data, Vector3(1, 1, 1))
-		->GetPhysicsObject()->AddCollider(new PlaneShape(Vector2(-1, 0), -gridLimits));
-	CreateGameObject(data, Vector3(1, 1, 1))
-		->GetPhysicsObject()->AddCollider(new PlaneShape(Vector2(0, -1), -gridLimits));
-
-	collisionManager.SetCollisionCallback(OnCollision, nullptr);
+	commandLog.SetCallbacks(OnCreateBody, OnDestroyBody, OnClear, this);
+	CreateWalls();
 }
 
 void PhysicsProgram::Update()
@@ -43,7 +33,8 @@ void PhysicsProgram::Update()
 
 void PhysicsProgram::UpdatePhysics()
 {
-	collisionManager.Update();
+	commandLog.Step();
+	ReadContactEvents();
 }
 
 void PhysicsProgram::Render()
@@ -116,15 +107,40 @@ void PhysicsProgram::OnKeyReleased(int key)
 
 void PhysicsProgram::DeleteGameObject(GameObject* object)
 {
-	gameObjects.erase(std::remove(gameObjects.begin(), gameObjects.end(), object));
-	collisionManager.DeletePhysicsBody(object->body);
+	commandLog.DeleteBody(object->body);
+}
+
+GameObject* PhysicsProgram::CreateGameObject(PhysicsData data, const LoggedShape& shape, Vector3 colour)
+{
+	spawnColour = colour;
+	return (GameObject*)commandLog.CreateBody(data, shape)->GetInfoPointer();
+}
+
+PhysicsObject* PhysicsProgram::OnCreateBody(PhysicsData& data, void* infoPtr)
+{
+	PhysicsProgram* program = (PhysicsProgram*)infoPtr;
+	program->gameObjects.push_back(new GameObject(data, &program->collisionManager, program->spawnColour));
+	return program->gameObjects.back()->body;
+}
+
+void PhysicsProgram::OnDestroyBody(PhysicsObject* body, void* infoPtr)
+{
+	PhysicsProgram* program = (PhysicsProgram*)infoPtr;
+	GameObject* object = (GameObject*)body->GetInfoPointer();
+	program->gameObjects.erase(std::remove(program->gameObjects.begin(), program->gameObjects.end(), object));
+	program->collisionManager.DeletePhysicsBody(body);
 	delete object;
 }
 
-GameObject* PhysicsProgram::CreateGameObject(PhysicsData data, Vector3 colour)
+void PhysicsProgram::OnClear(void* infoPtr)
 {
-	gameObjects.push_back(new GameObject(data, &collisionManager, colour));
-	return gameObjects[gameObjects.size() - 1];
+	PhysicsProgram* program = (PhysicsProgram*)infoPtr;
+	for (size_t i = 0; i < program->gameObjects.size(); i++)
+	{
+		delete program->gameObjects[i];
+	}
+	program->gameObjects.clear();
+	program->collisionManager.ClearPhysicsBodies();
 }
 
 UIObject* PhysicsProgram::AddUIObject(UIObject* uiObject)
@@ -145,19 +161,11 @@ void PhysicsProgram::OnWindowResize(int width, int height)
 void PhysicsProgram::ResetPhysics()
 {
 	//resets stuff
-	for (size_t i = 0; i < gameObjects.size(); i++)
-	{
-		delete gameObjects[i];
-	}
-	gameObjects.clear();
-	collisionManager.ClearPhysicsBodies();
+	commandLog.Clear();
 	collisionPoints.clear();
+	collisionNormals.clear();
 
-	PhysicsData data = PhysicsData(Vector2(0, 0), 0, false);
-	CreateGameObject(data, Vector3(1, 1, 1))->GetPhysicsObject()->AddCollider(new PlaneShape(Vector2(1, 0), -gridLimits));
-	CreateGameObject(data, Vector3(1, 1, 1))->GetPhysicsObject()->AddCollider(new PlaneShape(Vector2(0, 1), -gridLimits));
-	CreateGameObject(data, Vector3(1, 1, 1))->GetPhysicsObject()->AddCollider(new PlaneShape(Vector2(-1, 0), -gridLimits));
-	CreateGameObject(data, Vector3(1, 1, 1))->GetPhysicsObject()->AddCollider(new PlaneShape(Vector2(0, -1), -gridLimits));
+	CreateWalls();
 
 	//testing for physics problems
 	//data = PhysicsData(Vector2(5, -13), glm::radians(45.0f));
@@ -167,6 +175,20 @@ void PhysicsProgram::ResetPhysics()
 
 }
 
+void PhysicsProgram::CreateWalls()
+{
+	PhysicsData data = PhysicsData(Vector2(0, 0), 0, false);
+	const Vector2 normals[4] = { Vector2(1, 0), Vector2(0, 1), Vector2(-1, 0), Vector2(0, -1) };
+	for (const Vector2& normal : normals)
+	{
+		LoggedShape plane;
+		plane.type = LOGGED_SHAPE_TYPE::PLANE;
+		plane.a = normal;
+		plane.radius = (float)-gridLimits;
+		CreateGameObject(data, plane, Vector3(1, 1, 1));
+	}
+}
+
 PhysicsObject* PhysicsProgram::GetObjectUnderPoint(Vector2 point, bool includeStatic, bool includeTriggers)
 {
 	return collisionManager.PointCast(point, includeStatic, includeTriggers);
@@ -174,19 +196,9 @@ PhysicsObject* PhysicsProgram::GetObjectUnderPoint(Vector2 point, bool includeSt
 
 GameObject* PhysicsProgram::GetGameObjectUnderPoint(Vector2 point, bool includeStatic, bool includeTriggers)
 {
-	for (auto* gameObject : gameObjects)
-	{
-		for (size_t j = 0; j < gameObject->GetPhysicsObject()->GetColliderCount(); j++)
-		{
-			Collider&  c = gameObject->GetPhysicsObject()->GetCollider(j);
-
-			if ((includeTriggers || !c.GetIsTrigger()) && (includeStatic || gameObject->GetPhysicsObject()->GetInverseMass() != 0) && c.GetShape()->PointCast(point, gameObject->GetPhysicsObject()->GetTransform()))
-			{
-				return gameObject;
-			}
-		}
-	}
-	return nullptr;
+	//every physics object made by the program has its game object as the info pointer
+	PhysicsObject* body = collisionManager.PointCast(point, includeStatic, includeTriggers);
+	return body ? (GameObject*)body->GetInfoPointer() : nullptr;
 }
 
 void PhysicsProgram::DrawShape(Shape* shape, Transform shapeTransform, Vector3 shapeColour, void* physicsProgram)
@@ -274,24 +286,23 @@ void PhysicsProgram::DrawPlane(Shape* shape, Transform& shapeTransform, Vector3
 	lR.DrawLineSegment(tPlanePoint + tangent, tPlanePoint - tangent, shapeColour);
 }
 
-std::deque<Vector2> PhysicsProgram::collisionPoints;
-std::deque<Vector2> PhysicsProgram::collisionNormals;
-
-bool PhysicsProgram::OnCollision(CollisionData& data, void* infoPtr)
+void PhysicsProgram::ReadContactEvents()
 {
-	if (data.pointCount == 2)
-		collisionPoints.push_back(0.5f * (data.collisionPoints[0] + data.collisionPoints[1]));
-	else
-		collisionPoints.push_back(data.collisionPoints[0]);
-	collisionNormals.push_back(data.collisionNormal);
+	for (auto& e : collisionManager.GetContactEvents())
+	{
+		//end events are where the bodies were last touching, so don't draw them
+		if (e.type == CONTACT_EVENT_TYPE::END)
+			continue;
+
+		collisionPoints.push_back(e.point);
+		collisionNormals.push_back(e.normal);
+	}
 
-	if (collisionPoints.size() > 300)
+	while (collisionPoints.size() > 300)
 	{
 		collisionPoints.pop_front();
 		collisionNormals.pop_front();
 	}
-
-	return true;
 }
 
 PhysicsProgram::~PhysicsProgram()
@@ -5,6 +5,7 @@
 #include <forward_list>
 #include "UIObject.h"
 #include "fzx.h"
+#include "CommandLog.h"
 #include <deque>
 
 #define FPS_OFFSET 1
@@ -24,7 +25,8 @@ public:
 	void OnKeyReleased(int key);
 	void DeleteGameObject(GameObject* object);
 
-	GameObject* CreateGameObject(PhysicsData data, Vector3 colour);
+	//bodies are made through the command log so they can be replayed
+	GameObject* CreateGameObject(PhysicsData data, const LoggedShape& shape, Vector3 colour);
 	UIObject* AddUIObject(UIObject* uiObject);
 
 	//set
@@ -32,6 +34,7 @@ public:
 	void SetPauseState(bool state) { paused = state; }
 	//get
 	PlayerInput& GetPlayerInput() { return playerInput; }
+	CommandLog& GetCommandLog() { return commandLog; }
 	bool GetPauseState() { return paused; }
 	inline const float GetDeltaTime() { return deltaTime; }
 	inline LineRenderer& GetLineRenderer() { return lines; }
@@ -57,16 +60,22 @@ public:
 	static void DrawCapsule(Shape* shape, Transform& shapeTransform, Vector3 shapeColour, void* physicsProgram);
 	static void DrawPlane(Shape* shape, Transform& shapeTransform, Vector3 shapeColour, void* physicsProgram);
 
-	//collision callback
-	static bool OnCollision(CollisionData& data, void* infoPtr);
-
 	~PhysicsProgram();
 	PhysicsProgram(const PhysicsProgram& other) = delete;
 	PhysicsProgram& operator= (const PhysicsProgram& other) = delete;
 
 private:
-	static std::deque<Vector2> collisionPoints;
-	static std::deque<Vector2> collisionNormals;
+	//read contact events after the physics step, instead of inside the solver
+	void ReadContactEvents();
+	void CreateWalls();
+
+	//the command log calls these to make and remove game objects, both live and when replaying
+	static PhysicsObject* OnCreateBody(PhysicsData& data, void* infoPtr);
+	static void OnDestroyBody(PhysicsObject* body, void* infoPtr);
+	static void OnClear(void* infoPtr);
+
+	std::deque<Vector2> collisionPoints;
+	std::deque<Vector2> collisionNormals;
 	
 	std::vector<GameObject*> gameObjects;
 	std::vector<UIObject*> uiObjects;
@@ -75,6 +84,9 @@ private:
 
 	PlayerInput playerInput;
 	fzx::PhysicsSystem collisionManager;
+	CommandLog commandLog;
+	//colour for the next game object the command log makes
+	Vector3 spawnColour = Vector3(1, 1, 1);
 	double lastTime = 0;
 	float lastFPSUpdateTime = - FPS_OFFSET;
 	std::string fpsText;
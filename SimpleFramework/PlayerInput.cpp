@@ -1,6 +1,10 @@
 #include "PlayerInput.h"
 #include "PhysicsProgram.h"
+#include <iostream>
 static const Vector3 disabledColour = Vector3(0.3f, 0.3f, 0.3f);
+//the grab tool's mouse joint can pull with up to GRAB_FORCE times the object's mass, and springs at GRAB_FREQUENCY hz
+static const float GRAB_FORCE = 1000.0f;
+static const float GRAB_FREQUENCY = 5.0f;
 
 #pragma region SHAPE TOOL BUTTON FUNCTIONS
 static void SwitchShapeTool(Button& button, void* infoPointer, PlayerInput::HELD_SHAPE_TOOL tool)
@@ -88,15 +92,16 @@ void PlayerInput::FinishCreatePolygon(Button& button, void* infoPointer)
 	p->isCreatingPolygon = false;
 	if (p->heldShape)
 	{
-		if (p->heldShape->GetType() != SHAPE_TYPE::POLYGON || ((PolygonShape*)p->heldShape)->pointCount < 3)
+		if (p->heldShape->GetType() == SHAPE_TYPE::POLYGON && ((PolygonShape*)p->heldShape)->pointCount >= 3)
 		{
-			delete p->heldShape;
-		}
-		else {
+			LoggedShape shape;
+			shape.type = LOGGED_SHAPE_TYPE::POLYGON;
+			shape.points = &p->customPolyPoints[0];
+			shape.pointCount = (int)p->customPolyPoints.size();
 			PhysicsData data = PhysicsData(Vector2(0, 0), 0);
-			p->program.CreateGameObject(data, p->afterCreatedColour)->GetPhysicsObject()
-				->AddCollider(p->heldShape);
+			p->program.CreateGameObject(data, shape, p->afterCreatedColour);
 		}
+		delete p->heldShape;
 		p->heldShape = nullptr;
 	}
 	
@@ -368,25 +373,25 @@ void PlayerInput::Render()
 				}
 				break;
 			case HELD_MODIFIER_TOOL::GRAB:
-				if (heldObject != nullptr)
+				if (heldJoint != nullptr)
 				{
-					Vector2 startPos = heldObject->GetTransform().TransformPoint(startingPosition);
-					program.GetLineRenderer().DrawLineSegment(startPos, program.GetCursorPos(), heldColour);
-					heldObject->AddVelocityAtPosition(program.GetDeltaTime() * (program.GetCursorPos() - startPos), startPos);
+					program.GetLineRenderer().DrawLineSegment(heldJoint->GetAnchorA(), program.GetCursorPos(), heldColour);
+					//only recorded when the cursor moves, so holding still doesn't fill up the log
+					if (heldJoint->GetTarget() != program.GetCursorPos())
+						program.GetCommandLog().SetJointTarget(heldJoint, program.GetCursorPos());
 				}
 				break;
 			case HELD_MODIFIER_TOOL::TRANSLATE:
 				if (heldObject != nullptr)
 				{
-					heldObject->SetPosition(program.GetCursorPos() + startingPosition);
+					program.GetCommandLog().SetPosition(heldObject, program.GetCursorPos() + startingPosition);
 				}
 				break;
 			case HELD_MODIFIER_TOOL::ROTATE:
 				if (heldObject != nullptr)
 				{
 					program.GetLineRenderer().DrawLineSegment(startingPosition, program.GetCursorPos(), heldColour);
-					heldObject->GetTransform().rotation = GetAngleOfVector2(glm::normalize(program.GetCursorPos() - startingPosition));
-					heldObject->GetTransform().UpdateData();
+					program.GetCommandLog().SetRotation(heldObject, GetAngleOfVector2(glm::normalize(program.GetCursorPos() - startingPosition)));
 				}
 				break;
 			case HELD_MODIFIER_TOOL::DELETE:
@@ -410,6 +415,7 @@ void PlayerInput::Render()
 
 void PlayerInput::OnMouseClick(int mouseButton)
 {
+	CommandLog& log = program.GetCommandLog();
 	switch (mouseButton)
 	{
 	case 1:
@@ -421,17 +427,26 @@ void PlayerInput::OnMouseClick(int mouseButton)
 				usingTool = true;
 				startingPosition = program.GetCursorPos();
 
+				heldShapeDesc = LoggedShape();
 				switch (heldShapeTool)
 				{
 				case HELD_SHAPE_TOOL::CIRCLE:
-					heldShape = new CircleShape(shapeRadius, Vector2(0, 0));
+					heldShapeDesc.type = LOGGED_SHAPE_TYPE::CIRCLE;
+					heldShapeDesc.radius = shapeRadius;
+					heldShape = CommandLog::BuildShape(heldShapeDesc);
 					break;
 				case HELD_SHAPE_TOOL::POLYGON:
-					heldShape = PolygonShape::GetRegularPolygonCollider(shapeRadius, polygonPointCount);
+					heldShapeDesc.type = LOGGED_SHAPE_TYPE::REGULAR_POLYGON;
+					heldShapeDesc.radius = shapeRadius;
+					heldShapeDesc.pointCount = polygonPointCount;
+					heldShape = CommandLog::BuildShape(heldShapeDesc);
 					break;
 				case HELD_SHAPE_TOOL::PLANE:
 					//it is at 0,0 because the shape position is relative to the transform position
-					heldShape = new PlaneShape(Vector2(0, 1), 0);
+					heldShapeDesc.type = LOGGED_SHAPE_TYPE::PLANE;
+					heldShapeDesc.a = Vector2(0, 1);
+					heldShapeDesc.radius = 0;
+					heldShape = CommandLog::BuildShape(heldShapeDesc);
 					break;
 				}
 			}
@@ -460,10 +475,10 @@ void PlayerInput::OnMouseClick(int mouseButton)
 
 					lastMass = heldObject->GetMass();
 					lastInertia = heldObject->GetInertia();
-					heldObject->SetInverseMass(0);
-					heldObject->SetInverseInertia(0);
-					heldObject->SetVelocity(Vector2(0, 0));
-					heldObject->SetAngularVelocity(0);
+					log.SetInverseMass(heldObject, 0);
+					log.SetInverseInertia(heldObject, 0);
+					log.SetVelocity(heldObject, Vector2(0, 0));
+					log.SetAngularVelocity(heldObject, 0);
 					startingPosition = heldObject->GetPosition() - startingPosition;
 					break;
 
@@ -479,21 +494,20 @@ void PlayerInput::OnMouseClick(int mouseButton)
 					
 					lastMass = heldObject->GetMass();
 					lastInertia = heldObject->GetInertia();
-					heldObject->SetInverseMass(0);
-					heldObject->SetInverseInertia(0);
-					heldObject->SetVelocity(Vector2(0, 0));
-					heldObject->SetAngularVelocity(0);
+					log.SetInverseMass(heldObject, 0);
+					log.SetInverseInertia(heldObject, 0);
+					log.SetVelocity(heldObject, Vector2(0, 0));
+					log.SetAngularVelocity(heldObject, 0);
 					break;
 				case HELD_MODIFIER_TOOL::GRAB:
-					//grab tool startingPosition will be relative to physicsObject transform, so it can be updated over time
-					//do something like program.GetCollisionManager().PointCast(startingPosition) to get an object under the cursor
+					//the object is pulled towards the cursor by a mouse joint, so it is solved with everything it's touching instead of fighting it
 					heldObject = program.GetObjectUnderPoint(startingPosition, false);
 					if (heldObject == nullptr)
 					{
 						usingTool = false;
 						return;
 					}
-					startingPosition = heldObject->GetTransform().InverseTransformPoint(startingPosition);
+					heldJoint = log.CreateMouseJoint(heldObject, startingPosition, GRAB_FORCE * heldObject->GetMass(), GRAB_FREQUENCY);
 					break;
 				case HELD_MODIFIER_TOOL::DELETE:
 					GameObject* gO = program.GetGameObjectUnderPoint(startingPosition, false);
@@ -512,6 +526,7 @@ void PlayerInput::OnMouseClick(int mouseButton)
 
 void PlayerInput::OnMouseRelease(int mouseButton)
 {
+	CommandLog& log = program.GetCommandLog();
 	switch (mouseButton)
 	{
 	case 1:
@@ -536,14 +551,10 @@ void PlayerInput::OnMouseRelease(int mouseButton)
 					true);
 
 
-				auto* pO = program.CreateGameObject(data, afterCreatedColour)->GetPhysicsObject();
-
-				pO->AddCollider(heldShape);
-				pO->AddVelocity((program.GetCursorPos() - startingPosition));
+				auto* pO = program.CreateGameObject(data, heldShapeDesc, afterCreatedColour)->GetPhysicsObject();
+				log.AddVelocity(pO, (program.GetCursorPos() - startingPosition));
 
-				if (heldShape->GetType() == SHAPE_TYPE::POLYGON)
-				{
-				}
+				delete heldShape;
 				heldShape = nullptr;
 			}
 			break;
@@ -554,7 +565,12 @@ void PlayerInput::OnMouseRelease(int mouseButton)
 					0,
 					false,
 					false);
-				program.CreateGameObject(data, afterCreatedColour)->GetPhysicsObject()->AddCollider(new CapsuleShape(startingPosition, program.GetCursorPos()));
+				LoggedShape shape;
+				shape.type = LOGGED_SHAPE_TYPE::CAPSULE;
+				shape.a = startingPosition;
+				shape.b = program.GetCursorPos();
+				shape.radius = 0.01f;
+				program.CreateGameObject(data, shape, afterCreatedColour);
 
 			}
 			break;
@@ -569,16 +585,19 @@ void PlayerInput::OnMouseRelease(int mouseButton)
 					GetAngleOfVector2(delta),
 					true,
 					true);
-				Shape* shape;
+				LoggedShape shape;
+				shape.radius = shapeRadius;
 				if (delta.x == 52 && delta.y == 0) //capsules NEED pA to be different from pB or they will not collide properly
 				{
-					shape = new CircleShape(shapeRadius, Vector2(0,0));
+					shape.type = LOGGED_SHAPE_TYPE::CIRCLE;
 				}
 				else {
-					shape = new CapsuleShape(Vector2(0, distance), -Vector2(0, distance), shapeRadius);
+					shape.type = LOGGED_SHAPE_TYPE::CAPSULE;
+					shape.a = Vector2(0, distance);
+					shape.b = -Vector2(0, distance);
 				}
 
-				program.CreateGameObject(data, afterCreatedColour)->GetPhysicsObject()->AddCollider(shape);
+				program.CreateGameObject(data, shape, afterCreatedColour);
 			}
 			break;
 			case HELD_SHAPE_TOOL::CREATEPOLYGON:
@@ -591,7 +610,7 @@ void PlayerInput::OnMouseRelease(int mouseButton)
 					delete heldShape;
 
 				customPolyPoints.push_back(program.GetCursorPos());
-				heldShape = new PolygonShape(&customPolyPoints[0], customPolyPoints.size());
+				heldShape = PolygonShape::Create(&customPolyPoints[0], customPolyPoints.size());
 				break;
 			}
 			
@@ -615,17 +634,18 @@ void PlayerInput::OnMouseRelease(int mouseButton)
 			switch (heldModifierTool)
 			{
 			case HELD_MODIFIER_TOOL::LAUNCH:
-				heldObject->SetInverseMass(lastMass);
-				heldObject->SetInverseInertia(lastInertia);
-				heldObject->AddImpulseAtPosition((program.GetCursorPos() - startingPosition) / heldObject->GetInverseMass(), program.GetCursorPos());
+				log.SetInverseMass(heldObject, lastMass);
+				log.SetInverseInertia(heldObject, lastInertia);
+				log.AddImpulseAtPosition(heldObject, (program.GetCursorPos() - startingPosition) / heldObject->GetInverseMass(), program.GetCursorPos());
 				heldObject = nullptr;
 				break;
 			case HELD_MODIFIER_TOOL::GRAB:
+				ReleaseGrab();
 				break;
 			case HELD_MODIFIER_TOOL::TRANSLATE:
 			case HELD_MODIFIER_TOOL::ROTATE:
-				heldObject->SetInverseMass(lastMass);
-				heldObject->SetInverseInertia(lastInertia);
+				log.SetInverseMass(heldObject, lastMass);
+				log.SetInverseInertia(heldObject, lastInertia);
 				heldObject = nullptr;
 				break;
 			case HELD_MODIFIER_TOOL::DELETE:
@@ -637,68 +657,21 @@ void PlayerInput::OnMouseRelease(int mouseButton)
 					secondHighlighted->colour = afterCreatedColour;
 					if (!heldObject) return;
 
-					secondHighlighted->GetPhysicsObject()->SetVelocity(Vector2(0, 0));
-					secondHighlighted->GetPhysicsObject()->SetAngularVelocity(0);
+					log.SetVelocity(secondHighlighted->GetPhysicsObject(), Vector2(0, 0));
+					log.SetAngularVelocity(secondHighlighted->GetPhysicsObject(), 0);
 					
 					if (secondHighlighted->GetPhysicsObject() == heldObject) {
 						secondHighlighted = nullptr;
 						break;
 					}
-					auto* body = secondHighlighted->GetPhysicsObject();
-					for (unsigned char i = 0; i < body->GetColliderCount(); i++)
-					{
-						Collider& c = body->GetCollider(i);
-						Shape* s;
-						switch (c.GetShape()->GetType()) {
-						case SHAPE_TYPE::CIRCLE:
-						{
-							CircleShape* cS = (CircleShape*)c.GetShape()->Clone();
-							Vector2 newCentrePoint = heldObject->GetTransform().InverseTransformPoint(body->GetTransform().TransformPoint(cS->centrePoint));
-							cS->centrePoint = newCentrePoint;
-
-							s = cS;
-						}
-							break;
-						case SHAPE_TYPE::POLYGON:
-						{
-							PolygonShape* pS = (PolygonShape*)c.GetShape()->Clone();
-							for (size_t i = 0; i < pS->pointCount; i++)
-							{
-								Vector2 newPoint = heldObject->GetTransform().InverseTransformPoint(body->GetTransform().TransformPoint(pS->points[i]));
-								pS->points[i]= newPoint;
-							}
-							Vector2 newCentrePoint = heldObject->GetTransform().InverseTransformPoint(body->GetTransform().TransformPoint(pS->centrePoint));
-							pS->centrePoint = newCentrePoint;
-							
-
-							s = pS;
-						}
-							break;
-						case SHAPE_TYPE::CAPSULE:
-						{
-							CapsuleShape* cS = (CapsuleShape*)c.GetShape()->Clone();
-							Vector2 newPoint = heldObject->GetTransform().InverseTransformPoint(body->GetTransform().TransformPoint(cS->pointA));
-							cS->pointA = newPoint;
-							newPoint = heldObject->GetTransform().InverseTransformPoint(body->GetTransform().TransformPoint(cS->pointB));
-							cS->pointB = newPoint;
-
-							s = cS;
-						}
-							break;
-						default:
-							s = c.GetShape()->Clone();
-							break;
-						}
-
-						heldObject->AddCollider(s, c.GetDensity()); //no need to check trigger since the pointCast used does not check trigger
-					}
-					program.DeleteGameObject(secondHighlighted);
+					//this also deletes the second object
+					log.MergeBodies(heldObject, secondHighlighted->GetPhysicsObject());
 					secondHighlighted = nullptr;
 				}
 
 				if (!heldObject) return;
-				heldObject->SetInverseMass(lastMass);
-				heldObject->SetInverseInertia(lastInertia);
+				log.SetInverseMass(heldObject, lastMass);
+				log.SetInverseInertia(heldObject, lastInertia);
 				heldObject = nullptr;
 			}
 			}
@@ -709,6 +682,16 @@ void PlayerInput::OnMouseRelease(int mouseButton)
 	}
 }
 
+void PlayerInput::ReleaseGrab()
+{
+	if (heldJoint != nullptr)
+	{
+		program.GetCommandLog().DeleteJoint(heldJoint);
+		heldJoint = nullptr;
+		heldObject = nullptr;
+	}
+}
+
 void PlayerInput::SetHeldShapeTool(HELD_SHAPE_TOOL type)
 {
 	if (heldShape != nullptr)
@@ -716,6 +699,7 @@ void PlayerInput::SetHeldShapeTool(HELD_SHAPE_TOOL type)
 		delete heldShape;
 		heldShape = nullptr;
 	}
+	ReleaseGrab();
 	usingTool = false;
 
 	this->heldShapeTool = type;
@@ -741,6 +725,7 @@ void PlayerInput::SetHeldModifierTool(HELD_MODIFIER_TOOL type)
 		highlighted->colour = afterCreatedColour;
 		highlighted = nullptr;
 	}
+	ReleaseGrab();
 	usingTool = false;
 
 	this->heldModifierTool = type;
@@ -774,6 +759,7 @@ void PlayerInput::OnKeyPressed(int key)
 			delete heldShape;
 			heldShape = nullptr;
 		}
+		ReleaseGrab();
 		usingTool = false;
 		break;
 	case GLFW_KEY_R:
@@ -782,6 +768,7 @@ void PlayerInput::OnKeyPressed(int key)
 			delete heldShape;
 			heldShape = nullptr;
 		}
+		ReleaseGrab();
 		usingTool = false;
 		ClearPhysicsObjects(*speedUpButton, &program);
 		break;
@@ -795,6 +782,13 @@ void PlayerInput::OnKeyPressed(int key)
 	case GLFW_KEY_SLASH:
 		StepOnce(*speedUpButton, &program);
 		break;
+	case GLFW_KEY_F5:
+		//can be played back with the Replay project
+		if (program.GetCommandLog().Save("session.fzxlog"))
+			std::cout << "saved session.fzxlog (" << program.GetCommandLog().GetTick() << " ticks)" << std::endl;
+		else
+			std::cout << "couldn't save session.fzxlog" << std::endl;
+		break;
 	}
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "Maths.h"
 #include "GameObject.h"
+#include "CommandLog.h"
 #include "Button.h"
 #include "Slider.h"
 
@@ -50,6 +51,8 @@ public:
 
 	void SetHeldModifierTool(HELD_MODIFIER_TOOL type);
 	HELD_MODIFIER_TOOL GetHeldModifierTool() { return heldModifierTool; };
+	//lets go of whatever the grab tool is holding
+	void ReleaseGrab();
 
 	Button* GetStepForwardButton() { return stepForwardButton; };
 
@@ -68,7 +71,9 @@ private:
 	Vector3 afterCreatedColour = Vector3(0.8f, 1.0f, 0.8f);
 	Vector3 highlightedColour = Vector3(1.0f, 0.6f, 0.6f);
 	Vector3 heldColour = Vector3(0.6f, 0.6f, 0.6f);
+	//only for drawing, the real one is made from heldShapeDesc by the command log
 	Shape* heldShape = nullptr;
+	LoggedShape heldShapeDesc;
 
 	//UI Object references
 	std::vector<Button*> shapeButtons;
@@ -91,6 +96,8 @@ private:
 	GameObject* highlighted = nullptr;
 	GameObject* secondHighlighted = nullptr; //pretty much just used for merge tool
 	PhysicsObject* heldObject = nullptr;
+	//pulls heldObject towards the cursor while grabbing
+	Joint* heldJoint = nullptr;
 
 	static void SwitchToCircle(Button& button, void* infoPointer);
 	static void SwitchToPolygon(Button& button, void* infoPointer);
@@ -0,0 +1,152 @@
+#include "fzx.h"
+
+//SSE2 is always there on x64, and on x86 when it is turned on. FZX_NO_SIMD forces the scalar path
+//the kernels only work on floats, so double precision builds use the scalar path too
+#if !defined(FZX_NO_SIMD) && !defined(FZX_DOUBLE_PRECISION) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FZX_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace fzx
+{
+	//the scalar versions, used for the leftover pairs that don't fill a whole group (or everything if there is no SIMD)
+	//these do exactly the same maths as CollideCircleCircle and CollideCirclePlane, including giving circles exactly on top of each other a normal of (0, 1)
+	static inline bool CircleCircleContact(const CircleBatch& batch, size_t i, CircleContact& contact)
+	{
+		Real deltaX = batch.ax[i] - batch.bx[i];
+		Real deltaY = batch.ay[i] - batch.by[i];
+		Real deltaMagSq = deltaX * deltaX + deltaY * deltaY;
+		Real radiusSum = batch.aRadius[i] + batch.bRadius[i];
+		if (deltaMagSq >= radiusSum * radiusSum)
+			return false;
+
+		Real deltaMag = em::Sqrt(deltaMagSq);
+		//exactly on top of each other, so just pick a direction
+		if (deltaMag == 0)
+			contact.normal = Vector2(0, 1);
+		else
+			contact.normal = Vector2(deltaX / deltaMag, deltaY / deltaMag);
+		contact.penetration = radiusSum - deltaMag;
+		contact.point = Vector2(batch.ax[i], batch.ay[i]) - contact.normal * batch.aRadius[i];
+		contact.pairIndex = (unsigned int)i;
+		return true;
+	}
+
+	static inline bool CirclePlaneContact(const CircleBatch& batch, size_t i, CircleContact& contact)
+	{
+		Real penetration = batch.ax[i] * batch.bx[i] + batch.ay[i] * batch.by[i] - batch.aRadius[i] - batch.bRadius[i];
+		if (penetration >= 0)
+			return false;
+
+		contact.normal = Vector2(batch.bx[i], batch.by[i]);
+		contact.penetration = -penetration;
+		contact.point = Vector2(batch.ax[i], batch.ay[i]) - contact.normal * batch.aRadius[i];
+		contact.pairIndex = (unsigned int)i;
+		return true;
+	}
+
+#ifdef FZX_SSE2
+	//copies out the lanes that hit into compact contacts
+	static inline size_t WriteContacts(int hitMask, size_t first, __m128 normalX, __m128 normalY, __m128 pointX, __m128 pointY, __m128 penetration, CircleContact* contacts)
+	{
+		alignas(16) float nX[4], nY[4], pX[4], pY[4], pen[4];
+		_mm_store_ps(nX, normalX);
+		_mm_store_ps(nY, normalY);
+		_mm_store_ps(pX, pointX);
+		_mm_store_ps(pY, pointY);
+		_mm_store_ps(pen, penetration);
+
+		size_t written = 0;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (!(hitMask & (1 << lane)))
+				continue;
+			CircleContact& contact = contacts[written++];
+			contact.normal = Vector2(nX[lane], nY[lane]);
+			contact.point = Vector2(pX[lane], pY[lane]);
+			contact.penetration = pen[lane];
+			contact.pairIndex = (unsigned int)(first + lane);
+		}
+		return written;
+	}
+#endif
+
+	size_t PhysicsSystem::CollideCircleCircleBatch(const CircleBatch& batch, size_t count, CircleContact* contacts)
+	{
+		size_t contactCount = 0;
+		size_t i = 0;
+#ifdef FZX_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 ax = _mm_loadu_ps(&batch.ax[i]);
+			__m128 ay = _mm_loadu_ps(&batch.ay[i]);
+			__m128 deltaX = _mm_sub_ps(ax, _mm_loadu_ps(&batch.bx[i]));
+			__m128 deltaY = _mm_sub_ps(ay, _mm_loadu_ps(&batch.by[i]));
+			__m128 deltaMagSq = _mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY));
+			__m128 aRadius = _mm_loadu_ps(&batch.aRadius[i]);
+			__m128 radiusSum = _mm_add_ps(aRadius, _mm_loadu_ps(&batch.bRadius[i]));
+
+			int hitMask = _mm_movemask_ps(_mm_cmplt_ps(deltaMagSq, _mm_mul_ps(radiusSum, radiusSum)));
+			//most pairs from the broadphase aren't actually touching, so skip the rest when none of them are
+			if (!hitMask)
+				continue;
+
+			__m128 deltaMag = _mm_sqrt_ps(deltaMagSq);
+			//lanes with a distance of 0 get (0, 1), same as the scalar version
+			//dividing (instead of multiplying by the reciprocal) gives exactly the scalar result, so it doesn't matter which lane a pair lands in
+			__m128 onTop = _mm_cmpeq_ps(deltaMag, zero);
+			__m128 normalX = _mm_andnot_ps(onTop, _mm_div_ps(deltaX, deltaMag));
+			__m128 normalY = _mm_or_ps(_mm_andnot_ps(onTop, _mm_div_ps(deltaY, deltaMag)), _mm_and_ps(onTop, one));
+
+			__m128 penetration = _mm_sub_ps(radiusSum, deltaMag);
+			__m128 pointX = _mm_sub_ps(ax, _mm_mul_ps(normalX, aRadius));
+			__m128 pointY = _mm_sub_ps(ay, _mm_mul_ps(normalY, aRadius));
+
+			contactCount += WriteContacts(hitMask, i, normalX, normalY, pointX, pointY, penetration, contacts + contactCount);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			if (CircleCircleContact(batch, i, contacts[contactCount]))
+				contactCount++;
+		}
+		return contactCount;
+	}
+
+	size_t PhysicsSystem::CollideCirclePlaneBatch(const CircleBatch& batch, size_t count, CircleContact* contacts)
+	{
+		size_t contactCount = 0;
+		size_t i = 0;
+#ifdef FZX_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 ax = _mm_loadu_ps(&batch.ax[i]);
+			__m128 ay = _mm_loadu_ps(&batch.ay[i]);
+			__m128 normalX = _mm_loadu_ps(&batch.bx[i]);
+			__m128 normalY = _mm_loadu_ps(&batch.by[i]);
+			__m128 aRadius = _mm_loadu_ps(&batch.aRadius[i]);
+
+			__m128 centreDot = _mm_add_ps(_mm_mul_ps(ax, normalX), _mm_mul_ps(ay, normalY));
+			__m128 penetration = _mm_sub_ps(_mm_sub_ps(centreDot, aRadius), _mm_loadu_ps(&batch.bRadius[i]));
+
+			int hitMask = _mm_movemask_ps(_mm_cmplt_ps(penetration, zero));
+			if (!hitMask)
+				continue;
+
+			__m128 pointX = _mm_sub_ps(ax, _mm_mul_ps(normalX, aRadius));
+			__m128 pointY = _mm_sub_ps(ay, _mm_mul_ps(normalY, aRadius));
+
+			contactCount += WriteContacts(hitMask, i, normalX, normalY, pointX, pointY, _mm_sub_ps(zero, penetration), contacts + contactCount);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			if (CirclePlaneContact(batch, i, contacts[contactCount]))
+				contactCount++;
+		}
+		return contactCount;
+	}
+}
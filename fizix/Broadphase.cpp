@@ -0,0 +1,484 @@
+#include "fzx.h"
+#include <algorithm>
+
+namespace fzx
+{
+	static bool AABBOverlap(const AABB& a, const AABB& b)
+	{
+		return a.min.x < b.max.x && a.min.y < b.max.y
+			&& a.max.x > b.min.x && a.max.y > b.min.y;
+	}
+
+	static AABB AABBUnion(const AABB& a, const AABB& b)
+	{
+		return { glm::max(a.max, b.max), glm::min(a.min, b.min) };
+	}
+
+	//slab test, inverseDirection can have infinite components
+	static bool RayOverlap(const AABB& aabb, Vector2 origin, Vector2 inverseDirection, Real maxDistance)
+	{
+		Vector2 t1 = (aabb.min - origin) * inverseDirection;
+		Vector2 t2 = (aabb.max - origin) * inverseDirection;
+		Vector2 tMin = glm::min(t1, t2), tMax = glm::max(t1, t2);
+
+		Real enter = glm::max(glm::max(tMin.x, tMin.y), (Real)0);
+		Real exit = glm::min(glm::min(tMax.x, tMax.y), maxDistance);
+		//NaN (ray exactly on the edge of a slab) fails both comparisons, so treat that as overlapping too
+		return !(enter > exit);
+	}
+
+	static bool IsUnbounded(const AABB& aabb)
+	{
+		return isinf(aabb.max.x) || isinf(aabb.max.y) || isinf(aabb.min.x) || isinf(aabb.min.y);
+	}
+
+	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	// AABB TREE
+	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+	void AABBTree::Build(PhysicsObject** bodies, size_t count)
+	{
+		nodes.clear();
+		collisionLayers = 0;
+		collisionMasks = 0;
+		if (count == 0)
+			return;
+
+		//a binary tree with n leaves always has n - 1 internal nodes
+		nodes.reserve(count * 2 - 1);
+		BuildNode(bodies, count);
+	}
+
+	int AABBTree::BuildNode(PhysicsObject** bodies, size_t count)
+	{
+		int index = (int)nodes.size();
+		nodes.emplace_back();
+
+		if (count == 1)
+		{
+			Node& leaf = nodes[index];
+			leaf.aabb = bodies[0]->GetAABB();
+			leaf.left = -1;
+			leaf.right = -1;
+			leaf.body = bodies[0];
+			collisionLayers |= bodies[0]->GetCollisionLayers();
+			collisionMasks |= bodies[0]->GetCollisionMasks();
+			return index;
+		}
+
+		//split along the longest axis of the centre points, at the median
+		Vector2 centreMax = (Real)0.5 * (bodies[0]->GetAABB().max + bodies[0]->GetAABB().min);
+		Vector2 centreMin = centreMax;
+		for (size_t i = 1; i < count; i++)
+		{
+			Vector2 centre = (Real)0.5 * (bodies[i]->GetAABB().max + bodies[i]->GetAABB().min);
+			centreMax = glm::max(centreMax, centre);
+			centreMin = glm::min(centreMin, centre);
+		}
+		int axis = (centreMax.x - centreMin.x) >= (centreMax.y - centreMin.y) ? 0 : 1;
+
+		size_t half = count / 2;
+		std::nth_element(bodies, bodies + half, bodies + count, [axis](PhysicsObject* a, PhysicsObject* b)
+			{
+				Real centreA = a->GetAABB().max[axis] + a->GetAABB().min[axis];
+				Real centreB = b->GetAABB().max[axis] + b->GetAABB().min[axis];
+				//ties are broken by ID so the tree doesn't depend on the order bodies were given in
+				return centreA < centreB || (centreA == centreB && a->GetID() < b->GetID());
+			});
+
+		int left = BuildNode(bodies, half);
+		int right = BuildNode(bodies + half, count - half);
+
+		//nodes may have been reallocated, so don't keep a reference from before building the children
+		Node& node = nodes[index];
+		node.left = left;
+		node.right = right;
+		node.body = nullptr;
+		node.aabb = AABBUnion(nodes[left].aabb, nodes[right].aabb);
+		return index;
+	}
+
+	void AABBTree::Refit()
+	{
+		collisionLayers = 0;
+		collisionMasks = 0;
+
+		//children are always after their parents, so going backwards updates children first
+		for (int i = (int)nodes.size() - 1; i >= 0; i--)
+		{
+			Node& node = nodes[i];
+			if (node.body)
+			{
+				node.aabb = node.body->GetAABB();
+				collisionLayers |= node.body->GetCollisionLayers();
+				collisionMasks |= node.body->GetCollisionMasks();
+			}
+			else
+				node.aabb = AABBUnion(nodes[node.left].aabb, nodes[node.right].aabb);
+		}
+	}
+
+	void AABBTree::Clear()
+	{
+		nodes.clear();
+		collisionLayers = 0;
+		collisionMasks = 0;
+	}
+
+	bool AABBTree::Query(const AABB& aabb, BroadphaseCallback callback, void* infoPtr)
+	{
+		if (nodes.empty())
+			return true;
+
+		//explicit stack instead of recursion, the tree is balanced so 64 is plenty
+		int stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			Node& node = nodes[stack[--stackSize]];
+			if (!AABBOverlap(node.aabb, aabb))
+				continue;
+
+			if (node.body)
+			{
+				if (!callback(node.body, infoPtr))
+					return false;
+			}
+			else
+			{
+				stack[stackSize++] = node.right;
+				stack[stackSize++] = node.left;
+			}
+		}
+		return true;
+	}
+
+	Real AABBTree::RayCast(Vector2 origin, Vector2 direction, Real maxDistance, BroadphaseRayCallback callback, void* infoPtr)
+	{
+		if (nodes.empty())
+			return maxDistance;
+
+		Vector2 inverseDirection = Vector2(1.0f / direction.x, 1.0f / direction.y);
+
+		int stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			Node& node = nodes[stack[--stackSize]];
+			if (!RayOverlap(node.aabb, origin, inverseDirection, maxDistance))
+				continue;
+
+			if (node.body)
+			{
+				maxDistance = callback(node.body, infoPtr);
+				if (maxDistance <= 0)
+					break;
+			}
+			else
+			{
+				stack[stackSize++] = node.right;
+				stack[stackSize++] = node.left;
+			}
+		}
+		return maxDistance;
+	}
+
+	void AABBTree::FindPairs(BroadphasePairCallback callback, void* infoPtr)
+	{
+		if (nodes.size() > 1)
+			FindPairs(0, callback, infoPtr);
+	}
+
+	void AABBTree::FindPairs(AABBTree& other, BroadphasePairCallback callback, void* infoPtr)
+	{
+		if (!nodes.empty() && !other.nodes.empty())
+			FindPairs(*this, 0, other, 0, callback, infoPtr);
+	}
+
+	void AABBTree::FindPairs(int node, BroadphasePairCallback callback, void* infoPtr)
+	{
+		Node& n = nodes[node];
+		if (n.body)
+			return;
+
+		//pairs inside each child, then pairs between the two children
+		FindPairs(n.left, callback, infoPtr);
+		FindPairs(n.right, callback, infoPtr);
+		FindPairs(*this, n.left, *this, n.right, callback, infoPtr);
+	}
+
+	void AABBTree::FindPairs(AABBTree& a, int nodeA, AABBTree& b, int nodeB, BroadphasePairCallback callback, void* infoPtr)
+	{
+		Node& nA = a.nodes[nodeA];
+		Node& nB = b.nodes[nodeB];
+		if (!AABBOverlap(nA.aabb, nB.aabb))
+			return;
+
+		if (nA.body && nB.body)
+		{
+			callback(nA.body, nB.body, infoPtr);
+		}
+		else if (nB.body || (!nA.body && nA.aabb.max.x - nA.aabb.min.x + nA.aabb.max.y - nA.aabb.min.y > nB.aabb.max.x - nB.aabb.min.x + nB.aabb.max.y - nB.aabb.min.y))
+		{
+			//descend into the bigger node
+			FindPairs(a, nA.left, b, nodeB, callback, infoPtr);
+			FindPairs(a, nA.right, b, nodeB, callback, infoPtr);
+		}
+		else
+		{
+			FindPairs(a, nodeA, b, nB.left, callback, infoPtr);
+			FindPairs(a, nodeA, b, nB.right, callback, infoPtr);
+		}
+	}
+
+	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	// BROADPHASE
+	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+	int Broadphase::GetLayerIndex(unsigned short collisionLayers)
+	{
+		//bodies go in the tree of their lowest layer
+		for (int i = 0; i < LAYER_COUNT; i++)
+		{
+			if (collisionLayers & (1 << i))
+				return i;
+		}
+		return 0;
+	}
+
+	bool Broadphase::CanLayersCollide(unsigned short layersA, unsigned short masksA, unsigned short layersB, unsigned short masksB)
+	{
+		return (layersA & masksB) && (layersB & masksA);
+	}
+
+	void Broadphase::Build(std::vector<PhysicsObject*>& bodies)
+	{
+		BuildTier(movingTier, bodies);
+	}
+
+	void Broadphase::BuildStatic(std::vector<PhysicsObject*>& bodies)
+	{
+		BuildTier(staticTier, bodies);
+	}
+
+	void Broadphase::BuildKinematic(std::vector<PhysicsObject*>& bodies)
+	{
+		BuildTier(kinematicTier, bodies);
+	}
+
+	void Broadphase::BuildTier(Tier& tier, std::vector<PhysicsObject*>& bodies)
+	{
+		tier.unbounded.clear();
+		for (int i = 0; i < LAYER_COUNT; i++)
+			layerBodies[i].clear();
+
+		for (auto* body : bodies)
+		{
+			if (body->GetColliderCount() == 0)
+				continue;
+
+			if (IsUnbounded(body->GetAABB()))
+				tier.unbounded.push_back(body);
+			else
+				layerBodies[GetLayerIndex(body->GetCollisionLayers())].push_back(body);
+		}
+
+		for (int i = 0; i < LAYER_COUNT; i++)
+		{
+			if (layerBodies[i].empty())
+				tier.trees[i].Clear();
+			else
+				tier.trees[i].Build(&layerBodies[i][0], layerBodies[i].size());
+		}
+	}
+
+	void Broadphase::Refit()
+	{
+		RefitTier(movingTier);
+	}
+
+	void Broadphase::RefitKinematic()
+	{
+		RefitTier(kinematicTier);
+	}
+
+	void Broadphase::RefitTier(Tier& tier)
+	{
+		for (int i = 0; i < LAYER_COUNT; i++)
+		{
+			if (!tier.trees[i].IsEmpty())
+				tier.trees[i].Refit();
+		}
+	}
+
+	void Broadphase::ClearTier(Tier& tier)
+	{
+		tier.unbounded.clear();
+		for (int i = 0; i < LAYER_COUNT; i++)
+			tier.trees[i].Clear();
+	}
+
+	void Broadphase::Clear()
+	{
+		ClearTier(movingTier);
+		ClearTier(staticTier);
+		ClearTier(kinematicTier);
+	}
+
+	struct UnboundedPairInfo
+	{
+		PhysicsObject* body;
+		BroadphasePairCallback callback;
+		void* infoPtr;
+	};
+
+	static bool UnboundedPairCallback(PhysicsObject* body, void* infoPtr)
+	{
+		UnboundedPairInfo* info = (UnboundedPairInfo*)infoPtr;
+		info->callback(info->body, body, info->infoPtr);
+		return true;
+	}
+
+	void Broadphase::FindUnboundedPairs(PhysicsObject* body, Tier& tier, BroadphasePairCallback callback, void* infoPtr)
+	{
+		UnboundedPairInfo info = { body, callback, infoPtr };
+		for (int i = 0; i < LAYER_COUNT; i++)
+		{
+			AABBTree& tree = tier.trees[i];
+			if (!tree.IsEmpty() && CanLayersCollide(body->GetCollisionLayers(), body->GetCollisionMasks(), tree.GetCollisionLayers(), tree.GetCollisionMasks()))
+				tree.Query(body->GetAABB(), UnboundedPairCallback, &info);
+		}
+	}
+
+	void Broadphase::FindPairs(BroadphasePairCallback callback, void* infoPtr, bool kinematicPairs)
+	{
+		FindPairs(movingTier, callback, infoPtr);
+		FindPairs(movingTier, kinematicTier, callback, infoPtr);
+		FindPairs(movingTier, staticTier, callback, infoPtr);
+		if (kinematicPairs)
+		{
+			FindPairs(kinematicTier, callback, infoPtr);
+			FindPairs(kinematicTier, staticTier, callback, infoPtr);
+		}
+	}
+
+	void Broadphase::FindPairs(Tier& tier, BroadphasePairCallback callback, void* infoPtr)
+	{
+		//trees are only paired if the layers inside them can collide at all
+		for (int i = 0; i < LAYER_COUNT; i++)
+		{
+			AABBTree& a = tier.trees[i];
+			if (a.IsEmpty())
+				continue;
+
+			for (int j = i; j < LAYER_COUNT; j++)
+			{
+				AABBTree& b = tier.trees[j];
+				if (b.IsEmpty() || !CanLayersCollide(a.GetCollisionLayers(), a.GetCollisionMasks(), b.GetCollisionLayers(), b.GetCollisionMasks()))
+					continue;
+
+				if (i == j)
+					a.FindPairs(callback, infoPtr);
+				else
+					a.FindPairs(b, callback, infoPtr);
+			}
+		}
+
+		for (size_t i = 0; i < tier.unbounded.size(); i++)
+		{
+			PhysicsObject* body = tier.unbounded[i];
+			for (size_t j = i + 1; j < tier.unbounded.size(); j++)
+			{
+				callback(body, tier.unbounded[j], infoPtr);
+			}
+			FindUnboundedPairs(body, tier, callback, infoPtr);
+		}
+	}
+
+	void Broadphase::FindPairs(Tier& a, Tier& b, BroadphasePairCallback callback, void* infoPtr)
+	{
+		for (int i = 0; i < LAYER_COUNT; i++)
+		{
+			AABBTree& treeA = a.trees[i];
+			if (treeA.IsEmpty())
+				continue;
+
+			//every layer in the other tier, since the same layer in both can collide too
+			for (int j = 0; j < LAYER_COUNT; j++)
+			{
+				AABBTree& treeB = b.trees[j];
+				if (!treeB.IsEmpty() && CanLayersCollide(treeA.GetCollisionLayers(), treeA.GetCollisionMasks(), treeB.GetCollisionLayers(), treeB.GetCollisionMasks()))
+					treeA.FindPairs(treeB, callback, infoPtr);
+			}
+		}
+
+		for (auto* body : a.unbounded)
+		{
+			for (auto* other : b.unbounded)
+				callback(body, other, infoPtr);
+			FindUnboundedPairs(body, b, callback, infoPtr);
+		}
+		for (auto* body : b.unbounded)
+			FindUnboundedPairs(body, a, callback, infoPtr);
+	}
+
+	bool Broadphase::Query(const AABB& aabb, BroadphaseCallback callback, void* infoPtr, unsigned short collisionMask)
+	{
+		return Query(movingTier, aabb, callback, infoPtr, collisionMask) && Query(kinematicTier, aabb, callback, infoPtr, collisionMask)
+			&& Query(staticTier, aabb, callback, infoPtr, collisionMask);
+	}
+
+	bool Broadphase::Query(Tier& tier, const AABB& aabb, BroadphaseCallback callback, void* infoPtr, unsigned short collisionMask)
+	{
+		for (int i = 0; i < LAYER_COUNT; i++)
+		{
+			if (!tier.trees[i].IsEmpty() && (tier.trees[i].GetCollisionLayers() & collisionMask) && !tier.trees[i].Query(aabb, callback, infoPtr))
+				return false;
+		}
+
+		for (auto* body : tier.unbounded)
+		{
+			if ((body->GetCollisionLayers() & collisionMask) && AABBOverlap(body->GetAABB(), aabb) && !callback(body, infoPtr))
+				return false;
+		}
+		return true;
+	}
+
+	Real Broadphase::RayCast(Vector2 origin, Vector2 direction, Real maxDistance, BroadphaseRayCallback callback, void* infoPtr, unsigned short collisionMask)
+	{
+		//planes first, since they are cheap and can clip the ray before going into the trees
+		for (auto* body : movingTier.unbounded)
+		{
+			if (body->GetCollisionLayers() & collisionMask)
+				maxDistance = callback(body, infoPtr);
+		}
+		for (auto* body : kinematicTier.unbounded)
+		{
+			if (body->GetCollisionLayers() & collisionMask)
+				maxDistance = callback(body, infoPtr);
+		}
+		for (auto* body : staticTier.unbounded)
+		{
+			if (body->GetCollisionLayers() & collisionMask)
+				maxDistance = callback(body, infoPtr);
+		}
+
+		maxDistance = RayCast(movingTier, origin, direction, maxDistance, callback, infoPtr, collisionMask);
+		maxDistance = RayCast(kinematicTier, origin, direction, maxDistance, callback, infoPtr, collisionMask);
+		return RayCast(staticTier, origin, direction, maxDistance, callback, infoPtr, collisionMask);
+	}
+
+	Real Broadphase::RayCast(Tier& tier, Vector2 origin, Vector2 direction, Real maxDistance, BroadphaseRayCallback callback, void* infoPtr, unsigned short collisionMask)
+	{
+		for (int i = 0; i < LAYER_COUNT; i++)
+		{
+			if (!tier.trees[i].IsEmpty() && (tier.trees[i].GetCollisionLayers() & collisionMask))
+				maxDistance = tier.trees[i].RayCast(origin, direction, maxDistance, callback, infoPtr);
+		}
+		return maxDistance;
+	}
+}
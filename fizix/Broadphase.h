@@ -0,0 +1,111 @@
+#pragma once
+#include "Maths.h"
+#include "Shape.h"
+#include <vector>
+
+namespace fzx
+{
+	class PhysicsObject;
+
+	//return false to stop the query early
+	typedef bool (*BroadphaseCallback)(PhysicsObject* body, void* infoPtr);
+	typedef void (*BroadphasePairCallback)(PhysicsObject* a, PhysicsObject* b, void* infoPtr);
+	//returns the new max distance of the ray, so later bodies further away than the closest hit are skipped
+	typedef Real (*BroadphaseRayCallback)(PhysicsObject* body, void* infoPtr);
+
+	//bounding volume hierarchy over body AABBs.
+	//it is built top down when bodies are added or removed, and refit (same structure, new bounds) when they move
+	class AABBTree
+	{
+	public:
+		void Build(PhysicsObject** bodies, size_t count);
+		void Refit();
+		void Clear();
+
+		//returns false if the callback stopped the query
+		bool Query(const AABB& aabb, BroadphaseCallback callback, void* infoPtr);
+		//direction must be normalised. returns the max distance after every callback has clipped it
+		Real RayCast(Vector2 origin, Vector2 direction, Real maxDistance, BroadphaseRayCallback callback, void* infoPtr);
+		//every overlapping pair inside this tree, once each
+		void FindPairs(BroadphasePairCallback callback, void* infoPtr);
+		//every overlapping pair between this tree and another
+		void FindPairs(AABBTree& other, BroadphasePairCallback callback, void* infoPtr);
+
+		inline bool IsEmpty() { return nodes.empty(); }
+		inline size_t GetBodyCount() { return (nodes.size() + 1) / 2; }
+		//union of the collision layers and masks of every body in the tree
+		inline unsigned short GetCollisionLayers() { return collisionLayers; }
+		inline unsigned short GetCollisionMasks() { return collisionMasks; }
+
+	private:
+		struct Node
+		{
+			AABB aabb;
+			//children are always stored after their parent, so refitting can go backwards through the array
+			int left;
+			int right;
+			//only leaves have a body
+			PhysicsObject* body;
+		};
+
+		int BuildNode(PhysicsObject** bodies, size_t count);
+		void FindPairs(int node, BroadphasePairCallback callback, void* infoPtr);
+		static void FindPairs(AABBTree& a, int nodeA, AABBTree& b, int nodeB, BroadphasePairCallback callback, void* infoPtr);
+
+		std::vector<Node> nodes;
+		unsigned short collisionLayers = 0;
+		unsigned short collisionMasks = 0;
+	};
+
+	//splits bodies into one tree per collision layer, so whole layers that can't collide with each other (or themselves) are never paired.
+	//static and kinematic bodies are kept in their own trees, which are only paired with the dynamic bodies' trees (and each other, for triggers).
+	//the static trees are only rebuilt when one of them changes, and the kinematic ones are refit when they move
+	class Broadphase
+	{
+	public:
+		constexpr static int LAYER_COUNT = 16;
+
+		//bodies with an infinite AABB (planes) are kept out of the trees and tested against everything
+		void Build(std::vector<PhysicsObject*>& bodies);
+		void BuildStatic(std::vector<PhysicsObject*>& bodies);
+		void BuildKinematic(std::vector<PhysicsObject*>& bodies);
+		//only refits the dynamic bodies' trees
+		void Refit();
+		void RefitKinematic();
+		void Clear();
+
+		//kinematic bodies only need pairing with static and other kinematic bodies when triggers are being looked for
+		void FindPairs(BroadphasePairCallback callback, void* infoPtr, bool kinematicPairs);
+		bool Query(const AABB& aabb, BroadphaseCallback callback, void* infoPtr, unsigned short collisionMask = 0xFFFF);
+		Real RayCast(Vector2 origin, Vector2 direction, Real maxDistance, BroadphaseRayCallback callback, void* infoPtr, unsigned short collisionMask = 0xFFFF);
+
+	private:
+		//one tree per layer, and the unbounded bodies
+		struct Tier
+		{
+			AABBTree trees[LAYER_COUNT];
+			std::vector<PhysicsObject*> unbounded;
+		};
+
+		static int GetLayerIndex(unsigned short collisionLayers);
+		static bool CanLayersCollide(unsigned short layersA, unsigned short masksA, unsigned short layersB, unsigned short masksB);
+
+		void BuildTier(Tier& tier, std::vector<PhysicsObject*>& bodies);
+		static void ClearTier(Tier& tier);
+		static void RefitTier(Tier& tier);
+		//pairs inside one tier
+		static void FindPairs(Tier& tier, BroadphasePairCallback callback, void* infoPtr);
+		//pairs between two tiers
+		static void FindPairs(Tier& a, Tier& b, BroadphasePairCallback callback, void* infoPtr);
+		//pairs an unbounded body with everything in a tier's trees
+		static void FindUnboundedPairs(PhysicsObject* body, Tier& tier, BroadphasePairCallback callback, void* infoPtr);
+		static bool Query(Tier& tier, const AABB& aabb, BroadphaseCallback callback, void* infoPtr, unsigned short collisionMask);
+		static Real RayCast(Tier& tier, Vector2 origin, Vector2 direction, Real maxDistance, BroadphaseRayCallback callback, void* infoPtr, unsigned short collisionMask);
+
+		Tier movingTier;
+		Tier staticTier;
+		Tier kinematicTier;
+		//temporary storage used when building
+		std::vector<PhysicsObject*> layerBodies[LAYER_COUNT];
+	};
+}
@@ -6,7 +6,30 @@
 
 namespace fzx
 {
-	CapsuleShape::CapsuleShape(Vector2 a, Vector2 b, float radius)
+	//never destroyed, so shapes can still be deleted during static destruction
+	static SharedPool<CapsuleShape>& GetShapePool()
+	{
+		static SharedPool<CapsuleShape>* pool = new SharedPool<CapsuleShape>();
+		return *pool;
+	}
+
+	void* CapsuleShape::operator new(size_t size)
+	{
+		assert(size == sizeof(CapsuleShape));
+		return GetShapePool().Allocate();
+	}
+
+	void CapsuleShape::operator delete(void* ptr)
+	{
+		GetShapePool().Free(ptr);
+	}
+
+	PoolStats CapsuleShape::GetPoolStats()
+	{
+		return GetShapePool().GetStats();
+	}
+
+	CapsuleShape::CapsuleShape(Vector2 a, Vector2 b, Real radius)
 	{
 		pointA = a;
 		pointB = b;
@@ -27,28 +50,28 @@ namespace fzx
 		return glm::length(em::ClosestPointOnLine(pointA, pointB, point) - point) <= radius;
 	}
 
-	void CapsuleShape::CalculateMass(float& mass, float& inertia, float density)
+	void CapsuleShape::CalculateMass(Real& mass, Real& inertia, Real density)
 	{
-		float len = glm::length(pointA - pointB);
-		mass = density * (2 * radius * len + radius * radius * glm::pi<float>());
+		Real len = glm::length(pointA - pointB);
+		mass = density * (2 * radius * len + radius * radius * glm::pi<Real>());
 		inertia = 0;
 
 		//inertia is equal to 2 translated semicircles + inertia of rectangle
-		float semiCircleMass = 0.5f * density * radius * radius * glm::pi<float>();
-		float semiCircleInertia = semiCircleMass * radius * radius * 0.5f;
+		Real semiCircleMass = 0.5f * density * radius * radius * glm::pi<Real>();
+		Real semiCircleInertia = semiCircleMass * radius * radius * 0.5f;
 		//translate inertia by adding mr^2 (proof in notebook)
 		//the semi circle is currently rotating around what would be it's centre if it was a full circle
 		//so need to move it by half of length of the capsule's rectangle
 		semiCircleInertia += semiCircleMass * 0.25f * len * len;
 		//now get the rect inertia
-		float width = radius * 2;
-		float rectMass = len * width * density;
-		float rectInertia = rectMass * (width * width + len * len) / 12.0f;
+		Real width = radius * 2;
+		Real rectMass = len * width * density;
+		Real rectInertia = rectMass * (width * width + len * len) / 12.0f;
 		//rect inertia is already about the right axis (relative to the semicircles.
 		//now add all inertias together 
 		inertia = rectInertia + semiCircleInertia * 2;
 		//now translate it by the distance between the centrepoint of the capsule and the centrepoint of the physicsObject (0,0), so it is correct when rotating about that axis
-		float dist = glm::length(0.5f * (pointA + pointB));
+		Real dist = glm::length((Real)0.5 * (pointA + pointB));
 		inertia += mass * dist * dist;
 
 		//success! (probably, I have no idea how to check)
@@ -100,8 +123,78 @@ namespace fzx
 		return transform.TransformPoint((glm::dot(v, pointA) > glm::dot(v, pointB) ? pointA : pointB) + v * radius);
 	}
 
+	bool CapsuleShape::RayCast(Vector2 origin, Vector2 direction, Real maxDistance, Transform& transform, Real& distance, Vector2& normal)
+	{
+		origin = transform.InverseTransformPoint(origin);
+		direction = transform.InverseTransformDirection(direction);
+
+		//starting inside
+		if (em::SquareLength(em::ClosestPointOnLine(pointA, pointB, origin) - origin) <= radius * radius)
+			return false;
+
+		//a capsule is two circles and a rectangle, so test the two caps and the two long sides and take the closest
+		bool hit = false;
+		Real closest = maxDistance;
+		Vector2 closestNormal;
+
+		Vector2 caps[2] = { pointA, pointB };
+		for (int i = 0; i < 2; i++)
+		{
+			Vector2 m = origin - caps[i];
+			Real b = glm::dot(m, direction);
+			Real discriminant = b * b - (em::SquareLength(m) - radius * radius);
+			if (b > 0 || discriminant < 0)
+				continue;
+
+			Real t = -b - em::Sqrt(discriminant);
+			if (t >= 0 && t <= closest)
+			{
+				hit = true;
+				closest = t;
+				closestNormal = (m + t * direction) / radius;
+			}
+		}
+
+		Vector2 axis = pointB - pointA;
+		Real axisLength = glm::length(axis);
+		Vector2 tangent = axis / axisLength;
+		Vector2 side = em::GetPerpendicularCounterClockwise(tangent);
+		for (int i = 0; i < 2; i++)
+		{
+			Vector2 sideNormal = i == 0 ? side : -side;
+			//the side is the segment from pointA to pointB moved out by the radius
+			Real denominator = glm::dot(sideNormal, direction);
+			if (denominator >= 0)
+				continue;
+
+			Real t = glm::dot(sideNormal, pointA + sideNormal * radius - origin) / denominator;
+			if (t < 0 || t > closest)
+				continue;
+
+			Real along = glm::dot(origin + t * direction - pointA, tangent);
+			if (along >= 0 && along <= axisLength)
+			{
+				hit = true;
+				closest = t;
+				closestNormal = sideNormal;
+			}
+		}
+
+		if (!hit)
+			return false;
+
+		distance = closest;
+		normal = transform.TransformDirection(closestNormal);
+		return true;
+	}
+
 	Vector2 CapsuleShape::GetCentrePoint()
 	{
-		return (pointA + pointB) * 0.5f;
+		return (pointA + pointB) * (Real)0.5;
+	}
+
+	Real CapsuleShape::GetBoundingRadius()
+	{
+		return glm::length(pointB - pointA) * (Real)0.5 + radius;
 	}
 }
\ No newline at end of file
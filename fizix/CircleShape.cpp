@@ -5,7 +5,30 @@
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 namespace fzx
 {
-	CircleShape::CircleShape(float radius, Vector2 centrePoint)
+	//never destroyed, so shapes can still be deleted during static destruction
+	static SharedPool<CircleShape>& GetShapePool()
+	{
+		static SharedPool<CircleShape>* pool = new SharedPool<CircleShape>();
+		return *pool;
+	}
+
+	void* CircleShape::operator new(size_t size)
+	{
+		assert(size == sizeof(CircleShape));
+		return GetShapePool().Allocate();
+	}
+
+	void CircleShape::operator delete(void* ptr)
+	{
+		GetShapePool().Free(ptr);
+	}
+
+	PoolStats CircleShape::GetPoolStats()
+	{
+		return GetShapePool().GetStats();
+	}
+
+	CircleShape::CircleShape(Real radius, Vector2 centrePoint)
 	{
 		this->radius = radius;
 		this->centrePoint = centrePoint;
@@ -17,9 +40,9 @@ namespace fzx
 		return em::SquareLength(centre - point) < radius * radius;
 	}
 
-	void CircleShape::CalculateMass(float& mass, float& inertia, float density)
+	void CircleShape::CalculateMass(Real& mass, Real& inertia, Real density)
 	{
-		mass = density * radius * radius * glm::pi<float>();
+		mass = density * radius * radius * glm::pi<Real>();
 		//circle is a cylinder with thickness of one, meaning the mass moment of inertia is mr^2/2
 		inertia = mass * radius * radius * 0.5f;
 		//im a bit confused on how translating inertia tensor stuff works but I think this is correct
@@ -52,8 +75,36 @@ namespace fzx
 		return transform.TransformPoint(centrePoint) + v * radius;
 	}
 
+	bool CircleShape::RayCast(Vector2 origin, Vector2 direction, Real maxDistance, Transform& transform, Real& distance, Vector2& normal)
+	{
+		//solve |origin + t * direction - centre|^2 = radius^2 for the smallest t
+		Vector2 centre = transform.TransformPoint(centrePoint);
+		Vector2 m = origin - centre;
+		Real c = em::SquareLength(m) - radius * radius;
+		if (c <= 0)
+			return false;
+
+		Real b = glm::dot(m, direction);
+		Real discriminant = b * b - c;
+		if (b > 0 || discriminant < 0)
+			return false;
+
+		Real t = -b - em::Sqrt(discriminant);
+		if (t > maxDistance)
+			return false;
+
+		distance = t;
+		normal = (m + t * direction) / radius;
+		return true;
+	}
+
 	Vector2 CircleShape::GetCentrePoint()
 	{
 		return centrePoint;
 	}
+
+	Real CircleShape::GetBoundingRadius()
+	{
+		return radius;
+	}
 }
\ No newline at end of file
@@ -2,39 +2,108 @@
 
 namespace fzx
 {
-	Collider::Collider(Shape* shape, float density, bool isTrigger)
+	//polygons that fill at least this much of their bounding circle (regular hexagons and up) use the circle's box as their AABB.
+	//it's at most about 15% wider than the exact one, and needs one transform instead of one per point
+	constexpr Real ROUND_POLYGON_AREA = 0.8f;
+
+	Collider::Collider(Shape* shape, Real density, bool isTrigger, Vector2 offset, Real rotation)
 	{
 		this->shape = shape;
+		shape->AddRef();
+		shapeType = shape->GetType();
 		this->density = density;
 		this->isTrigger = isTrigger;
+		SetLocalTransform(offset, rotation);
 
-		float massVar, inertiaVar;
+		Real massVar, inertiaVar;
 		CalculateMass(massVar, inertiaVar);
 	}
 
-	void Collider::CalculateMass(float& massVar, float& inertiaVar)
+	void Collider::CalculateMass(Real& massVar, Real& inertiaVar)
 	{
 		shape->CalculateMass(massVar, inertiaVar, density);
 		area = massVar / density;
+
+		if (hasLocalTransform)
+		{
+			//shapes give their inertia about their own origin, so move it to be about the body's origin (parallel axis theorem)
+			Vector2 centre = shape->GetCentrePoint();
+			inertiaVar += massVar * (em::SquareLength(localTransform.TransformPoint(centre)) - em::SquareLength(centre));
+		}
 	}
 
 	AABB& Collider::CalculateAABB(Transform& transform)
 	{
-		aABB = shape->CalculateAABB(transform);
+		if (circleAABB)
+		{
+			Vector2 centre = transform.TransformPoint(boundingCentre);
+			aABB.max = centre + Vector2(boundingRadius, boundingRadius);
+			aABB.min = centre - Vector2(boundingRadius, boundingRadius);
+		}
+		else
+		{
+			Transform world = GetWorldTransform(transform);
+			aABB = shape->CalculateAABB(world);
+		}
 		return aABB;
 	}
 
+	Vector2 Collider::GetCentrePoint()
+	{
+		return hasLocalTransform ? localTransform.TransformPoint(shape->GetCentrePoint()) : shape->GetCentrePoint();
+	}
+
+	void Collider::SetLocalTransform(Vector2 offset, Real rotation)
+	{
+		localTransform = Transform(offset, rotation);
+		hasLocalTransform = offset != Vector2(0, 0) || rotation != 0;
+		boundingCentre = GetCentrePoint();
+		boundingRadius = shape->GetBoundingRadius();
+		//a thin polygon's circle is much bigger than it is, and would pull in lots of pairs the exact AABB wouldn't
+		circleAABB = shapeType == SHAPE_TYPE::CIRCLE
+			|| (shapeType == SHAPE_TYPE::POLYGON && ((PolygonShape*)shape)->area >= ROUND_POLYGON_AREA * glm::pi<Real>() * boundingRadius * boundingRadius);
+	}
+
 	Collider::~Collider()
 	{
-		delete shape;
+		if (shape)
+			shape->Release();
 		shape = nullptr;
 	}
 
 	Collider::Collider(const Collider& other)
 	{
 		aABB = other.aABB;
-		shape = other.shape->Clone();
+		boundingCentre = other.boundingCentre;
+		boundingRadius = other.boundingRadius;
+		//the shape is shared instead of cloned
+		shape = other.shape;
+		shape->AddRef();
+		shapeType = other.shapeType;
+		localTransform = other.localTransform;
+		hasLocalTransform = other.hasLocalTransform;
+		circleAABB = other.circleAABB;
 		//attached = other.attached;
+		area = other.area;
+		density = other.density;
+		collisionLayer = other.collisionLayer;
+		collisionMask = other.collisionMask;
+		isTrigger = other.isTrigger;
+	}
+
+	Collider::Collider(Collider&& other)
+	{
+		shape = other.shape;
+		other.shape = nullptr;
+
+		shapeType = other.shapeType;
+		localTransform = other.localTransform;
+		hasLocalTransform = other.hasLocalTransform;
+		circleAABB = other.circleAABB;
+		aABB = other.aABB;
+		boundingCentre = other.boundingCentre;
+		boundingRadius = other.boundingRadius;
+		area = other.area;
 		density = other.density;
 		collisionLayer = other.collisionLayer;
 		collisionMask = other.collisionMask;
@@ -43,10 +112,22 @@ namespace fzx
 
 	Collider& Collider::operator=(const Collider& other)
 	{
-		delete shape;
-		shape = other.shape->Clone();
+		if (this == &other)
+			return *this;
 
+		other.shape->AddRef();
+		if (shape)
+			shape->Release();
+		shape = other.shape;
+
+		shapeType = other.shapeType;
+		localTransform = other.localTransform;
+		hasLocalTransform = other.hasLocalTransform;
+		circleAABB = other.circleAABB;
 		aABB = other.aABB;
+		boundingCentre = other.boundingCentre;
+		boundingRadius = other.boundingRadius;
+		area = other.area;
 		density = other.density;
 		collisionLayer = other.collisionLayer;
 		collisionMask = other.collisionMask;
@@ -57,10 +138,22 @@ namespace fzx
 
 	Collider& Collider::operator=(Collider&& other)
 	{
+		if (this == &other)
+			return *this;
+
+		if (shape)
+			shape->Release();
 		shape = other.shape;
 		other.shape = nullptr;
 
+		shapeType = other.shapeType;
+		localTransform = other.localTransform;
+		hasLocalTransform = other.hasLocalTransform;
+		circleAABB = other.circleAABB;
 		aABB = other.aABB;
+		boundingCentre = other.boundingCentre;
+		boundingRadius = other.boundingRadius;
+		area = other.area;
 		density = other.density;
 		collisionLayer = other.collisionLayer;
 		collisionMask = other.collisionMask;
@@ -72,6 +165,6 @@ namespace fzx
 	bool Collider::CanBeDynamic()
 	{
 		//planes cannot be dynamic, because they don't have any mass and it dont make sense.
-		return shape->GetType() != SHAPE_TYPE::PLANE;
+		return shapeType != SHAPE_TYPE::PLANE;
 	}
 }
\ No newline at end of file
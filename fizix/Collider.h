@@ -1,6 +1,7 @@
 #pragma once
 #include "Maths.h"
 #include "Shape.h"
+#include "Transform.h"
 
 namespace fzx 
 {
@@ -8,13 +9,32 @@ namespace fzx
 	class PhysicsSystem;
 	class Transform;
 
+	//used to add several colliders to a body at once
+	struct ColliderDesc
+	{
+		//the collider keeps a reference to the shape, so the same shape can be used in lots of descs
+		Shape* shape;
+		Real density = 1.0f;
+		bool isTrigger = false;
+		unsigned short collisionLayer = 1;
+		unsigned short collisionMask = 0xFFFF;
+		//where the shape is relative to the body
+		Vector2 offset = Vector2(0, 0);
+		Real rotation = 0;
+
+		ColliderDesc() = default;
+		ColliderDesc(Shape* shape, Real density = 1.0f, bool isTrigger = false, unsigned short collisionLayer = 1, unsigned short collisionMask = 0xFFFF, Vector2 offset = Vector2(0, 0), Real rotation = 0)
+			: shape(shape), density(density), isTrigger(isTrigger), collisionLayer(collisionLayer), collisionMask(collisionMask), offset(offset), rotation(rotation)
+		{}
+	};
+
 	class Collider
 	{
 
 	public:
 
 		//calculaters
-		void CalculateMass(float& massVar, float& inertiaVar);
+		void CalculateMass(Real& massVar, Real& inertiaVar);
 		AABB& CalculateAABB(Transform& transform);
 
 		inline void SetCollisionLayer(unsigned short cLayer) { collisionLayer = cLayer; }
@@ -22,26 +42,40 @@ namespace fzx
 		inline unsigned short GetCollisionLayer() { return collisionLayer; }
 		inline unsigned short GetCollisionMask() { return collisionMask; }
 
-		float GetArea() { return area; }
+		Real GetArea() { return area; }
 
 		bool GetIsTrigger() { return isTrigger; }
-		float GetDensity() { return density; }
+		Real GetDensity() { return density; }
 
 		Shape* GetShape() { return shape; }
+		//cached so the narrowphase doesn't need a virtual call to find it
+		inline SHAPE_TYPE GetShapeType() { return shapeType; }
+
+		//the shape's transform in world space
+		inline Transform GetWorldTransform(Transform& bodyTransform) { return hasLocalTransform ? bodyTransform.Combine(localTransform) : bodyTransform; }
+		//the shape's transform relative to the body
+		inline Transform& GetLocalTransform() { return localTransform; }
+		//centre of the shape relative to the body
+		Vector2 GetCentrePoint();
+		//a circle around the whole shape, relative to the body
+		inline Vector2 GetBoundingCentre() { return boundingCentre; }
+		inline Real GetBoundingRadius() { return boundingRadius; }
 
 	private:
 		friend PhysicsSystem;
 		friend PhysicsObject;
 
-		Collider(Shape* shape, float density = 1, bool isTrigger = false);
-		Collider() = default; // this is only used to initialize an array of colliders
+		Collider(Shape* shape, Real density = 1, bool isTrigger = false, Vector2 offset = Vector2(0, 0), Real rotation = 0);
 		Collider(const Collider& other);
+		Collider(Collider&& other);
 		Collider& operator=(const Collider& other);
 		Collider& operator=(Collider&& other);
 		~Collider();
 
 		//void SetAttached(PhysicsObject* attached) { this->attached = attached; }
 		bool CanBeDynamic();
+		//doesn't recalculate mass, the body does that
+		void SetLocalTransform(Vector2 offset, Real rotation);
 
 		//should be a value like this: 0b0000000000001000 (the 1 corrosponds to the layer)
 		unsigned short collisionLayer = 1;
@@ -51,11 +85,22 @@ namespace fzx
 		bool isTrigger;
 		//PhysicsObject* attached;
 		AABB aABB;
+		//the bounding circle doesn't change as the body turns, so round shapes get their AABB from it with one transform instead of one per point.
+		//it's also tested before the narrowphase, to throw out pairs whose AABBs overlap but can't be touching
+		Vector2 boundingCentre;
+		Real boundingRadius;
 
+		//shared, released when the collider is destroyed
 		Shape* shape;
+		SHAPE_TYPE shapeType;
+		Transform localTransform;
+		//false when the local transform is the identity, so the body transform can be used as is
+		bool hasLocalTransform;
+		//the box around the bounding circle is used as the AABB (circles, and polygons that are nearly round)
+		bool circleAABB;
 
-		float area;
-		float density;
+		Real area;
+		Real density;
 		bool isStatic = false;
 	};
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "fzx.h"
+#include "Transform.h"
 
 namespace fzx
 {
@@ -36,9 +37,89 @@ namespace fzx
 		Vector2 collisionPoints[MAX_COLLISION_POINTS];
 		char pointCount;//pointCount is 1 unless explicitly set to something else
 		Vector2 collisionNormal;
-		float penetration;
+		Real penetration;
 		COLLISION_TYPE type;
+		//world transforms of the two colliders' shapes, set just before the collide function is called
+		Transform transformA;
+		Transform transformB;
 	};
 
+	struct Ray
+	{
+		Vector2 origin;
+		//doesn't need to be normalised
+		Vector2 direction;
+		Real maxDistance;
+		unsigned short collisionMask = 0xFFFF;
+	};
+
+	struct RayCastHit
+	{
+		//nullptr if nothing was hit
+		PhysicsObject* body;
+		unsigned char colliderIndex;
+		Vector2 point;
+		Vector2 normal;
+		//distance along the ray divided by the max distance
+		Real fraction;
+	};
+
+	struct ShapeCastHit
+	{
+		//nullptr if nothing was hit
+		PhysicsObject* body;
+		unsigned char colliderIndex;
+		//the point on the body that was hit, and the normal of its surface there
+		Vector2 point;
+		Vector2 normal;
+		//time of impact, as a fraction of the translation
+		Real fraction;
+	};
+
+	//used by the point and AABB queries. return false to stop the query early
+	typedef bool (*QueryCallback)(PhysicsObject* body, unsigned char colliderIndex, void* infoPtr);
+
+	//pre-solve filter. called from inside the solver, so it should only decide if the contact is kept, not modify the world
 	typedef bool (*CollisionCallback)(CollisionData& data, void* infoPtr);
+
+	enum class CONTACT_EVENT_TYPE : unsigned char
+	{
+		BEGIN,
+		PERSIST,
+		END
+	};
+
+	//contact events are collected once per collider pair per step, and can be read after PhysicsSystem::Update()
+	struct ContactEvent
+	{
+		//a always has the lower body ID
+		PhysicsObject* a;
+		PhysicsObject* b;
+		unsigned char colliderIndexA;
+		unsigned char colliderIndexB;
+		CONTACT_EVENT_TYPE type;
+		//point and normal are from the first time the pair touched this step (or the last step it touched, for END events)
+		Vector2 point;
+		//from b to a, the same as CollisionData
+		Vector2 normal;
+		Real penetration;
+	};
+
+	enum class TRIGGER_EVENT_TYPE : unsigned char
+	{
+		ENTER,
+		STAY,
+		EXIT
+	};
+
+	//trigger overlaps are tested once per step, after the collision iterations. either collider (or both) can be the trigger
+	struct TriggerEvent
+	{
+		//a always has the lower body ID
+		PhysicsObject* a;
+		PhysicsObject* b;
+		unsigned char colliderIndexA;
+		unsigned char colliderIndexB;
+		TRIGGER_EVENT_TYPE type;
+	};
 }
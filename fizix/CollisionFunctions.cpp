@@ -4,21 +4,19 @@ namespace fzx
 {
 #pragma region Circle
 
-	bool PhysicsSystem::CollideCircleCircle(CollisionData& data)
+	bool PhysicsSystem::CollideCircleCircle(CircleShape* a, CircleShape* b, CollisionData& data)
 	{
-		CircleShape* a = (CircleShape*)data.a->GetCollider(data.colliderIndexA).GetShape();
-		CircleShape* b = (CircleShape*)data.b->GetCollider(data.colliderIndexB).GetShape();
-
-		Vector2 pA = data.a->GetTransform().TransformPoint(a->centrePoint), pB = data.b->GetTransform().TransformPoint(b->centrePoint);
+		Vector2 pA = data.transformA.TransformPoint(a->centrePoint), pB = data.transformB.TransformPoint(b->centrePoint);
 		Vector2 delta = pA - pB;
-		float deltaMagSq = delta.x * delta.x + delta.y * delta.y;
-		float radiusSum = (a->radius + b->radius);
+		Real deltaMagSq = delta.x * delta.x + delta.y * delta.y;
+		Real radiusSum = (a->radius + b->radius);
 
 		if (deltaMagSq < radiusSum * radiusSum)
 		{
-			deltaMagSq = sqrtf(deltaMagSq);
+			deltaMagSq = em::Sqrt(deltaMagSq);
 			data.penetration = radiusSum - deltaMagSq;
-			data.collisionNormal = delta / deltaMagSq;
+			//exactly on top of each other, so just pick a direction (the same one as the batched kernels)
+			data.collisionNormal = deltaMagSq == 0 ? Vector2(0, 1) : delta / deltaMagSq;
 			data.collisionPoints[0] = pA - data.collisionNormal * a->radius;
 			return true;
 		}
@@ -26,34 +24,28 @@ namespace fzx
 		return false;
 	}
 	
-	bool PhysicsSystem::CollideCirclePolygon(CollisionData& data)
+	bool PhysicsSystem::CollideCirclePolygon(CircleShape* a, PolygonShape* b, CollisionData& data)
 	{
-		CircleShape* a = (CircleShape*)data.a->GetCollider(data.colliderIndexA).GetShape();
-		PolygonShape* b = (PolygonShape*)data.b->GetCollider(data.colliderIndexB).GetShape();
-
 		EPACollisionData epaData;
-		if (EPA(a, b, data.a->transform, data.b->transform, &epaData))
+		if (EPA(a, b, data.transformA, data.transformB, &epaData))
 		{
 			data.collisionNormal = epaData.collisionNormal;
 			data.penetration = epaData.depth;
-			data.collisionPoints[0] = data.a->transform.TransformPoint(a->centrePoint) - a->radius * epaData.collisionNormal;
+			data.collisionPoints[0] = data.transformA.TransformPoint(a->centrePoint) - a->radius * epaData.collisionNormal;
 			return true;
 		}
 
 		return false;
 	}
 
-	bool PhysicsSystem::CollideCircleCapsule(CollisionData& data)
+	bool PhysicsSystem::CollideCircleCapsule(CircleShape* a, CapsuleShape* b, CollisionData& data)
 	{
-		CircleShape* a = (CircleShape*)data.a->GetCollider(data.colliderIndexA).GetShape();
-		CapsuleShape* b = (CapsuleShape*)data.b->GetCollider(data.colliderIndexB).GetShape();
-
 		//transform to global
-		Vector2 pA = data.b->GetTransform().TransformPoint(b->pointA), pB = data.b->GetTransform().TransformPoint(b->pointB);
-		Vector2 circleCentre = data.a->GetTransform().TransformPoint(a->centrePoint);
+		Vector2 pA = data.transformB.TransformPoint(b->pointA), pB = data.transformB.TransformPoint(b->pointB);
+		Vector2 circleCentre = data.transformA.TransformPoint(a->centrePoint);
 
 		//circle radius + capsule radius
-		float radius = a->radius + b->radius;
+		Real radius = a->radius + b->radius;
 
 		//this basically simplifies the problem to a circle-circle collision
 		Vector2 pointOnCapsuleLine = em::ClosestPointOnLine(pA, pB, circleCentre);
@@ -71,19 +63,16 @@ namespace fzx
 		return false;
 	}
 
-	bool PhysicsSystem::CollideCirclePlane(CollisionData& data)
+	bool PhysicsSystem::CollideCirclePlane(CircleShape* a, PlaneShape* b, CollisionData& data)
 	{
-		CircleShape* a = (CircleShape*)data.a->GetCollider(data.colliderIndexA).GetShape();
-		PlaneShape* b = (PlaneShape*)data.b->GetCollider(data.colliderIndexB).GetShape();
-
 		//transform to global
-		Vector2 centre = data.a->GetTransform().TransformPoint(a->centrePoint);
-		Vector2 planeDirection = data.b->GetTransform().TransformDirection(b->normal);
-		float planeDistance = glm::dot(data.b->GetTransform().TransformPoint(b->distance * b->normal), planeDirection);
+		Vector2 centre = data.transformA.TransformPoint(a->centrePoint);
+		Vector2 planeDirection = data.transformB.TransformDirection(b->normal);
+		Real planeDistance = glm::dot(data.transformB.TransformPoint(b->distance * b->normal), planeDirection);
 
 		//calculate penetration
-		float centreDot = glm::dot(centre, planeDirection);
-		float penetration = centreDot - a->radius - planeDistance;
+		Real centreDot = glm::dot(centre, planeDirection);
+		Real penetration = centreDot - a->radius - planeDistance;
 
 		//if p < 0, is colliding
 		if (penetration < 0)
@@ -99,20 +88,17 @@ namespace fzx
 #pragma endregion
 #pragma region Polygon
 
-	bool PhysicsSystem::CollidePolygonPolygon(CollisionData& data)
+	bool PhysicsSystem::CollidePolygonPolygon(PolygonShape* a, PolygonShape* b, CollisionData& data)
 	{
-		PolygonShape* a = (PolygonShape*)data.a->GetCollider(data.colliderIndexA).GetShape();
-		PolygonShape* b = (PolygonShape*)data.b->GetCollider(data.colliderIndexB).GetShape();
-
-		/*std::cout << "Do polygons collide: " << Intersection(a, b, data.a->transform, data.b->transform, nullptr)
+		/*std::cout << "Do polygons collide: " << Intersection(a, b, data.transformA, data.transformB, nullptr)
 			<< std::endl;*/
 
 		EPACollisionData epaData;
-		if (EPA(a, b, data.a->transform, data.b->transform, &epaData))
+		if (EPA(a, b, data.transformA, data.transformB, &epaData))
 		{
 			//now find the collision points using the clipping method.
-			PolygonEdge reference = FindPolygonCollisionEdge(a, data.a->transform, -epaData.collisionNormal);
-			PolygonEdge incident = FindPolygonCollisionEdge(b, data.b->transform, epaData.collisionNormal);
+			PolygonEdge reference = FindPolygonCollisionEdge(a, data.transformA, -epaData.collisionNormal);
+			PolygonEdge incident = FindPolygonCollisionEdge(b, data.transformB, epaData.collisionNormal);
 
 			//reference edge: this edge clips the incident edge to get the contact points
 
@@ -127,7 +113,7 @@ namespace fzx
 
 			Vector2 referenceTangent = glm::normalize(reference.pB - reference.pA);
 
-			float referenceStart = glm::dot(reference.pA, referenceTangent);
+			Real referenceStart = glm::dot(reference.pA, referenceTangent);
 			ClipInfo c;
 			/*c.pointCount = 2;
 			c.points[0] = incident.pA;
@@ -135,7 +121,7 @@ namespace fzx
 			c = Clip(incident.pA, incident.pB, referenceTangent, referenceStart);
 			if (c.pointCount < 2) return false;
 
-			float referenceEnd = glm::dot(reference.pB, referenceTangent);
+			Real referenceEnd = glm::dot(reference.pB, referenceTangent);
 			c = Clip(c.points[0], c.points[1], -referenceTangent, -referenceEnd);
 			if (c.pointCount < 2) return false;
 
@@ -144,7 +130,7 @@ namespace fzx
 			//if (flipEdges)
 			//	referenceNormal = -referenceNormal;
 
-			float max = glm::dot(reference.maxProjectionVertex, referenceNormal);
+			Real max = glm::dot(reference.maxProjectionVertex, referenceNormal);
 			if (glm::dot(c.points[0], referenceNormal) > max)
 			{
 				if (c.pointCount > 1)
@@ -170,24 +156,21 @@ namespace fzx
 		return false;
 	}
 
-	bool PhysicsSystem::CollidePolygonCapsule(CollisionData& data)
+	bool PhysicsSystem::CollidePolygonCapsule(PolygonShape* a, CapsuleShape* b, CollisionData& data)
 	{
-		PolygonShape* a = (PolygonShape*)data.a->GetCollider(data.colliderIndexA).GetShape();
-		CapsuleShape* b = (CapsuleShape*)data.b->GetCollider(data.colliderIndexB).GetShape();
-
 		EPACollisionData epaData;
-		if (EPA(a, b, data.a->transform, data.b->transform, &epaData))
+		if (EPA(a, b, data.transformA, data.transformB, &epaData))
 		{
 			data.collisionNormal = epaData.collisionNormal;
 			data.penetration = epaData.depth;
 
-			//data.collisionPoints[0] = em::ClosestPointOnLine(data.b->transform.TransformPoint(b->pointA), data.b->transform.TransformPoint(b->pointB),
-			//	data.a->transform.TransformPoint(a->centrePoint)) - b->radius * data.collisionNormal; //<-- once again, this works really well for something that is not accurate.
+			//data.collisionPoints[0] = em::ClosestPointOnLine(data.transformB.TransformPoint(b->pointA), data.transformB.TransformPoint(b->pointB),
+			//	data.transformA.TransformPoint(a->centrePoint)) - b->radius * data.collisionNormal; //<-- once again, this works really well for something that is not accurate.
 
 			//Now find collision point by comparing 
-			PolygonEdge aEdge = FindPolygonCollisionEdge(a, data.a->transform, -data.collisionNormal);
-			Vector2 bPointA = data.b->GetTransform().TransformPoint(b->pointA),
-				bPointB = data.b->GetTransform().TransformPoint(b->pointB);
+			PolygonEdge aEdge = FindPolygonCollisionEdge(a, data.transformA, -data.collisionNormal);
+			Vector2 bPointA = data.transformB.TransformPoint(b->pointA),
+				bPointB = data.transformB.TransformPoint(b->pointB);
 
 			//Vector2 intersectionPoint;
 			/*if (em::CalculateIntersectionPoint(aEdge.pA, aEdge.pB, bPointA, bPointB, intersectionPoint))
@@ -196,12 +179,12 @@ namespace fzx
 				//it probably returns the wrong value. but idk it's hard to say
 			}*/
 			//((b-a) x ((0,0)-a)) x (b-a)
-			Vector2 bNormal = em::GetPerpendicularCounterClockwise(bPointB - bPointA);//, data.a->transform.position);
+			Vector2 bNormal = em::GetPerpendicularCounterClockwise(bPointB - bPointA);//, data.transformA.position);
 			bNormal = GetPerpendicularFacingInDirection(bPointB - bPointA, -data.collisionNormal);
-			float stadiumDistance = glm::dot(bNormal, bPointA);
+			Real stadiumDistance = glm::dot(bNormal, bPointA);
 
-			float pA = glm::dot(aEdge.pA, bNormal);
-			float pB = glm::dot(aEdge.pB, bNormal);
+			Real pA = glm::dot(aEdge.pA, bNormal);
+			Real pB = glm::dot(aEdge.pB, bNormal);
 			if (pA - stadiumDistance < pB - stadiumDistance)
 			{
 				data.collisionPoints[0] = em::ClosestPointOnLine(bPointA, bPointB, aEdge.pA) + b->radius * data.collisionNormal;
@@ -215,20 +198,31 @@ namespace fzx
 		return false;
 	}
 
-	bool PhysicsSystem::CollidePolygonPlane(CollisionData& data)
+	bool PhysicsSystem::CollidePolygonPlane(PolygonShape* a, PlaneShape* b, CollisionData& data)
 	{
-		PolygonShape* a = (PolygonShape*)data.a->GetCollider(data.colliderIndexA).GetShape();
-		PlaneShape* b = (PlaneShape*)data.b->GetCollider(data.colliderIndexB).GetShape();
+		switch (a->capacity)
+		{
+		case 4: return CollidePolygonPlane<4>(a, b, data);
+		case 8: return CollidePolygonPlane<8>(a, b, data);
+		case 16: return CollidePolygonPlane<16>(a, b, data);
+		default: return CollidePolygonPlane<0>(a, b, data);
+		}
+	}
 
-		Vector2 planeNormal = data.b->GetTransform().TransformPoint(b->normal);
-		float planeDistance = glm::dot(data.b->GetTransform().TransformPoint(b->distance * b->normal), planeNormal);
+	template<int CAPACITY>
+	bool PhysicsSystem::CollidePolygonPlane(PolygonShape* a, PlaneShape* b, CollisionData& data)
+	{
+		Vector2 planeNormal = data.transformB.TransformPoint(b->normal);
+		Real planeDistance = glm::dot(data.transformB.TransformPoint(b->distance * b->normal), planeNormal);
 
-		float minPenetration = 1;
+		Real minPenetration = 1;
 		Vector2 collisionPoint;
-		for (size_t i = 0; i < a->pointCount; i++)
+		//the spare slots repeat the first point, which is never deeper than itself
+		const int count = CAPACITY != 0 ? CAPACITY : a->pointCount;
+		for (int i = 0; i < count; i++)
 		{
-			Vector2 point = data.a->GetTransform().TransformPoint(a->points[i]);
-			float p = glm::dot(point, planeNormal) - planeDistance;
+			Vector2 point = data.transformA.TransformPoint(a->points[i]);
+			Real p = glm::dot(point, planeNormal) - planeDistance;
 
 			if (p < minPenetration)
 			{
@@ -246,7 +240,7 @@ namespace fzx
 			data.pointCount = 0;
 			//now find collision points
 			//now find the collision points using the clipping method.
-			PolygonEdge incident = FindPolygonCollisionEdge(a, data.a->transform, -planeNormal);
+			PolygonEdge incident = FindPolygonCollisionEdge<CAPACITY>(a, data.transformA, -planeNormal);
 			//the reference edge is perpendicular to the plane normal
 
 			//add vertices that aren't above the plane
@@ -270,15 +264,12 @@ namespace fzx
 #pragma endregion
 
 #pragma region Capsule
-	bool PhysicsSystem::CollideCapsuleCapsule(CollisionData& data)
+	bool PhysicsSystem::CollideCapsuleCapsule(CapsuleShape* a, CapsuleShape* b, CollisionData& data)
 	{
-		CapsuleShape* a = (CapsuleShape*)data.a->GetCollider(data.colliderIndexA).GetShape();
-		CapsuleShape* b = (CapsuleShape*)data.b->GetCollider(data.colliderIndexB).GetShape();
-
-		Vector2 aPointA = data.a->GetTransform().TransformPoint(a->pointA),
-			aPointB = data.a->GetTransform().TransformPoint(a->pointB)
-			, bPointA = data.b->GetTransform().TransformPoint(b->pointA),
-			bPointB = data.b->GetTransform().TransformPoint(b->pointB);;
+		Vector2 aPointA = data.transformA.TransformPoint(a->pointA),
+			aPointB = data.transformA.TransformPoint(a->pointB)
+			, bPointA = data.transformB.TransformPoint(b->pointA),
+			bPointB = data.transformB.TransformPoint(b->pointB);;
 
 		//stadium checking comes down to 4 point-line distance checks, an intersection test, and 4 point normal tests
 
@@ -294,10 +285,10 @@ namespace fzx
 			//this is essentially 4 point-plane checks
 			//the point with the smallest penetration wins, and the capsule will be pushed out along that axis
 			Vector2 normal = aNormal;
-			float aPoint = glm::dot(aNormal, aPointA);
-			float bPoint = glm::dot(bNormal, bPointA);
-			float p1 = aPoint - glm::dot(aNormal, bPointA);
-			float p2 = aPoint - glm::dot(aNormal, bPointB);
+			Real aPoint = glm::dot(aNormal, aPointA);
+			Real bPoint = glm::dot(bNormal, bPointA);
+			Real p1 = aPoint - glm::dot(aNormal, bPointA);
+			Real p2 = aPoint - glm::dot(aNormal, bPointB);
 
 			if (p1 * p1 > p2 * p2)
 				p1 = p2;
@@ -318,7 +309,7 @@ namespace fzx
 			}
 
 			//since we know they are intersecting there is no need to perform a check here
-			float sign = glm::sign(p1); //<-- could probably get rid of this somehow with the triple cross product thing
+			Real sign = glm::sign(p1); //<-- could probably get rid of this somehow with the triple cross product thing
 			data.collisionNormal = sign * -normal;
 			data.penetration = sign * p1 + a->radius + b->radius;
 			data.collisionPoints[0] = intersection + data.collisionNormal * a->radius;
@@ -331,10 +322,10 @@ namespace fzx
 
 			struct {
 				Vector2 collisionDelta;
-				float collisionDistanceSq;
+				Real collisionDistanceSq;
 			} collision, newCollision;
 
-			float collisionMul = -a->radius;
+			Real collisionMul = -a->radius;
 			Vector2 collisionPoint = aPointA;
 			collision.collisionDelta = aPointA - em::ClosestPointOnLine(bPointA, bPointB, aPointA);
 			collision.collisionDistanceSq = em::SquareLength(collision.collisionDelta);
@@ -365,12 +356,12 @@ namespace fzx
 				collisionMul = b->radius;
 			}
 
-			float radius = a->radius + b->radius;
+			Real radius = a->radius + b->radius;
 
 			//if the smallest collision distance is less than the sum of the radii, it is colliding
 			if (collision.collisionDistanceSq < radius * radius)
 			{
-				float length = sqrtf(collision.collisionDistanceSq);
+				Real length = em::Sqrt(collision.collisionDistanceSq);
 				data.penetration = radius - length;
 				data.collisionNormal = collision.collisionDelta / length;
 				data.collisionPoints[0] = collisionPoint + data.collisionNormal * collisionMul;
@@ -381,21 +372,18 @@ namespace fzx
 		return false;
 	}
 
-	bool PhysicsSystem::CollideCapsulePlane(CollisionData& data)
+	bool PhysicsSystem::CollideCapsulePlane(CapsuleShape* a, PlaneShape* b, CollisionData& data)
 	{
-		CapsuleShape* a = (CapsuleShape*)data.a->GetCollider(data.colliderIndexA).GetShape();
-		PlaneShape* b = (PlaneShape*)data.b->GetCollider(data.colliderIndexB).GetShape();
-
-		Vector2 pointA = data.a->GetTransform().TransformPoint(a->pointA), pointB = data.a->GetTransform().TransformPoint(a->pointB);
-		Vector2 planeDirection = data.b->GetTransform().TransformDirection(b->normal);
-		float planeDistance = glm::dot(data.b->GetTransform().TransformPoint(b->distance * b->normal), planeDirection);
+		Vector2 pointA = data.transformA.TransformPoint(a->pointA), pointB = data.transformA.TransformPoint(a->pointB);
+		Vector2 planeDirection = data.transformB.TransformDirection(b->normal);
+		Real planeDistance = glm::dot(data.transformB.TransformPoint(b->distance * b->normal), planeDirection);
 
 		Vector2 collisionPoint = pointA;
-		float start = glm::dot(pointA, planeDirection);
-		float end = glm::dot(pointB, planeDirection);
+		Real start = glm::dot(pointA, planeDirection);
+		Real end = glm::dot(pointB, planeDirection);
 		if (start > end)
 		{
-			float temp = start;
+			Real temp = start;
 			start = end;
 			end = temp;
 			collisionPoint = pointB;
@@ -415,59 +403,5 @@ namespace fzx
 
 		return false;
 	}
-
-	bool PhysicsSystem::CollideInvalid(CollisionData& data)
-	{
-		return false;
-	}
-#pragma endregion
-
-#pragma region Flipped Functions
-
-	static void FlipData(CollisionData& data)
-	{
-		auto temp = data.a;
-		data.a = data.b;
-		data.b = temp;
-
-		auto temp2 = data.colliderIndexA;
-		data.colliderIndexA = data.colliderIndexB;
-		data.colliderIndexB = temp2;
-	}
-	bool PhysicsSystem::CollidePolygonCircle(CollisionData& data)
-	{
-		FlipData(data);
-		return CollideCirclePolygon(data);
-	}
-
-	bool PhysicsSystem::CollideCapsuleCircle(CollisionData& data)
-	{
-		FlipData(data);
-		return CollideCircleCapsule(data);
-	}
-
-	bool PhysicsSystem::CollidePlaneCircle(CollisionData& data)
-	{
-		FlipData(data);
-		return CollideCirclePlane(data);
-	}
-
-	bool PhysicsSystem::CollideCapsulePolygon(CollisionData& data)
-	{
-		FlipData(data);
-		return CollidePolygonCapsule(data);
-	}
-
-	bool PhysicsSystem::CollidePlanePolygon(CollisionData& data)
-	{
-		FlipData(data);
-		return CollidePolygonPlane(data);
-	}
-
-	bool PhysicsSystem::CollidePlaneCapsule(CollisionData& data)
-	{
-		FlipData(data);
-		return CollideCapsulePlane(data);
-	}
 #pragma endregion
 }
\ No newline at end of file
@@ -4,11 +4,62 @@ namespace fzx
 {
 	namespace em
 	{
-		float GetAngle(Vector2 a, Vector2 b) {
+#ifdef FZX_DETERMINISTIC
+		//polynomials for sin and cos between -pi/4 and pi/4 (from fdlibm). everything is done in doubles with only
+		//+, -, * and floor, which IEEE 754 requires to be exact, so they can't differ between machines
+		static double SinKernel(double x)
+		{
+			const double S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03, S3 = -1.98412698298579493134e-04,
+				S4 = 2.75573137070700676789e-06, S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+			double z = x * x;
+			return x + z * x * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+		}
+
+		static double CosKernel(double x)
+		{
+			const double C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03, C3 = 2.48015872894767294178e-05,
+				C4 = -2.75573143513906633035e-07, C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+			double z = x * x;
+			return 1.0 - 0.5 * z + z * z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+		}
+#endif
+
+		void SinCos(Real angle, Real& sine, Real& cosine)
+		{
+#ifdef FZX_DETERMINISTIC
+			//pi/2 split in two, so the reduction doesn't lose precision
+			const double PIO2_HI = 1.57079632673412561417e+00, PIO2_LO = 6.07710050650619224932e-11;
+			const double INV_PIO2 = 6.36619772367581382433e-01;
+
+			//reduce to -pi/4..pi/4 and work out which quarter of the circle the angle was in
+			double k = floor((double)angle * INV_PIO2 + 0.5);
+			double x = ((double)angle - k * PIO2_HI) - k * PIO2_LO;
+			double s = SinKernel(x), c = CosKernel(x);
+
+			switch (((long long)k) & 3)
+			{
+			case 0: sine = (Real)s; cosine = (Real)c; break;
+			case 1: sine = (Real)c; cosine = (Real)-s; break;
+			case 2: sine = (Real)-s; cosine = (Real)-c; break;
+			default: sine = (Real)-c; cosine = (Real)s; break;
+			}
+#else
+			sine = sin(angle);
+			cosine = cos(angle);
+#endif
+		}
+
+		Real Sqrt(Real v)
+		{
+			//IEEE 754 requires square roots to be correctly rounded, so unlike sin and cos this is already the same everywhere
+			return std::sqrt(v);
+		}
+
+		Real GetAngle(Vector2 a, Vector2 b) {
 			return acos(glm::dot(a, b));
 		}
 
-		float CheckOrder(Vector2 a, Vector2 b, Vector2 c) {
+		Real CheckOrder(Vector2 a, Vector2 b, Vector2 c) {
 
 			// > 0 : c is to the left of ab (abc is counterclockwise order)
 			// < 0 : c is to the right of ab (abc is clockwise order)
@@ -26,7 +77,7 @@ namespace fzx
 		//This isn't technically the cross product, its the z component of the cross product of two 3D vectors
 		// the x and y components are always zero when a and b have z values of zero (like when we use Vector2s)
 		//it is useful a lot of the time
-		float Cross(Vector2 a, Vector2 b) {
+		Real Cross(Vector2 a, Vector2 b) {
 			return (a.x * b.y - b.x * a.y);;
 		}
 
@@ -34,40 +85,40 @@ namespace fzx
 		{
 			//triple cross method in 2d
 			Vector2 AB = b - a;
-			float cross = em::Cross(AB, point - a);
+			Real cross = em::Cross(AB, point - a);
 			return glm::normalize(Vector2(-cross * AB.y, cross * AB.x));
 		}
 
 		Vector2 TripleCross(Vector2 a, Vector2 b, Vector2 c)
 		{
 			//just a more transparent version of GetPerpindicularTowardsPoint, literaly just (a x b) x c
-			float cross = em::Cross(a, b);
+			Real cross = em::Cross(a, b);
 			return glm::normalize(Vector2(-cross * c.y, cross * c.x));
 		}
 
-		float Sq(float f)
+		Real Sq(Real f)
 		{
 			return f * f;
 		}
 
 		Vector2 NormalizeSafe(Vector2 v, Vector2 ifZero)
 		{
-			float len = glm::length(v);
+			Real len = glm::length(v);
 			return (isnan(len) || len == 0) ? ifZero : v / len;
 		}
 
-		float SquareLength(Vector2 v) {
+		Real SquareLength(Vector2 v) {
 			return v.x * v.x + v.y * v.y;
 		}
 
 		Vector2 ClosestPointOnLine(Vector2 a, Vector2 b, Vector2 point)
 		{
 			Vector2 lineDelta = b - a;
-			float t = glm::dot(point - a, lineDelta) / SquareLength(lineDelta); //div by lineDelta means nothing needs to be normalised
-			return a + (glm::min(glm::max(t, 0.0f), 1.0f) * lineDelta);
+			Real t = glm::dot(point - a, lineDelta) / SquareLength(lineDelta); //div by lineDelta means nothing needs to be normalised
+			return a + (glm::min(glm::max(t, (Real)0), (Real)1) * lineDelta);
 		}
 
-		Vector2 ClosestPointOnPlane(Vector2 planeNormal, float distance, Vector2 point)
+		Vector2 ClosestPointOnPlane(Vector2 planeNormal, Real distance, Vector2 point)
 		{
 			if (glm::dot(planeNormal, point) <= 0)
 			{
@@ -93,7 +144,7 @@ namespace fzx
 			Vector2 deltaA = b - a;
 			Vector2 deltaB = d - c;
 
-			float dACrossDB = Cross(deltaA, deltaB);
+			Real dACrossDB = Cross(deltaA, deltaB);
 
 			if (dACrossDB == 0)
 			{
@@ -103,9 +154,9 @@ namespace fzx
 			}
 
 			//percent of line CD the intersection point is at
-			float t = Cross(c - a, deltaA) / dACrossDB;
+			Real t = Cross(c - a, deltaA) / dACrossDB;
 			//percent of line AB the intersection point is at
-			float t2 = Cross(c - a, deltaB) / dACrossDB;
+			Real t2 = Cross(c - a, deltaB) / dACrossDB;
 
 			intersectionPoint = c + t * deltaB;
 			return t >= 0 && t <= 1 && t2 >= 0 && t2 <= 1;
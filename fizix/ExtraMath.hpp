@@ -5,12 +5,16 @@ namespace fzx
 {
 	namespace em
 	{
-		float GetAngle(Vector2 a, Vector2 b);
-		float CheckOrder(Vector2 a, Vector2 b, Vector2 c);
-		float Cross(Vector2 a, Vector2 b);
-		float SquareLength(Vector2 v);
+		//with FZX_DETERMINISTIC these use fzx's own implementation instead of the standard library's,
+		//so they give the same result on every platform and compiler (the standard library is allowed to differ)
+		void SinCos(Real angle, Real& sine, Real& cosine);
+		Real Sqrt(Real v);
+		Real GetAngle(Vector2 a, Vector2 b);
+		Real CheckOrder(Vector2 a, Vector2 b, Vector2 c);
+		Real Cross(Vector2 a, Vector2 b);
+		Real SquareLength(Vector2 v);
 		Vector2 ClosestPointOnLine(Vector2 a, Vector2 b, Vector2 point);
-		Vector2 ClosestPointOnPlane(Vector2 planeNormal, float distance, Vector2 point);
+		Vector2 ClosestPointOnPlane(Vector2 planeNormal, Real distance, Vector2 point);
 		bool DoLinesIntersect(Vector2 a, Vector2 b, Vector2 c, Vector2 d);
 		bool CalculateIntersectionPoint(Vector2 a, Vector2 b, Vector2 c, Vector2 d, Vector2& intersectionPoint);
 		Vector2 GetPerpendicularClockwise(Vector2 v);
@@ -18,7 +22,7 @@ namespace fzx
 		Vector2 GetPerpendicularTowardsPoint(Vector2 a, Vector2 b, Vector2 point);
 		Vector2 NormalizeSafe(Vector2 v, Vector2 ifzero = Vector2(0, 1));
 		Vector2 TripleCross(Vector2 a, Vector2 b, Vector2 c);
-		float Sq(float f);
+		Real Sq(Real f);
 	};
 }
 
@@ -0,0 +1,294 @@
+#include "fzx.h"
+#include "Joint.h"
+
+namespace fzx
+{
+	//2D cross product of a scalar (an angular velocity) with a vector
+	static inline Vector2 Cross(Real s, Vector2 v)
+	{
+		return Vector2(-s * v.y, s * v.x);
+	}
+
+	//a body's velocities and inverse masses while a joint is being solved. the world is a body that never moves
+	struct JointBody
+	{
+		PhysicsObject* body;
+		Vector2 velocity = Vector2(0, 0);
+		Real angularVelocity = 0;
+		Real iMass = 0;
+		Real iInertia = 0;
+
+		JointBody(PhysicsObject* body) : body(body)
+		{
+			if (body)
+			{
+				velocity = body->GetVelocity();
+				angularVelocity = body->GetAngularVelocity();
+				iMass = body->GetInverseMass();
+				iInertia = body->GetInverseInertia();
+			}
+		}
+
+		inline void ApplyImpulse(Vector2 impulse, Vector2 r)
+		{
+			velocity += iMass * impulse;
+			angularVelocity += iInertia * em::Cross(r, impulse);
+		}
+
+		inline Vector2 VelocityAt(Vector2 r)
+		{
+			return velocity + Cross(angularVelocity, r);
+		}
+
+		//written straight to the body so it isn't woken up, the island does that if it's still moving at the end of the step
+		void Store()
+		{
+			if (body)
+			{
+				body->velocity = velocity;
+				body->angularVelocity = angularVelocity;
+			}
+		}
+	};
+
+	//inverts the effective mass of a point constraint between two bodies (softness is added to the diagonal for springs)
+	static void InvertPointMass(const JointBody& A, const JointBody& B, Vector2 rA, Vector2 rB, Real softness, Real mass[2][2])
+	{
+		Real k11 = A.iMass + B.iMass + A.iInertia * rA.y * rA.y + B.iInertia * rB.y * rB.y + softness;
+		Real k12 = -A.iInertia * rA.x * rA.y - B.iInertia * rB.x * rB.y;
+		Real k22 = A.iMass + B.iMass + A.iInertia * rA.x * rA.x + B.iInertia * rB.x * rB.x + softness;
+
+		Real determinant = k11 * k22 - k12 * k12;
+		if (determinant != 0)
+			determinant = 1 / determinant;
+		mass[0][0] = determinant * k22;
+		mass[0][1] = -determinant * k12;
+		mass[1][0] = -determinant * k12;
+		mass[1][1] = determinant * k11;
+	}
+
+	static inline Vector2 Multiply(const Real mass[2][2], Vector2 v)
+	{
+		return Vector2(mass[0][0] * v.x + mass[0][1] * v.y, mass[1][0] * v.x + mass[1][1] * v.y);
+	}
+
+	//turns a spring's frequency and damping into the softness (gamma) and the fraction of the error fixed per step, for a given mass
+	static void SpringCoefficients(Real mass, Real frequency, Real dampingRatio, Real deltaTime, Real& gamma, Real& errorScale)
+	{
+		Real omega = 2 * glm::pi<Real>() * frequency;
+		Real damping = 2 * mass * dampingRatio * omega;
+		Real stiffness = mass * omega * omega;
+
+		gamma = deltaTime * (damping + deltaTime * stiffness);
+		gamma = gamma != 0 ? 1 / gamma : 0;
+		errorScale = deltaTime * stiffness * gamma;
+	}
+
+	Joint::Joint(const JointDesc& desc)
+		: type(desc.type), collideConnected(desc.collideConnected), a(desc.a), b(desc.type == JOINT_TYPE::MOUSE ? nullptr : desc.b), pointer(desc.infoPointer),
+		length(desc.length), frequency(desc.frequency), dampingRatio(desc.dampingRatio), maxForce(desc.maxForce), target(desc.anchorA)
+	{
+		Vector2 anchorB = type == JOINT_TYPE::DISTANCE ? desc.anchorB : desc.anchorA;
+		localAnchorA = a->GetTransform().InverseTransformPoint(desc.anchorA);
+		localAnchorB = b ? b->GetTransform().InverseTransformPoint(anchorB) : anchorB;
+		localAxis = a->GetTransform().InverseTransformDirection(em::NormalizeSafe(desc.axis, Vector2(1, 0)));
+		referenceAngle = (b ? b->GetRotation() : 0) - a->GetRotation();
+		if (length < 0)
+			length = glm::length(anchorB - desc.anchorA);
+	}
+
+	Vector2 Joint::GetAnchorA()
+	{
+		return a->GetTransform().TransformPoint(localAnchorA);
+	}
+
+	Vector2 Joint::GetAnchorB()
+	{
+		if (type == JOINT_TYPE::MOUSE)
+			return target;
+		return b ? b->GetTransform().TransformPoint(localAnchorB) : localAnchorB;
+	}
+
+	void Joint::SetTarget(Vector2 newTarget)
+	{
+		target = newTarget;
+		a->SetAwake(true);
+	}
+
+	Vector2 Joint::GetImpulse()
+	{
+		if (type == JOINT_TYPE::DISTANCE || type == JOINT_TYPE::PRISMATIC)
+			return impulse.x * direction;
+		return impulse;
+	}
+
+	void Joint::Prepare(Real deltaTime)
+	{
+		JointBody A(a), B(b);
+
+		//the world's anchor is already in world space, so it's relative to 0,0
+		Vector2 positionA = a->GetPosition();
+		Vector2 positionB = b ? b->GetPosition() : Vector2(0, 0);
+		rA = a->GetTransform().TransformDirection(localAnchorA);
+		rB = b ? b->GetTransform().TransformDirection(localAnchorB) : localAnchorB;
+		Vector2 separation = positionB + rB - positionA - rA;
+		Real angleError = (b ? b->GetRotation() : 0) - a->GetRotation() - referenceAngle;
+
+		Real baumgarte = FZX_JOINT_BAUMGARTE / deltaTime;
+		gamma = 0;
+		bias = Vector2(0, 0);
+		angularBias = 0;
+		Real angularK = A.iInertia + B.iInertia;
+		angularMass = angularK > 0 ? 1 / angularK : 0;
+
+		switch (type)
+		{
+		case JOINT_TYPE::DISTANCE:
+		{
+			Real currentLength = glm::length(separation);
+			//if the anchors are on top of each other there's no direction to push them in
+			direction = currentLength > (Real)0.0001 ? separation / currentLength : Vector2(0, 0);
+			Real crA = em::Cross(rA, direction);
+			Real crB = em::Cross(rB, direction);
+			Real k = A.iMass + B.iMass + A.iInertia * crA * crA + B.iInertia * crB * crB;
+			Real error = currentLength - length;
+
+			if (frequency > 0 && k > 0)
+			{
+				Real errorScale;
+				SpringCoefficients(1 / k, frequency, dampingRatio, deltaTime, gamma, errorScale);
+				bias.x = error * errorScale;
+				k += gamma;
+			}
+			else
+				bias.x = error * baumgarte;
+			mass[0][0] = k > 0 ? 1 / k : 0;
+			break;
+		}
+		case JOINT_TYPE::REVOLUTE:
+		case JOINT_TYPE::WELD:
+			InvertPointMass(A, B, rA, rB, 0, mass);
+			bias = separation * baumgarte;
+			angularBias = angleError * baumgarte;
+			break;
+		case JOINT_TYPE::PRISMATIC:
+		{
+			Vector2 axis = a->GetTransform().TransformDirection(localAxis);
+			direction = Vector2(-axis.y, axis.x);
+			sA = em::Cross(separation + rA, direction);
+			sB = em::Cross(rB, direction);
+			Real k = A.iMass + B.iMass + A.iInertia * sA * sA + B.iInertia * sB * sB;
+			mass[0][0] = k > 0 ? 1 / k : 0;
+			bias.x = glm::dot(direction, separation) * baumgarte;
+			angularBias = angleError * baumgarte;
+			break;
+		}
+		case JOINT_TYPE::MOUSE:
+		{
+			//the spring is tuned for the body's mass, so it feels the same whatever is being dragged
+			Real bodyMass = A.iMass > 0 ? 1 / A.iMass : 0;
+			Real errorScale = 0;
+			if (bodyMass > 0)
+				SpringCoefficients(bodyMass, frequency, dampingRatio, deltaTime, gamma, errorScale);
+			InvertPointMass(A, B, rA, Vector2(0, 0), gamma, mass);
+			bias = (positionA + rA - target) * errorScale;
+			maxImpulse = maxForce * deltaTime;
+			break;
+		}
+		}
+
+		//warm start with last step's impulse
+		switch (type)
+		{
+		case JOINT_TYPE::DISTANCE:
+			A.ApplyImpulse(-impulse.x * direction, rA);
+			B.ApplyImpulse(impulse.x * direction, rB);
+			break;
+		case JOINT_TYPE::WELD:
+			A.angularVelocity -= A.iInertia * angularImpulse;
+			B.angularVelocity += B.iInertia * angularImpulse;
+			//fall through
+		case JOINT_TYPE::REVOLUTE:
+			A.ApplyImpulse(-impulse, rA);
+			B.ApplyImpulse(impulse, rB);
+			break;
+		case JOINT_TYPE::PRISMATIC:
+			A.velocity -= A.iMass * impulse.x * direction;
+			A.angularVelocity -= A.iInertia * (impulse.x * sA + angularImpulse);
+			B.velocity += B.iMass * impulse.x * direction;
+			B.angularVelocity += B.iInertia * (impulse.x * sB + angularImpulse);
+			break;
+		case JOINT_TYPE::MOUSE:
+			A.ApplyImpulse(impulse, rA);
+			break;
+		}
+		A.Store();
+		B.Store();
+	}
+
+	void Joint::Solve()
+	{
+		JointBody A(a), B(b);
+
+		switch (type)
+		{
+		case JOINT_TYPE::DISTANCE:
+		{
+			Real relativeVelocity = glm::dot(direction, B.VelocityAt(rB) - A.VelocityAt(rA));
+			Real lambda = -mass[0][0] * (relativeVelocity + bias.x + gamma * impulse.x);
+			impulse.x += lambda;
+			A.ApplyImpulse(-lambda * direction, rA);
+			B.ApplyImpulse(lambda * direction, rB);
+			break;
+		}
+		case JOINT_TYPE::WELD:
+		case JOINT_TYPE::REVOLUTE:
+		{
+			//the rotation is solved first, since the point constraint is the one that's more noticeable when it's off
+			if (type == JOINT_TYPE::WELD)
+			{
+				Real lambda = -angularMass * (B.angularVelocity - A.angularVelocity + angularBias);
+				angularImpulse += lambda;
+				A.angularVelocity -= A.iInertia * lambda;
+				B.angularVelocity += B.iInertia * lambda;
+			}
+
+			Vector2 lambda = -Multiply(mass, B.VelocityAt(rB) - A.VelocityAt(rA) + bias);
+			impulse += lambda;
+			A.ApplyImpulse(-lambda, rA);
+			B.ApplyImpulse(lambda, rB);
+			break;
+		}
+		case JOINT_TYPE::PRISMATIC:
+		{
+			Real angularLambda = -angularMass * (B.angularVelocity - A.angularVelocity + angularBias);
+			angularImpulse += angularLambda;
+			A.angularVelocity -= A.iInertia * angularLambda;
+			B.angularVelocity += B.iInertia * angularLambda;
+
+			Real relativeVelocity = glm::dot(direction, B.velocity - A.velocity) + sB * B.angularVelocity - sA * A.angularVelocity;
+			Real lambda = -mass[0][0] * (relativeVelocity + bias.x);
+			impulse.x += lambda;
+			A.velocity -= A.iMass * lambda * direction;
+			A.angularVelocity -= A.iInertia * lambda * sA;
+			B.velocity += B.iMass * lambda * direction;
+			B.angularVelocity += B.iInertia * lambda * sB;
+			break;
+		}
+		case JOINT_TYPE::MOUSE:
+		{
+			Vector2 lambda = -Multiply(mass, A.VelocityAt(rA) + bias + gamma * impulse);
+			//the total is clamped, not each iteration's part of it
+			Vector2 oldImpulse = impulse;
+			impulse += lambda;
+			Real lengthSquared = glm::dot(impulse, impulse);
+			if (lengthSquared > maxImpulse * maxImpulse)
+				impulse *= maxImpulse / em::Sqrt(lengthSquared);
+			A.ApplyImpulse(impulse - oldImpulse, rA);
+			break;
+		}
+		}
+		A.Store();
+		B.Store();
+	}
+}
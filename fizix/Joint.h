@@ -0,0 +1,149 @@
+#pragma once
+#include "Maths.h"
+
+//how much of a rigid joint's position error is fixed each step (the rest is left for later steps so it doesn't overshoot)
+#ifndef FZX_JOINT_BAUMGARTE
+#define FZX_JOINT_BAUMGARTE 0.2f
+#endif
+
+namespace fzx
+{
+	class PhysicsObject;
+	class PhysicsSystem;
+
+	enum class JOINT_TYPE : unsigned char
+	{
+		//keeps the anchors a set distance apart. a rod, or a spring if frequency isn't 0
+		DISTANCE,
+		//pins the bodies together at the anchor, they can still rotate around it
+		REVOLUTE,
+		//the bodies can only slide along the axis, without rotating relative to each other
+		PRISMATIC,
+		//glues the bodies together at the anchor
+		WELD,
+		//a soft spring pulling the anchor on a towards a target point (for dragging things around)
+		MOUSE
+	};
+
+	struct JointDesc
+	{
+		JOINT_TYPE type = JOINT_TYPE::DISTANCE;
+		PhysicsObject* a = nullptr;
+		//nullptr joins a to the world. mouse joints ignore this
+		PhysicsObject* b = nullptr;
+		//world space, where they are when the joint is created. only distance joints use anchorB, the others join both bodies at anchorA
+		Vector2 anchorA = Vector2(0, 0);
+		Vector2 anchorB = Vector2(0, 0);
+		//prismatic: the direction b slides along, world space (it turns with a)
+		Vector2 axis = Vector2(1, 0);
+		//distance: less than 0 uses the distance between the anchors
+		Real length = -1;
+		//distance and mouse: how stiff the spring is in hz, and how quickly it stops bouncing (1 doesn't bounce at all)
+		//0 makes a distance joint rigid. mouse joints always use a spring
+		Real frequency = 0;
+		Real dampingRatio = 0.7f;
+		//mouse: the most force the joint can use
+		Real maxForce = 1000;
+		//if false the two bodies don't collide with each other
+		bool collideConnected = false;
+		void* infoPointer = nullptr;
+
+		JointDesc() = default;
+		JointDesc(JOINT_TYPE type, PhysicsObject* a, PhysicsObject* b, Vector2 anchorA, Vector2 anchorB = Vector2(0, 0))
+			: type(type), a(a), b(b), anchorA(anchorA), anchorB(anchorB) {}
+	};
+
+	//joints are solved with the contacts, once per collision iteration. each joint keeps the impulse it used last step and starts the
+	//next step by applying it again (warm starting), so stacks of joints hold together even with only a few iterations
+	//
+	//anchors are stored relative to the bodies, so colliders should be added before the joint is made (adding them recentres the body)
+	class Joint
+	{
+	public:
+		inline JOINT_TYPE GetType() { return type; }
+		inline PhysicsObject* GetBodyA() { return a; }
+		//nullptr if the joint is attached to the world
+		inline PhysicsObject* GetBodyB() { return b; }
+		//unique within the PhysicsSystem that created this joint, never reused
+		inline unsigned int GetID() { return id; }
+		inline bool GetCollideConnected() { return collideConnected; }
+		void* GetInfoPointer() { return pointer; }
+		void SetInfoPointer(void* ptr) { pointer = ptr; }
+
+		//where the joint is attached to each body, in world space
+		Vector2 GetAnchorA();
+		Vector2 GetAnchorB();
+		//the impulse the joint applied to b last step (a got the opposite). mouse joints only push a, so it's the impulse on a
+		Vector2 GetImpulse();
+		inline Real GetAngularImpulse() { return angularImpulse; }
+
+		//mouse
+		inline Vector2 GetTarget() { return target; }
+		//wakes the body up, so it follows the target even if it had fallen asleep while held still
+		void SetTarget(Vector2 newTarget);
+		inline Real GetMaxForce() { return maxForce; }
+		inline void SetMaxForce(Real force) { maxForce = force; }
+
+		//distance
+		inline Real GetLength() { return length; }
+		inline void SetLength(Real newLength) { length = newLength; }
+
+		//distance and mouse
+		inline Real GetFrequency() { return frequency; }
+		inline void SetFrequency(Real hz) { frequency = hz; }
+		inline Real GetDampingRatio() { return dampingRatio; }
+		inline void SetDampingRatio(Real ratio) { dampingRatio = ratio; }
+
+	protected:
+		Joint(const JointDesc& desc);
+
+		//works out this step's effective masses and position errors, then applies last step's impulse
+		void Prepare(Real deltaTime);
+		//one iteration of the velocity solver
+		void Solve();
+
+		friend PhysicsSystem;
+
+		JOINT_TYPE type;
+		bool collideConnected;
+		PhysicsObject* a;
+		PhysicsObject* b;
+		unsigned int id = 0;
+		void* pointer;
+
+		//relative to each body's position (b's is in world space if there is no b)
+		Vector2 localAnchorA;
+		Vector2 localAnchorB;
+		//prismatic, relative to a
+		Vector2 localAxis;
+		//weld and prismatic: b's rotation minus a's when the joint was made
+		Real referenceAngle = 0;
+		Real length;
+		Real frequency;
+		Real dampingRatio;
+		Real maxForce;
+		Vector2 target;
+
+		//accumulated over the iterations, and kept for warm starting the next step. distance and prismatic joints only use x
+		Vector2 impulse = Vector2(0, 0);
+		Real angularImpulse = 0;
+
+		//per step solver data, worked out in Prepare
+		Vector2 rA;
+		Vector2 rB;
+		//distance: the direction between the anchors. prismatic: the direction across the axis
+		Vector2 direction;
+		//prismatic: how much the lateral constraint turns each body
+		Real sA;
+		Real sB;
+		//inverse of the 2x2 effective mass for point constraints, or the scalar effective mass in [0][0] for the others
+		Real mass[2][2];
+		Real angularMass;
+		//velocity the solver aims for, to take out the position error (or the spring's pull)
+		Vector2 bias;
+		Real angularBias;
+		//softness of springs, 0 for rigid joints
+		Real gamma;
+		Real maxImpulse;
+	};
+}
@@ -10,12 +10,23 @@
 
 namespace fzx
 {
+	//define FZX_DOUBLE_PRECISION to build everything with doubles, for big worlds (mainly servers) where floats lose precision far from the origin
+#ifdef FZX_DOUBLE_PRECISION
+	typedef double Real;
+	typedef glm::dvec2 Vector2;
+	typedef glm::dvec3 Vector3;
+	typedef glm::dmat2x2 Matrix2x2;
+	typedef glm::dmat4 Matrix4x4;
+	typedef glm::dmat3x3 Matrix3x3;
+#else
+	typedef float Real;
 	typedef glm::vec2 Vector2;
 	typedef glm::vec3 Vector3;
-	typedef glm::ivec2 Vector2Int;
 	typedef glm::mat2x2 Matrix2x2;
 	typedef glm::mat4 Matrix4x4;
 	typedef glm::mat3x3 Matrix3x3;
+#endif
+	typedef glm::ivec2 Vector2Int;
 }
 
 //copied from glm 
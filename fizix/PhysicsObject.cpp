@@ -2,23 +2,25 @@
 
 namespace fzx
 {
-	const float sleepVelocityMag = 0.0001f; //(these are also squared)
-	const float sleepAngularVelocityMag = 0.0001f;
-	const float sleepTime = 0.2f;
+	const Real sleepVelocityMag = 0.0001f; //(these are also squared)
+	const Real sleepAngularVelocityMag = 0.0001f;
+	const Real sleepTime = 0.2f;
 
 	PhysicsObject::PhysicsObject(PhysicsData& data) : transform(Transform(data.position, data.rotation)), bounciness(data.bounciness), drag(data.drag), angularDrag(data.angularDrag)
-		, staticFriction(data.staticFriction), dynamicFriction(data.dynamicFriction), isDynamic(data.isDynamic), isRotatable(data.isRotatable)
+		, staticFriction(data.staticFriction), dynamicFriction(data.dynamicFriction), isDynamic(data.isDynamic && !data.isKinematic), isRotatable(data.isRotatable), isKinematic(data.isKinematic)
 	{
 		iMass = 0;
 		iInertia = 0;
 
-		colliders = nullptr;
+		colliders = (Collider*)inlineColliders;
 		colliderCount = 0;
+		colliderCapacity = FZX_INLINE_COLLIDERS;
 
 		pointer = nullptr;
+		id = 0;
 	}
 
-	void PhysicsObject::Update(float deltaTime)
+	void PhysicsObject::Update(Real deltaTime)
 	{
 		transform.position += velocity * deltaTime;
 		transform.rotation += angularVelocity * deltaTime;
@@ -26,6 +28,14 @@ namespace fzx
 		//update transform
 		transform.UpdateData();
 
+		//kinematic bodies keep exactly the velocity they were given
+		if (isKinematic)
+		{
+			force = Vector2(0, 0);
+			torque = 0;
+			return;
+		}
+
 		velocity += force * iMass * deltaTime;
 		angularVelocity += torque * iInertia * deltaTime;
 
@@ -41,18 +51,26 @@ namespace fzx
 	void PhysicsObject::GenerateAABB() {
 		switch (colliderCount) {
 		case 0:
+			collisionLayers = 0;
+			collisionMasks = 0;
 			return;
 		case 1:
 			colliderAABB = colliders[0].CalculateAABB(transform);
+			collisionLayers = colliders[0].collisionLayer;
+			collisionMasks = colliders[0].collisionMask;
 			return;
 		default:
 		{
 			AABB aabbs[2];
 			aabbs[0] = colliders[0].CalculateAABB(transform);
+			collisionLayers = colliders[0].collisionLayer;
+			collisionMasks = colliders[0].collisionMask;
 
 			for (size_t i = 1; i < colliderCount; i++)
 			{
 				aabbs[1] = colliders[i].CalculateAABB(transform);
+				collisionLayers |= colliders[i].collisionLayer;
+				collisionMasks |= colliders[i].collisionMask;
 
 				aabbs[0].max.x = glm::max(aabbs[0].max.x, aabbs[1].max.x);
 				aabbs[0].max.y = glm::max(aabbs[0].max.y, aabbs[1].max.y);
@@ -65,31 +83,25 @@ namespace fzx
 		}
 	}
 
-	void PhysicsObject::AddCollider(Shape* shape, float density, bool recalculateMass, bool isTrigger)
+	void PhysicsObject::AddCollider(Shape* shape, Real density, bool recalculateMass, bool isTrigger)
 	{
-		assert(colliderCount != UCHAR_MAX);
-		
-		if (colliders == nullptr)
-		{
-			colliders = new Collider[1]{ Collider(shape, density, isTrigger) };
-			colliderCount = 1;
-
-		}
-		else
-		{
-			//move colliders
-			Collider* newColliders = new Collider[colliderCount + 1];
-			memcpy(newColliders, colliders, colliderCount * sizeof(Collider));
-			newColliders[colliderCount] = Collider(shape, density, isTrigger);
+		ColliderDesc desc = ColliderDesc(shape, density, isTrigger);
+		AddColliders(&desc, 1, recalculateMass);
+	}
 
-			//clear colliders without calling Collider delete functions (since that will cause the shapes to be deleted)
-			memset(colliders, 0, sizeof(Collider) * colliderCount);
-			delete[] colliders;
+	void PhysicsObject::AddColliders(const ColliderDesc* descs, unsigned char count, bool recalculateMass)
+	{
+		assert((int)colliderCount + count <= UCHAR_MAX);
 
-			colliders = nullptr;
-			colliders = newColliders;
+		bool wasDynamic = isDynamic;
+		ReserveColliders(colliderCount + count);
+		for (unsigned char i = 0; i < count; i++)
+		{
+			Collider* collider = new (&colliders[colliderCount]) Collider(descs[i].shape, descs[i].density, descs[i].isTrigger, descs[i].offset, descs[i].rotation);
+			collider->collisionLayer = descs[i].collisionLayer;
+			collider->collisionMask = descs[i].collisionMask;
 
-			if (!colliders[colliderCount].CanBeDynamic())
+			if (!collider->CanBeDynamic())
 				isDynamic = false;
 
 			colliderCount++;
@@ -100,11 +112,110 @@ namespace fzx
 			CalculateMass();
 			CentreShapesAboutZero();
 		}
+		Wake();
+		//the body's shape (and maybe whether it's static) has changed, so it might belong in another part of the broadphase
+		if (system)
+			system->OnCollidersChanged(this, wasDynamic);
+	}
+
+	void PhysicsObject::ReserveColliders(unsigned char count)
+	{
+		if (count <= colliderCapacity)
+			return;
+
+		//grow by at least double, so adding colliders one at a time doesn't reallocate every time
+		unsigned int newCapacity = glm::min(glm::max((unsigned int)count, colliderCapacity * 2u), (unsigned int)UCHAR_MAX);
+		Collider* newColliders = (Collider*)::operator new(sizeof(Collider) * newCapacity);
+
+		for (unsigned char i = 0; i < colliderCount; i++)
+		{
+			new (&newColliders[i]) Collider(std::move(colliders[i]));
+			colliders[i].~Collider();
+		}
+
+		if (!HasInlineColliders())
+			::operator delete(colliders);
+
+		colliders = newColliders;
+		colliderCapacity = (unsigned char)newCapacity;
+	}
+
+	void PhysicsObject::ClearColliders()
+	{
+		for (unsigned char i = 0; i < colliderCount; i++)
+			colliders[i].~Collider();
+
+		if (!HasInlineColliders())
+			::operator delete(colliders);
+
+		colliders = (Collider*)inlineColliders;
+		colliderCount = 0;
+		colliderCapacity = FZX_INLINE_COLLIDERS;
+	}
+
+	void PhysicsObject::CopyColliders(const PhysicsObject& other)
+	{
+		//the colliders copy constructor shares the shape, so this is cheap
+		ReserveColliders(other.colliderCount);
+		for (unsigned char i = 0; i < other.colliderCount; i++)
+			new (&colliders[i]) Collider(other.colliders[i]);
+		colliderCount = other.colliderCount;
+	}
+
+	void PhysicsObject::MoveColliders(PhysicsObject& other)
+	{
+		if (other.HasInlineColliders())
+		{
+			for (unsigned char i = 0; i < other.colliderCount; i++)
+			{
+				new (&colliders[i]) Collider(std::move(other.colliders[i]));
+				other.colliders[i].~Collider();
+			}
+			colliderCount = other.colliderCount;
+		}
+		else
+		{
+			//heap colliders can just be taken
+			colliders = other.colliders;
+			colliderCount = other.colliderCount;
+			colliderCapacity = other.colliderCapacity;
+		}
 
+		other.colliders = (Collider*)other.inlineColliders;
+		other.colliderCount = 0;
+		other.colliderCapacity = FZX_INLINE_COLLIDERS;
+	}
+
+	void PhysicsObject::SetAwake(bool awake)
+	{
+		isAwake = awake;
+		sleepTime = 0;
+		if (!awake)
+		{
+			velocity = Vector2(0, 0);
+			angularVelocity = 0;
+			force = Vector2(0, 0);
+			torque = 0;
+		}
+	}
+
+	void PhysicsObject::Moved()
+	{
+		Wake();
+		if (!isDynamic && !isKinematic && system)
+		{
+			system->staticDirty = true;
+			if (!staticMoved)
+			{
+				staticMoved = true;
+				system->movedStaticBodies.push_back(this);
+			}
+		}
 	}
 
 	void PhysicsObject::AddForceAtPosition(Vector2 force, Vector2 point)
 	{
+		Wake();
 		this->force += force;
 		//transform.position should actually be the center point of the collider
 		this->torque += em::Cross(point - transform.position, force);
@@ -112,6 +223,7 @@ namespace fzx
 
 	void PhysicsObject::AddImpulseAtPosition(Vector2 impulse, Vector2 point)
 	{
+		Wake();
 		this->velocity += impulse * iMass;
 
 		//transform.position should be the centre of mass
@@ -120,6 +232,7 @@ namespace fzx
 
 	void PhysicsObject::AddVelocityAtPosition(Vector2 velocity, Vector2 point)
 	{
+		Wake();
 		this->velocity += velocity;
 
 		//transform.position should be the centre of mass
@@ -128,9 +241,7 @@ namespace fzx
 
 	PhysicsObject::~PhysicsObject()
 	{
-		if (colliders)
-			delete[] colliders;
-		colliders = nullptr;
+		ClearColliders();
 	}
 
 	void PhysicsObject::CentreShapesAboutZero(bool translateBody)
@@ -144,41 +255,28 @@ namespace fzx
 
 		Vector2 centrePoint = Vector2(0,0);
 
-		float totalArea = 0;
+		Real totalArea = 0;
 		for (unsigned char i = 0; i < colliderCount; i++)
 		{
-			float area = colliders[i].GetArea();
+			Real area = colliders[i].GetArea();
 			totalArea += area;
-			centrePoint += colliders[i].GetShape()->GetCentrePoint() * area;
+			centrePoint += colliders[i].GetCentrePoint() * area;
 		}
 
+		//no colliders (or only ones without any area) means there's no centre to move to
+		if (totalArea == 0)
+			return;
 		centrePoint /= totalArea;
 
 		//if centrePoint is not zero then all shapes need to be translated until it is zero
+		//this moves the colliders instead of the shapes, since the shapes could be shared with other bodies
 		for (unsigned char i = 0; i < colliderCount; i++)
 		{
-			Shape* s = colliders[i].GetShape();
-			switch (s->GetType())
-			{
-			case SHAPE_TYPE::CIRCLE:
-				((CircleShape*)s)->centrePoint -= centrePoint;
-				break;
-			case SHAPE_TYPE::CAPSULE:
-				((CapsuleShape*)s)->pointA -= centrePoint;
-				((CapsuleShape*)s)->pointB -= centrePoint;
-				break;
-			case SHAPE_TYPE::POLYGON:
-			{
-				PolygonShape* pShape = (PolygonShape*)s;
-				for (size_t i = 0; i < pShape->pointCount; i++)
-				{
-					pShape->points[i] -= centrePoint;
-				}
-			}
-				break;
-			default:
+			if (!colliders[i].CanBeDynamic())
 				return;
-			}
+
+			Transform& local = colliders[i].GetLocalTransform();
+			colliders[i].SetLocalTransform(local.position - centrePoint, local.rotation);
 		}
 		
 		if (translateBody)
@@ -188,14 +286,13 @@ namespace fzx
 
 		//do this to recalculate inertia in the new context
 		CalculateMass();
-		std::cout << "Inertia: " << (1.0f / iInertia) << ", Mass: " << (1.0f/ iMass) << ", Centrepoint: (" << transform.position.x << ", " << transform.position.y << ")\n";
 
 	}
 
 	void PhysicsObject::CalculateMass()
 	{
-		float mass = 0;
-		float inertia = 0;
+		Real mass = 0;
+		Real inertia = 0;
 
 		if (!isDynamic || !CanBeDynamic())
 		{
@@ -206,9 +303,9 @@ namespace fzx
 
 		for (size_t i = 0; i < colliderCount; i++)
 		{
-			float colliderMass = 0;
+			Real colliderMass = 0;
 			//inertia of composite shape = sum of individual inertias
-			float colliderInertia = 0;
+			Real colliderInertia = 0;
 
 			colliders[i].CalculateMass(colliderMass, colliderInertia);
 
@@ -240,13 +337,10 @@ namespace fzx
 
 	PhysicsObject::PhysicsObject(const PhysicsObject& other) : staticFriction(other.staticFriction), dynamicFriction(other.dynamicFriction)
 	{
-		colliders = (Collider*)(new char[sizeof(Collider) * other.colliderCount]);
-		memcpy(colliders, other.colliders, sizeof(Collider) * other.colliderCount);
-		colliderCount = other.colliderCount;
-		/*for (size_t i = 0; i < colliderCount; i++)
-		{
-			colliders[i].SetAttached(this);
-		}*/
+		colliders = (Collider*)inlineColliders;
+		colliderCount = 0;
+		colliderCapacity = FZX_INLINE_COLLIDERS;
+		CopyColliders(other);
 
 		transform = other.transform;
 		velocity = other.velocity;
@@ -260,14 +354,19 @@ namespace fzx
 		iInertia = other.iInertia;
 		isDynamic = other.isDynamic;
 		isRotatable = other.isRotatable;
+		isKinematic = other.isKinematic;
 		pointer = other.pointer;
+		id = other.id;
+		collisionLayers = other.collisionLayers;
+		collisionMasks = other.collisionMasks;
 	}
 
 	PhysicsObject::PhysicsObject(PhysicsObject&& other) : staticFriction(other.staticFriction), dynamicFriction(other.dynamicFriction)
 	{
-		colliders = other.colliders;
-		other.colliders = nullptr;
-		colliderCount = other.colliderCount;
+		colliders = (Collider*)inlineColliders;
+		colliderCount = 0;
+		colliderCapacity = FZX_INLINE_COLLIDERS;
+		MoveColliders(other);
 
 		transform = other.transform;
 		velocity = other.velocity;
@@ -281,17 +380,20 @@ namespace fzx
 		iInertia = other.iInertia;
 		isDynamic = other.isDynamic;
 		isRotatable = other.isRotatable;
+		isKinematic = other.isKinematic;
 		pointer = other.pointer;
+		id = other.id;
+		collisionLayers = other.collisionLayers;
+		collisionMasks = other.collisionMasks;
 	}
 
 	PhysicsObject& PhysicsObject::operator=(const PhysicsObject& other)
 	{
-		if (colliders)
-			delete[] colliders;
-		colliders = (Collider*)(new char[sizeof(Collider) * other.colliderCount]);
-		memcpy(colliders, other.colliders, sizeof(Collider) * other.colliderCount);
-		colliderCount = other.colliderCount;
+		if (this == &other)
+			return *this;
 
+		ClearColliders();
+		CopyColliders(other);
 
 		staticFriction = other.staticFriction;
 		dynamicFriction = other.dynamicFriction;
@@ -308,23 +410,22 @@ namespace fzx
 
 		isDynamic = other.isDynamic;
 		isRotatable = other.isRotatable;
+		isKinematic = other.isKinematic;
 		pointer = other.pointer;
+		id = other.id;
+		collisionLayers = other.collisionLayers;
+		collisionMasks = other.collisionMasks;
 
 		return *this;
 	}
 
 	PhysicsObject& PhysicsObject::operator=(PhysicsObject&& other)
 	{
-		if (colliders)
-			delete[] colliders;
-		colliders = other.colliders;
-		/*for (size_t i = 0; i < colliderCount; i++)
-		{
-			colliders[i].SetAttached(this);
+		if (this == &other)
+			return *this;
 
-		}*/
-		colliderCount = other.colliderCount;
-		other.colliders = nullptr;
+		ClearColliders();
+		MoveColliders(other);
 
 		staticFriction = other.staticFriction;
 		dynamicFriction = other.dynamicFriction;
@@ -341,7 +442,11 @@ namespace fzx
 
 		isDynamic = other.isDynamic;
 		isRotatable = other.isRotatable;
+		isKinematic = other.isKinematic;
 		pointer = other.pointer;
+		id = other.id;
+		collisionLayers = other.collisionLayers;
+		collisionMasks = other.collisionMasks;
 
 		return *this;
 	}
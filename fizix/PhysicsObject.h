@@ -3,6 +3,22 @@
 #include "Collider.h"
 #include "Transform.h"
 
+#ifndef FZX_INLINE_COLLIDERS
+#define FZX_INLINE_COLLIDERS 4
+#endif // !FZX_INLINE_COLLIDERS
+
+//a body is resting while it stays this close to (and turned this many radians from) where it started resting, and falls asleep once it
+//has rested for FZX_TIME_TO_SLEEP. it's measured by position rather than velocity, since resting contacts jitter by about gravity * deltaTime every step
+#ifndef FZX_SLEEP_LINEAR_TOLERANCE
+#define FZX_SLEEP_LINEAR_TOLERANCE 0.02f
+#endif
+#ifndef FZX_SLEEP_ANGULAR_TOLERANCE
+#define FZX_SLEEP_ANGULAR_TOLERANCE 0.035f
+#endif
+#ifndef FZX_TIME_TO_SLEEP
+#define FZX_TIME_TO_SLEEP 0.5f
+#endif
+
 namespace fzx
 {
 	class PhysicsSystem;
@@ -11,21 +27,23 @@ namespace fzx
 	{
 		Vector2 position;
 		Vector2 scale = Vector2(1.0f, 1.0f);
-		float rotation;
+		Real rotation;
 
-		float bounciness;
-		float drag;
-		float angularDrag;
+		Real bounciness;
+		Real drag;
+		Real angularDrag;
 		bool isDynamic = false;
 		bool isRotatable = true;
+		//moved only by its velocity, like a moving platform. it pushes dynamic bodies but is never pushed back (this overrides isDynamic)
+		bool isKinematic = false;
 		//will automatically calculate mass and moment of inertia if equal to -1
-		float mass = -1;
+		Real mass = -1;
 
-		float staticFriction;
-		float dynamicFriction;
+		Real staticFriction;
+		Real dynamicFriction;
 		PhysicsData() = default;
-		PhysicsData(Vector2 position, float rotation, bool isDynamic = true, bool isRotatable = true, float bounciness = 0.2f,
-			float drag = 0.1f, float angularDrag = 0.1f, float mass = -1, float staticFriction = 0.9f, float dynamicFriction = 0.5f)
+		PhysicsData(Vector2 position, Real rotation, bool isDynamic = true, bool isRotatable = true, Real bounciness = 0.2f,
+			Real drag = 0.1f, Real angularDrag = 0.1f, Real mass = -1, Real staticFriction = 0.9f, Real dynamicFriction = 0.5f)
 			: position(position), rotation(rotation), isDynamic(isDynamic), isRotatable(isRotatable), bounciness(bounciness), drag(drag), angularDrag(angularDrag), mass(mass), staticFriction(staticFriction), dynamicFriction(dynamicFriction)
 		{}
 	};
@@ -36,61 +54,77 @@ namespace fzx
 	{
 	public:
 
-		void Update(float deltaTime);
+		void Update(Real deltaTime);
 		void GenerateAABB();
 
 		//getters
 		inline Collider& GetCollider(unsigned char index) { return colliders[index]; }
 		inline unsigned char	GetColliderCount() { return colliderCount; }
 		inline AABB& GetAABB() { return colliderAABB; }
+		//union of every collider's layer and mask, updated with the AABB
+		inline unsigned short GetCollisionLayers() { return collisionLayers; }
+		inline unsigned short GetCollisionMasks() { return collisionMasks; }
 		inline Vector2		GetPosition() { return transform.position; }
-		inline float		GetRotation() { return transform.rotation; }
+		inline Real		GetRotation() { return transform.rotation; }
 
 		inline Vector2		GetVelocity() { return velocity; }
-		inline float		GetAngularVelocity() { return angularVelocity; }
+		inline Real		GetAngularVelocity() { return angularVelocity; }
 		inline Vector2		GetForce() { return force; }
-		inline float		GetTorque() { return torque; }
-
-		inline float		GetBounciness() { return bounciness; }
-		inline float		GetDrag() { return drag; }
-		inline float		GetAngularDrag() { return angularDrag; }
-		inline float		GetMass() { return 1.0f / iMass; }
-		inline float		GetInertia() { return 1.0f / iInertia; }
-		inline float		GetInverseMass() { return iMass; }
-		inline float		GetInverseInertia() { return iInertia; }
+		inline Real		GetTorque() { return torque; }
+
+		inline Real		GetBounciness() { return bounciness; }
+		inline Real		GetDrag() { return drag; }
+		inline Real		GetAngularDrag() { return angularDrag; }
+		inline Real		GetMass() { return 1.0f / iMass; }
+		inline Real		GetInertia() { return 1.0f / iInertia; }
+		inline Real		GetInverseMass() { return iMass; }
+		inline Real		GetInverseInertia() { return iInertia; }
 		inline Transform& GetTransform() { return transform; }
 		void* GetInfoPointer() { return pointer; }
+		//unique within the PhysicsSystem that created this object, never reused
+		inline unsigned int	GetID() { return id; }
+		inline bool IsKinematic() { return isKinematic; }
+		//sleeping bodies aren't moved or collided with each other until something touches them
+		inline bool IsAwake() { return isAwake; }
 
 		//setters
-		inline void	SetPosition(Vector2 pos) { transform.position = pos; }
-		inline void	SetRotation(float rot) { transform.rotation = rot; }
-
-		inline void	SetVelocity(Vector2 vel) { velocity = vel; }
-		inline void	SetAngularVelocity(float aVel) { angularVelocity = aVel; }
-		inline void	SetForce(Vector2 force) { this->force = force; }
-		inline void	SetTorque(float torque) { this->torque = torque; }
-
-		inline void	SetBounciness(float bounce) { bounciness = bounce; }
-		inline void	SetDrag(float drag) { this->drag = drag; }
-		inline void	SetAngularDrag(float aDrag) { this->angularDrag = aDrag; }
-		inline void	SetMass(float mass) { this->iMass = 1.0f / mass; }
-		inline void	SetInertia(float mOI) { iInertia = 1.0f / mOI; }
-		inline void	SetInverseMass(float iMass) { this->iMass = iMass; }
-		inline void	SetInverseInertia(float iMOI) { iInertia = iMOI; }
+		//these all wake the body up, since it could be asleep in a pile that has to react to the change.
+		//static bodies are only moved by these (not by velocity), and their part of the broadphase is rebuilt after
+		inline void	SetPosition(Vector2 pos) { transform.position = pos; Moved(); }
+		inline void	SetRotation(Real rot) { transform.rotation = rot; Moved(); }
+
+		inline void	SetVelocity(Vector2 vel) { velocity = vel; Wake(); }
+		inline void	SetAngularVelocity(Real aVel) { angularVelocity = aVel; Wake(); }
+		inline void	SetForce(Vector2 force) { this->force = force; Wake(); }
+		inline void	SetTorque(Real torque) { this->torque = torque; Wake(); }
+		//putting a body to sleep stops it. the rest of its island will wake it again next step if they are still moving
+		void SetAwake(bool awake);
+
+		inline void	SetBounciness(Real bounce) { bounciness = bounce; }
+		inline void	SetDrag(Real drag) { this->drag = drag; }
+		inline void	SetAngularDrag(Real aDrag) { this->angularDrag = aDrag; }
+		inline void	SetMass(Real mass) { this->iMass = 1.0f / mass; }
+		inline void	SetInertia(Real mOI) { iInertia = 1.0f / mOI; }
+		inline void	SetInverseMass(Real iMass) { this->iMass = iMass; }
+		inline void	SetInverseInertia(Real iMOI) { iInertia = iMOI; }
 		void SetInfoPointer(void* ptr) { pointer = ptr;  };
 
 		//adders?
-		inline void AddPosition(Vector2 position) { transform.position += position; }
-		inline void AddForce(Vector2 force) { this->force += force; }
-		inline void AddTorque(float torque) { this->torque += torque; }
-		inline void AddVelocity(Vector2 velocity) { this->velocity += velocity; }
-		inline void AddAngularVelocity(float velocity) { angularVelocity += velocity; }
-		inline void AddImpulse(Vector2 impulse) { velocity += impulse * iMass; }
-		inline void AddAngularImpulse(float impulse) { angularVelocity += impulse * iInertia; }
+		inline void AddPosition(Vector2 position) { transform.position += position; Moved(); }
+		inline void AddForce(Vector2 force) { this->force += force; Wake(); }
+		inline void AddTorque(Real torque) { this->torque += torque; Wake(); }
+		inline void AddVelocity(Vector2 velocity) { this->velocity += velocity; Wake(); }
+		inline void AddAngularVelocity(Real velocity) { angularVelocity += velocity; Wake(); }
+		inline void AddImpulse(Vector2 impulse) { velocity += impulse * iMass; Wake(); }
+		inline void AddAngularImpulse(Real impulse) { angularVelocity += impulse * iInertia; Wake(); }
 		void AddForceAtPosition(Vector2 force, Vector2 point);
 		void AddImpulseAtPosition(Vector2 force, Vector2 point);
 		void AddVelocityAtPosition(Vector2 impulse, Vector2 point);
-		void AddCollider(Shape* shape, float density = 1.0f, bool recalculateMass = true, bool isTrigger = false);
+		void AddCollider(Shape* shape, Real density = 1.0f, bool recalculateMass = true, bool isTrigger = false);
+		//adds count colliders, only recalculating mass and recentring once at the end
+		void AddColliders(const ColliderDesc* descs, unsigned char count, bool recalculateMass = true);
+		//makes sure count colliders can be added without reallocating
+		void ReserveColliders(unsigned char count);
 
 		//rule o' 5
 		PhysicsObject(const PhysicsObject& other); //copy constructor
@@ -106,12 +140,31 @@ namespace fzx
 		//if translateBody is true, it translates the physicsBody so that the shapes keep the same worldspace position
 		void CentreShapesAboutZero(bool translateBody = true);
 
+		inline void Wake() { isAwake = true; sleepTime = 0; }
+		//wakes the body, and tells the system if a static body has moved
+		void Moved();
+		//bodies that nothing can push (static ones, or ones with their mass set to infinite) don't join islands, so piles on the same floor are solved separately
+		inline bool IsFixed() { return iMass == 0 && iInertia == 0; }
+
+		inline bool HasInlineColliders() { return colliders == (Collider*)inlineColliders; }
+		//destructs every collider and goes back to inline storage
+		void ClearColliders();
+		void CopyColliders(const PhysicsObject& other);
+		void MoveColliders(PhysicsObject& other);
+
 		friend PhysicsSystem;
 		friend Collider;
+		//joints change velocities without waking bodies, like contacts
+		friend struct JointBody;
 
 		AABB colliderAABB;
+		unsigned short collisionLayers = 0;
+		unsigned short collisionMasks = 0;
+		//points at inlineColliders until there are more than FZX_INLINE_COLLIDERS, then at a heap array
 		Collider* colliders;
 		unsigned char colliderCount;
+		unsigned char colliderCapacity;
+		alignas(Collider) unsigned char inlineColliders[sizeof(Collider) * FZX_INLINE_COLLIDERS];
 
 		//position values
 		//should be no problem with vec2 scale since there are no child objects
@@ -119,31 +172,43 @@ namespace fzx
 
 		//movement values
 		Vector2 velocity = Vector2(0, 0);
-		float angularVelocity = 0;
+		Real angularVelocity = 0;
 		Vector2 force = Vector2(0, 0);
-		float torque = 0;
+		Real torque = 0;
 
 		void CalculateMass();
 		bool CanBeDynamic();
 
 		//movement constants
-		float bounciness;
-		float drag;
-		float angularDrag;
-		float iMass;
-		float staticFriction;
-		float dynamicFriction;
+		Real bounciness;
+		Real drag;
+		Real angularDrag;
+		Real iMass;
+		Real staticFriction;
+		Real dynamicFriction;
 		//the mass moment of inertia
-		float iInertia;
+		Real iInertia;
 
 		bool isDynamic;
 		bool isRotatable;
+		bool isKinematic;
 
 		//pointer, so you can 'attach' information to the physics object
 		void* pointer;
 
+		//set by the PhysicsSystem
+		unsigned int id;
+		PhysicsSystem* system = nullptr;
+		//static bodies only: set when it is moved, until the system has woken whatever was touching it
+		bool staticMoved = false;
+
 		//(just in case something is not moving, so no movement calculations have to be done)
-		//bool 
-		//float sleepTimer = 0;
+		bool isAwake = true;
+		//how long the body has been resting for, and where it started resting
+		Real sleepTime = 0;
+		Vector2 sleepPosition = Vector2(0, 0);
+		Real sleepRotation = 0;
+		//index in the PhysicsSystem's body list for the island union-find, set whenever the broadphase is rebuilt
+		unsigned int solverIndex = 0;
 	};
 }
\ No newline at end of file
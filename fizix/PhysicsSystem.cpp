@@ -1,4 +1,5 @@
 #include "fzx.h"
+#include <algorithm>
 
 #ifndef FZX_COLLISIONROTATION
 #define FZX_COLLISIONROTATION
@@ -9,298 +10,1326 @@
 
 namespace fzx
 {
-	CollideFunction PhysicsSystem::collisionFunctions[4][4] =
+	//pairs are ordered so the first shape type is never bigger than the second, so only the top half is used
+	static const COLLISION_TYPE pairTypes[4][4] =
 	{
-		{ CollideCircleCircle,	CollideCirclePolygon,	CollideCircleCapsule,	CollideCirclePlane	},
-		{ CollidePolygonCircle,	CollidePolygonPolygon,	CollidePolygonCapsule,	CollidePolygonPlane	},
-		{ CollideCapsuleCircle,	CollideCapsulePolygon,	CollideCapsuleCapsule,	CollideCapsulePlane },
-		{ CollidePlaneCircle,	CollidePlanePolygon,	CollidePlaneCapsule,	CollideInvalid		}
+		{ COLLISION_TYPE::CIRCLECIRCLE,	COLLISION_TYPE::CIRCLEPOLYGON,	COLLISION_TYPE::CIRCLECAPSULE,	COLLISION_TYPE::CIRCLEPLANE	},
+		{ COLLISION_TYPE::INVALID,		COLLISION_TYPE::POLYGONPOLYGON,	COLLISION_TYPE::POLYGONCAPSULE,	COLLISION_TYPE::POLYGONPLANE	},
+		{ COLLISION_TYPE::INVALID,		COLLISION_TYPE::INVALID,		COLLISION_TYPE::CAPSULECAPSULE,	COLLISION_TYPE::CAPSULEPLANE	},
+		{ COLLISION_TYPE::INVALID,		COLLISION_TYPE::INVALID,		COLLISION_TYPE::INVALID,		COLLISION_TYPE::INVALID		}
 	};
 
-	void PhysicsSystem::ResolveCollisions()
+	//works for ContactEvent, TriggerEvent and CollisionData
+	template<typename Event>
+	static bool EventKeyLess(const Event& l, const Event& r)
+	{
+		if (l.a->GetID() != r.a->GetID()) return l.a->GetID() < r.a->GetID();
+		if (l.b->GetID() != r.b->GetID()) return l.b->GetID() < r.b->GetID();
+		if (l.colliderIndexA != r.colliderIndexA) return l.colliderIndexA < r.colliderIndexA;
+		return l.colliderIndexB < r.colliderIndexB;
+	}
+
+	void PhysicsSystem::ResolveCollisions(bool firstIteration)
 	{
 		if (bodies.size() < 2)
 			return;
 
-		collisions.clear();
+		for (auto& bucket : collisions)
+			bucket.clear();
+
+		//only bodies that have moved need new AABBs: awake ones on the first iteration, and ones in islands that resolved something after that.
+		//static bodies keep theirs until they are moved
+		for (auto* body : movingBodies)
+		{
+			if (firstIteration ? body->isAwake : !settledBodies[body->solverIndex])
+				body->GenerateAABB();
+		}
+
+		//bodies have moved a lot since last step, so rebuild the trees. after that only small corrections happen, so refitting is enough
+		if (firstIteration)
+			broadphase.Build(movingBodies);
+		else
+			broadphase.Refit();
 
+		collectTriggers = firstIteration;
+		skipSettled = !firstIteration;
+		//kinematic bodies can only be in triggers with static and kinematic bodies, so those pairs are only found on the first iteration
+		broadphase.FindPairs(OnBroadphasePair, this, firstIteration);
+
+#ifdef FZX_DETERMINISTIC
+		//the broadphase finds pairs in tree order, which depends on how the trees happened to be built.
+		//sorting by ID makes the resolve order depend only on the bodies themselves (so rebuilding or restoring the world can't change it)
+		for (auto& bucket : collisions)
+			std::stable_sort(bucket.begin(), bucket.end(), EventKeyLess<CollisionData>);
+#endif
+
+		//now that all the potential collisions have been found, split them into islands. no body is in two islands, so they can be solved at the same time
+		BuildIslands();
+		if (solverScratch.size() < workers.GetThreadCount())
+			solverScratch.resize(workers.GetThreadCount());
+		workers.Run(islandCount, SolveIslandJob, this);
+
+		//GenerateContactEvents sorts these, so the order the threads finished in doesn't matter
+		for (auto& scratch : solverScratch)
+		{
+			stepContacts.insert(stepContacts.end(), scratch.contacts.begin(), scratch.contacts.end());
+			scratch.contacts.clear();
+		}
+
+		//an island that didn't resolve anything hasn't moved, so next iteration would find exactly the same (nothing) for its pairs
 		for (size_t i = 0; i < bodies.size(); i++)
+			settledBodies[i] = bodyIslands[i] == UINT_MAX || !islandContacts[bodyIslands[i]];
+	}
+
+	unsigned int PhysicsSystem::FindIsland(unsigned int index)
+	{
+		while (islandParents[index] != index)
 		{
-			bodies[i]->GenerateAABB();
+			//path halving
+			islandParents[index] = islandParents[islandParents[index]];
+			index = islandParents[index];
 		}
+		return index;
+	}
+
+	void PhysicsSystem::UnionIslands(PhysicsObject* a, PhysicsObject* b)
+	{
+		if (!a || !b || a->IsFixed() || b->IsFixed())
+			return;
+
+		unsigned int rootA = FindIsland(a->solverIndex);
+		unsigned int rootB = FindIsland(b->solverIndex);
+		//the lower index is always the root, so islands come out the same no matter what order the pairs were joined in
+		if (rootA < rootB)
+			islandParents[rootB] = rootA;
+		else if (rootB < rootA)
+			islandParents[rootA] = rootB;
+	}
+
+	void PhysicsSystem::BuildIslands()
+	{
+		size_t bodyCount = bodies.size();
+		islandParents.resize(bodyCount);
+		for (size_t i = 0; i < bodyCount; i++)
+			islandParents[i] = (unsigned int)i;
 
-		for (int i = 0; i < bodies.size() - 1; i++)
+		for (auto& bucket : collisions)
 		{
-			//int cc1 = bodies[i]->GetColliderCount();
-			//skip over if is not active
-			if (bodies[i]->GetColliderCount() == 0)
+			for (auto& pair : bucket)
+				UnionIslands(pair.a, pair.b);
+		}
+		for (auto* joint : activeJoints)
+			UnionIslands(joint->a, joint->b);
+
+		//a pair's island is the island of whichever of its bodies can move (the broadphase never pairs two fixed bodies)
+		auto islandBody = [](CollisionData& pair) { return pair.a->IsFixed() ? pair.b : pair.a; };
+
+		//islands are numbered in the order their first pair was found, so the numbering doesn't depend on the threads
+		islandOfRoot.assign(bodyCount, UINT_MAX);
+		islandCount = 0;
+		for (auto& bucket : collisions)
+		{
+			for (auto& pair : bucket)
 			{
-				continue;
+				unsigned int root = FindIsland(islandBody(pair)->solverIndex);
+				if (islandOfRoot[root] == UINT_MAX)
+					islandOfRoot[root] = (unsigned int)islandCount++;
 			}
+		}
 
-			for (int j = i + 1; j < bodies.size(); j++)
-			{
-				//int cc2 = bodies[i]->GetColliderCount();
-				if (bodies[i]->GetColliderCount() == 0)
-					continue;
+		bodyIslands.assign(bodyCount, UINT_MAX);
+		for (auto* body : movingBodies)
+		{
+			if (!body->IsFixed())
+				bodyIslands[body->solverIndex] = islandOfRoot[FindIsland(body->solverIndex)];
+		}
+		islandContacts.assign(islandCount, 0);
 
-				//broad phase
-				//this checks if the AABBs are colliding
+		//counting sort each bucket by island. it's stable, so each island's pairs are still in the order they would have been solved in one flat loop
+		for (int type = 0; type < (int)COLLISION_TYPE::COUNT; type++)
+		{
+			std::vector<CollisionData>& bucket = collisions[type];
+			std::vector<unsigned int>& ranges = islandRanges[type];
+			ranges.assign(islandCount + 1, 0);
+			if (bucket.empty())
+				continue;
 
-				if (CheckAABBCollision(bodies[i]->GetAABB(), bodies[j]->GetAABB()))
-				{
-					//in this case we need to check if collision is valid, and if so, resolve it
-					//we add it to collisions for this frame
-					//collisions.emplace_back(CollisionData(bodies[i], bodies[j]));
+			for (auto& pair : bucket)
+				ranges[bodyIslands[islandBody(pair)->solverIndex] + 1]++;
+			for (size_t i = 1; i <= islandCount; i++)
+				ranges[i] += ranges[i - 1];
+
+			//ranges[i] is used as the write position for island i, which leaves it at the start of island i + 1
+			islandSortScratch.resize(bucket.size());
+			for (auto& pair : bucket)
+				islandSortScratch[ranges[bodyIslands[islandBody(pair)->solverIndex]]++] = pair;
+			for (size_t i = islandCount; i > 0; i--)
+				ranges[i] = ranges[i - 1];
+			ranges[0] = 0;
+			bucket.swap(islandSortScratch);
+		}
+	}
+
+	void PhysicsSystem::SolveIslandJob(size_t island, unsigned int thread, void* infoPtr)
+	{
+		PhysicsSystem* system = (PhysicsSystem*)infoPtr;
+		system->SolveIsland(island, system->solverScratch[thread]);
+	}
+
+	void PhysicsSystem::SolveIsland(size_t island, SolverScratch& scratch)
+	{
+		size_t contactCount = scratch.contacts.size();
+		auto pairs = [this, island](COLLISION_TYPE type) { return collisions[(int)type].data() + islandRanges[(int)type][island]; };
+		auto count = [this, island](COLLISION_TYPE type) { return (size_t)(islandRanges[(int)type][island + 1] - islandRanges[(int)type][island]); };
+
+		//resolve collisions one bucket at a time
+		ResolveCircleCircleBucket(pairs(COLLISION_TYPE::CIRCLECIRCLE), count(COLLISION_TYPE::CIRCLECIRCLE), scratch);
+		ResolveBucket<CircleShape, PolygonShape, CollideCirclePolygon>(pairs(COLLISION_TYPE::CIRCLEPOLYGON), count(COLLISION_TYPE::CIRCLEPOLYGON), scratch);
+		ResolveBucket<CircleShape, CapsuleShape, CollideCircleCapsule>(pairs(COLLISION_TYPE::CIRCLECAPSULE), count(COLLISION_TYPE::CIRCLECAPSULE), scratch);
+		ResolveCirclePlaneBucket(pairs(COLLISION_TYPE::CIRCLEPLANE), count(COLLISION_TYPE::CIRCLEPLANE), scratch);
+		ResolveBucket<PolygonShape, PolygonShape, CollidePolygonPolygon>(pairs(COLLISION_TYPE::POLYGONPOLYGON), count(COLLISION_TYPE::POLYGONPOLYGON), scratch);
+		ResolveBucket<PolygonShape, CapsuleShape, CollidePolygonCapsule>(pairs(COLLISION_TYPE::POLYGONCAPSULE), count(COLLISION_TYPE::POLYGONCAPSULE), scratch);
+		ResolveBucket<PolygonShape, PlaneShape, CollidePolygonPlane>(pairs(COLLISION_TYPE::POLYGONPLANE), count(COLLISION_TYPE::POLYGONPLANE), scratch);
+		ResolveBucket<CapsuleShape, CapsuleShape, CollideCapsuleCapsule>(pairs(COLLISION_TYPE::CAPSULECAPSULE), count(COLLISION_TYPE::CAPSULECAPSULE), scratch);
+		ResolveBucket<CapsuleShape, PlaneShape, CollideCapsulePlane>(pairs(COLLISION_TYPE::CAPSULEPLANE), count(COLLISION_TYPE::CAPSULEPLANE), scratch);
+
+		islandContacts[island] = scratch.contacts.size() != contactCount;
+	}
+
+	template<typename ShapeA, typename ShapeB, bool (*Collide)(ShapeA*, ShapeB*, CollisionData&)>
+	void PhysicsSystem::ResolveBucket(CollisionData* pairs, size_t count, SolverScratch& scratch)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			CollisionData& data = pairs[i];
+			Collider& cA = data.a->colliders[data.colliderIndexA];
+			Collider& cB = data.b->colliders[data.colliderIndexB];
+			data.transformA = cA.GetWorldTransform(data.a->transform);
+			data.transformB = cB.GetWorldTransform(data.b->transform);
 
-					for (char u = 0; u < bodies[i]->GetColliderCount(); u++)
+			if (Collide((ShapeA*)cA.shape, (ShapeB*)cB.shape, data))
+				ResolveCollision(data, scratch);
+		}
+	}
+
+	//unlike ResolveBucket, every pair in the bucket is collided before any of them are resolved. so a pair's contact comes from where its circles
+	//were at the start of this pass, even if an earlier pair in the bucket has already pushed one of them (the later iterations correct for it)
+	void PhysicsSystem::ResolveCircleCircleBucket(CollisionData* pairs, size_t count, SolverScratch& scratch)
+	{
+		if (count == 0)
+			return;
+
+		CircleBatch& circleBatch = scratch.circleBatch;
+		std::vector<CircleContact>& circleContacts = scratch.circleContacts;
+		circleBatch.Resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			CollisionData& data = pairs[i];
+			Collider& cA = data.a->colliders[data.colliderIndexA];
+			Collider& cB = data.b->colliders[data.colliderIndexB];
+			data.transformA = cA.GetWorldTransform(data.a->transform);
+			data.transformB = cB.GetWorldTransform(data.b->transform);
+
+			CircleShape* a = (CircleShape*)cA.shape;
+			CircleShape* b = (CircleShape*)cB.shape;
+			Vector2 centreA = data.transformA.TransformPoint(a->centrePoint);
+			Vector2 centreB = data.transformB.TransformPoint(b->centrePoint);
+			circleBatch.ax[i] = centreA.x;
+			circleBatch.ay[i] = centreA.y;
+			circleBatch.aRadius[i] = a->radius;
+			circleBatch.bx[i] = centreB.x;
+			circleBatch.by[i] = centreB.y;
+			circleBatch.bRadius[i] = b->radius;
+		}
+
+		circleContacts.resize(count);
+		size_t contactCount = CollideCircleCircleBatch(circleBatch, count, circleContacts.data());
+		for (size_t i = 0; i < contactCount; i++)
+		{
+			CircleContact& contact = circleContacts[i];
+			CollisionData& data = pairs[contact.pairIndex];
+			data.collisionNormal = contact.normal;
+			data.collisionPoints[0] = contact.point;
+			data.penetration = contact.penetration;
+			ResolveCollision(data, scratch);
+		}
+	}
+
+	void PhysicsSystem::ResolveCirclePlaneBucket(CollisionData* pairs, size_t count, SolverScratch& scratch)
+	{
+		if (count == 0)
+			return;
+
+		CircleBatch& circleBatch = scratch.circleBatch;
+		std::vector<CircleContact>& circleContacts = scratch.circleContacts;
+		circleBatch.Resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			CollisionData& data = pairs[i];
+			Collider& cA = data.a->colliders[data.colliderIndexA];
+			Collider& cB = data.b->colliders[data.colliderIndexB];
+			data.transformA = cA.GetWorldTransform(data.a->transform);
+			data.transformB = cB.GetWorldTransform(data.b->transform);
+
+			CircleShape* a = (CircleShape*)cA.shape;
+			PlaneShape* b = (PlaneShape*)cB.shape;
+			Vector2 centre = data.transformA.TransformPoint(a->centrePoint);
+			Vector2 planeDirection = data.transformB.TransformDirection(b->normal);
+			circleBatch.ax[i] = centre.x;
+			circleBatch.ay[i] = centre.y;
+			circleBatch.aRadius[i] = a->radius;
+			circleBatch.bx[i] = planeDirection.x;
+			circleBatch.by[i] = planeDirection.y;
+			circleBatch.bRadius[i] = glm::dot(data.transformB.TransformPoint(b->distance * b->normal), planeDirection);
+		}
+
+		circleContacts.resize(count);
+		size_t contactCount = CollideCirclePlaneBatch(circleBatch, count, circleContacts.data());
+		for (size_t i = 0; i < contactCount; i++)
+		{
+			CircleContact& contact = circleContacts[i];
+			CollisionData& data = pairs[contact.pairIndex];
+			data.collisionNormal = contact.normal;
+			data.collisionPoints[0] = contact.point;
+			data.penetration = contact.penetration;
+			ResolveCollision(data, scratch);
+		}
+	}
+
+	bool PhysicsSystem::IsResting(PhysicsObject* body)
+	{
+		//kinematic bodies are asleep when they aren't moving
+		return !body->isAwake || (body->iMass == 0 && !body->isKinematic);
+	}
+
+	void PhysicsSystem::OnBroadphasePair(PhysicsObject* a, PhysicsObject* b, void* infoPtr)
+	{
+		PhysicsSystem* system = (PhysicsSystem*)infoPtr;
+
+		//bodies whose layers don't match up never collide
+		if (!(a->collisionLayers & b->collisionMasks) || !(b->collisionLayers & a->collisionMasks))
+			return;
+		//static and kinematic bodies never collide with each other, but they can still be in triggers
+		bool fixedPair = a->iMass + b->iMass == 0;
+		if (fixedPair && !system->collectTriggers)
+			return;
+		//sleeping bodies don't collide with each other or with static ones either, their contacts are kept from when they fell asleep.
+		//they can still be in triggers though
+		bool resting = IsResting(a) && IsResting(b);
+		if (resting && !system->collectTriggers)
+			return;
+		if (system->skipSettled && system->settledBodies[a->solverIndex] && system->settledBodies[b->solverIndex])
+			return;
+
+		//keep pairs in ID order so the narrowphase doesn't depend on the broadphase layout
+		if (a->id > b->id)
+		{
+			PhysicsObject* temp = a;
+			a = b;
+			b = temp;
+		}
+
+		if (!system->jointFilter.empty() && std::binary_search(system->jointFilter.begin(), system->jointFilter.end(), std::make_pair(a->id, b->id)))
+			return;
+
+		for (unsigned char u = 0; u < a->GetColliderCount(); u++)
+		{
+			for (unsigned char v = 0; v < b->GetColliderCount(); v++)
+			{
+				Collider& c1 = a->GetCollider(u);
+				Collider& c2 = b->GetCollider(v);
+
+				//if collision layers correctly match up and aabbs are intersecting
+				if ((c1.collisionLayer & c2.collisionMask) && (c2.collisionLayer & c1.collisionMask) && system->CheckAABBCollision(c1.aABB, c2.aABB))
+				{
+					//triggers never go through the narrowphase, they are tested once per step in UpdateTriggers
+					if (c1.isTrigger || c2.isTrigger)
 					{
-						for (char v = 0; v < bodies[j]->GetColliderCount(); v++)
+						if (system->collectTriggers)
 						{
-							Collider& c1 = bodies[i]->GetCollider(u);
-							Collider& c2 = bodies[j]->GetCollider(v);
-
-							//if collision layers correctly match up and aabbs are intersecting
-							if ((c1.collisionLayer & c2.collisionMask) && (c2.collisionLayer & c1.collisionMask) && CheckAABBCollision(c1.aABB, c2.aABB))
-							{
-								collisions.emplace_back(CollisionData(bodies[i], bodies[j], u, v));
-							}
+							TriggerEvent t;
+							t.a = a;
+							t.b = b;
+							t.colliderIndexA = u;
+							t.colliderIndexB = v;
+							t.type = TRIGGER_EVENT_TYPE::STAY;
+							system->triggerPairs.push_back(t);
 						}
+						continue;
+					}
+					if (resting || fixedPair)
+						continue;
+
+					//the bounding circles are much cheaper to test than the narrowphase, and throw out pairs whose AABBs only overlap at the corners.
+					//planes have an infinite radius, so they always get through
+					Vector2 separation = a->transform.TransformPoint(c1.boundingCentre) - b->transform.TransformPoint(c2.boundingCentre);
+					Real radiusSum = c1.boundingRadius + c2.boundingRadius;
+					if (glm::dot(separation, separation) > radiusSum * radiusSum)
+						continue;
+
+					//put the pair in shape type order, so the collide functions never have to flip it
+					COLLISION_TYPE type;
+					if (c1.shapeType <= c2.shapeType)
+					{
+						type = pairTypes[(int)c1.shapeType][(int)c2.shapeType];
+						system->collisions[(int)type].emplace_back(CollisionData(a, b, u, v));
+					}
+					else
+					{
+						type = pairTypes[(int)c2.shapeType][(int)c1.shapeType];
+						system->collisions[(int)type].emplace_back(CollisionData(b, a, v, u));
 					}
+					system->collisions[(int)type].back().type = type;
 				}
 			}
 		}
+	}
+
+	struct QueryInfo
+	{
+		AABB aabb;
+		bool testPoint;
+		bool includeStatic;
+		bool includeTriggers;
+		unsigned short collisionMask;
+		QueryCallback callback;
+		void* infoPtr;
+	};
 
-		//now that all the potential collisions have been found, resolve collisions
-		for (int i = 0; i < collisions.size(); i++)
+	bool PhysicsSystem::OnKinematicQuery(PhysicsObject* body, void*)
+	{
+		if (!body->isAwake && !body->IsFixed())
+			body->Wake();
+		return true;
+	}
+
+	bool PhysicsSystem::OnBroadphaseQuery(PhysicsObject* body, void* infoPtr)
+	{
+		QueryInfo* info = (QueryInfo*)infoPtr;
+		if (!info->includeStatic && !body->isDynamic)
+			return true;
+
+		for (unsigned char i = 0; i < body->GetColliderCount(); i++)
 		{
-			ResolveCollision(collisions[i]);
+			Collider& c = body->GetCollider(i);
+			if (!(c.collisionLayer & info->collisionMask) || (c.isTrigger && !info->includeTriggers))
+				continue;
+
+			//point queries test the actual shape, aabb queries only test the collider's aabb
+			Transform world = c.GetWorldTransform(body->transform);
+			bool hit = info->testPoint ? c.shape->PointCast(info->aabb.min, world)
+				: (c.aABB.min.x < info->aabb.max.x && c.aABB.min.y < info->aabb.max.y && c.aABB.max.x > info->aabb.min.x && c.aABB.max.y > info->aabb.min.y);
+
+			if (hit && !info->callback(body, i, info->infoPtr))
+				return false;
 		}
+		return true;
+	}
+
+	bool PhysicsSystem::Query(const AABB& aabb, bool testPoint, QueryCallback callback, void* infoPtr, bool includeStatic, bool includeTriggers, unsigned short collisionMask)
+	{
+		UpdateBroadphase();
+
+		QueryInfo info = { aabb, testPoint, includeStatic, includeTriggers, collisionMask, callback, infoPtr };
+		return broadphase.Query(aabb, OnBroadphaseQuery, &info, collisionMask);
+	}
+
+	bool PhysicsSystem::QueryPoint(Vector2 point, QueryCallback callback, void* infoPtr, bool includeStatic, bool includeTriggers, unsigned short collisionMask)
+	{
+		return Query(AABB{ point, point }, true, callback, infoPtr, includeStatic, includeTriggers, collisionMask);
+	}
+
+	bool PhysicsSystem::QueryAABB(const AABB& aabb, QueryCallback callback, void* infoPtr, bool includeStatic, bool includeTriggers, unsigned short collisionMask)
+	{
+		return Query(aabb, false, callback, infoPtr, includeStatic, includeTriggers, collisionMask);
 	}
 
-	PhysicsObject* PhysicsSystem::PointCast(Vector2 point, bool includeStatic, bool includeTriggers, short collisionMask)
+	struct QueryBuffer
 	{
-		for (int i = 0; i < bodies.size(); i++)
+		PhysicsObject** results;
+		size_t count;
+		size_t maxResults;
+	};
+
+	static bool AddToQueryBuffer(PhysicsObject* body, unsigned char, void* infoPtr)
+	{
+		QueryBuffer* buffer = (QueryBuffer*)infoPtr;
+		//colliders of the same body are always visited one after another, so this is enough to only add each body once
+		if (buffer->count == 0 || buffer->results[buffer->count - 1] != body)
+			buffer->results[buffer->count++] = body;
+		return buffer->count < buffer->maxResults;
+	}
+
+	size_t PhysicsSystem::QueryPoint(Vector2 point, PhysicsObject** results, size_t maxResults, bool includeStatic, bool includeTriggers, unsigned short collisionMask)
+	{
+		QueryBuffer buffer = { results, 0, maxResults };
+		if (maxResults > 0)
+			QueryPoint(point, AddToQueryBuffer, &buffer, includeStatic, includeTriggers, collisionMask);
+		return buffer.count;
+	}
+
+	size_t PhysicsSystem::QueryAABB(const AABB& aabb, PhysicsObject** results, size_t maxResults, bool includeStatic, bool includeTriggers, unsigned short collisionMask)
+	{
+		QueryBuffer buffer = { results, 0, maxResults };
+		if (maxResults > 0)
+			QueryAABB(aabb, AddToQueryBuffer, &buffer, includeStatic, includeTriggers, collisionMask);
+		return buffer.count;
+	}
+
+	PhysicsObject* PhysicsSystem::PointCast(Vector2 point, bool includeStatic, bool includeTriggers, unsigned short collisionMask)
+	{
+		PhysicsObject* body = nullptr;
+		QueryPoint(point, &body, 1, includeStatic, includeTriggers, collisionMask);
+		return body;
+	}
+
+	void PhysicsSystem::Update()
+	{
+		stepContacts.clear();
+		triggerPairs.clear();
+		//sorts out the body lists if bodies have been added or removed, and rebuilds the static trees if one has moved
+		UpdateBroadphase();
+
+		UpdatePhysics();
+		PrepareJoints();
+		settledBodies.assign(bodies.size(), 0);
+		for (size_t i = 0; i < collisionIterations; i++)
+		{
+			SolveJoints();
+			ResolveCollisions(i == 0);
+		}
+
+		GenerateContactEvents();
+		UpdateTriggers();
+
+		//the last collision iteration moved things, so refit to the final positions for queries made between steps
+		if (!broadphaseDirty)
 		{
-			for (int j = 0; j < bodies[i]->GetColliderCount(); j++)
+			for (auto* body : movingBodies)
 			{
-				Collider& c = bodies[i]->GetCollider(j);
-				if ((c.GetCollisionLayer() & collisionMask) && (includeTriggers || !c.isTrigger) && (includeStatic || bodies[i]->isDynamic) && c.GetShape()->PointCast(point, bodies[i]->transform))
-				{
-					return bodies[i];
-				}
-				
+				if (!settledBodies[body->solverIndex])
+					body->GenerateAABB();
 			}
+			broadphase.Refit();
 		}
-		return nullptr;
+
+		//after the refit, so bodies going to sleep keep an AABB for where they ended up
+		UpdateSleep();
 	}
 
-	std::vector<PhysicsObject*>&& PhysicsSystem::PointCastMultiple(Vector2 point, bool includeStatic, bool includeTriggers, short collisionMask)
+	void PhysicsSystem::UpdateBroadphase()
 	{
-		std::vector<PhysicsObject*> pC;
+		if (bodyListsDirty)
+		{
+			//a body has changed type, or the bodies have been replaced, so put every body back in the right list
+			movingBodies.clear();
+			kinematicBodies.clear();
+			staticBodies.clear();
+			for (size_t i = 0; i < bodies.size(); i++)
+			{
+				bodies[i]->solverIndex = (unsigned int)i;
+				GetBodyList(bodies[i]).push_back(bodies[i]);
+			}
+			bodyListsDirty = false;
+			broadphaseDirty = true;
+			staticDirty = true;
+		}
 
-		for (int i = 0; i < bodies.size(); i++)
+		if (broadphaseDirty)
 		{
-			for (int j = 0; j < bodies[i]->GetColliderCount(); j++)
+			//moving or kinematic bodies have been added or removed. the static trees are left alone, so adding bodies to a big static world stays cheap
+			for (auto* body : movingBodies)
+				body->GenerateAABB();
+			for (auto* body : kinematicBodies)
+				body->GenerateAABB();
+			broadphase.Build(movingBodies);
+			broadphase.BuildKinematic(kinematicBodies);
+			broadphaseDirty = false;
+		}
+
+		if (staticDirty)
+		{
+			//static bodies are never integrated, so this is the only place their sin and cos are updated
+			for (auto* body : staticBodies)
 			{
-				Collider& c = bodies[i]->GetCollider(j);
-				if ((c.GetCollisionLayer() & collisionMask) && (includeTriggers || !c.isTrigger) && (includeStatic || bodies[i]->isDynamic) && c.GetShape()->PointCast(point, bodies[i]->transform))
+				body->transform.UpdateData();
+				body->GenerateAABB();
+			}
+			broadphase.BuildStatic(staticBodies);
+			staticDirty = false;
+		}
+
+		//anything asleep on a static body that has been moved would otherwise be left floating where it was.
+		//this is done once for every body moved since last step, so setting lots of them doesn't go through the contacts for each one
+		if (!movedStaticBodies.empty())
+		{
+			for (auto& e : lastContacts)
+			{
+				if (e.a->staticMoved)
+					e.b->Wake();
+				else if (e.b->staticMoved)
+					e.a->Wake();
+			}
+			for (auto* joint : joints)
+			{
+				if (joint->a->staticMoved || (joint->b && joint->b->staticMoved))
 				{
-					pC.push_back(bodies[i]);
+					joint->a->Wake();
+					if (joint->b)
+						joint->b->Wake();
 				}
 			}
+			for (auto* body : movedStaticBodies)
+				body->staticMoved = false;
+			movedStaticBodies.clear();
 		}
+	}
 
-		return std::move(pC);
+	std::vector<PhysicsObject*>& PhysicsSystem::GetBodyList(PhysicsObject* body)
+	{
+		if (body->isDynamic)
+			return movingBodies;
+		return body->isKinematic ? kinematicBodies : staticBodies;
 	}
 
-	void PhysicsSystem::Update()
+	void PhysicsSystem::AddBody(PhysicsObject* body)
 	{
-		UpdatePhysics();
-		for (size_t i = 0; i < collisionIterations; i++)
+		//new bodies go on the end of bodies and their list, so the lists stay in the same order as bodies
+		body->solverIndex = (unsigned int)bodies.size();
+		bodies.push_back(body);
+		GetBodyList(body).push_back(body);
+		if (body->isDynamic || body->isKinematic)
+			broadphaseDirty = true;
+		else
+			staticDirty = true;
+	}
+
+	void PhysicsSystem::OnCollidersChanged(PhysicsObject* body, bool wasDynamic)
+	{
+		//adding a plane makes a dynamic body static
+		if (wasDynamic != body->isDynamic)
+			bodyListsDirty = true;
+		else if (body->isDynamic || body->isKinematic)
+			broadphaseDirty = true;
+		else
+			staticDirty = true;
+	}
+
+	struct RayCastInfo
+	{
+		Vector2 origin;
+		Vector2 direction;
+		Real maxDistance;
+		Real closest;
+		unsigned short collisionMask;
+		bool includeTriggers;
+		RayCastHit* hit;
+	};
+
+	Real PhysicsSystem::OnBroadphaseRay(PhysicsObject* body, void* infoPtr)
+	{
+		RayCastInfo* info = (RayCastInfo*)infoPtr;
+
+		for (unsigned char i = 0; i < body->GetColliderCount(); i++)
 		{
-			ResolveCollisions();
+			Collider& c = body->GetCollider(i);
+			if (!(c.collisionLayer & info->collisionMask) || (c.isTrigger && !info->includeTriggers))
+				continue;
+
+			Real distance;
+			Vector2 normal;
+			Transform world = c.GetWorldTransform(body->transform);
+			if (c.shape->RayCast(info->origin, info->direction, info->closest, world, distance, normal))
+			{
+				info->closest = distance;
+				info->hit->body = body;
+				info->hit->colliderIndex = i;
+				info->hit->point = info->origin + distance * info->direction;
+				info->hit->normal = normal;
+				info->hit->fraction = distance / info->maxDistance;
+			}
 		}
+		return info->closest;
+	}
+
+	bool PhysicsSystem::RayCast(Vector2 origin, Vector2 direction, Real maxDistance, RayCastHit& hit, unsigned short collisionMask, bool includeTriggers)
+	{
+		hit.body = nullptr;
+
+		Real length = glm::length(direction);
+		if (length == 0 || maxDistance <= 0)
+			return false;
+
+		UpdateBroadphase();
+
+		RayCastInfo info = { origin, direction / length, maxDistance, maxDistance, collisionMask, includeTriggers, &hit };
+		broadphase.RayCast(info.origin, info.direction, maxDistance, OnBroadphaseRay, &info, collisionMask);
+		return hit.body != nullptr;
+	}
+
+	size_t PhysicsSystem::RayCastMany(const Ray* rays, RayCastHit* hits, size_t count, bool includeTriggers)
+	{
+		UpdateBroadphase();
+
+		size_t hitCount = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const Ray& ray = rays[i];
+			hits[i].body = nullptr;
+
+			Real length = glm::length(ray.direction);
+			if (length == 0 || ray.maxDistance <= 0)
+				continue;
+
+			//every ray walks the same trees, and each one is clipped by its own closest hit as it goes
+			RayCastInfo info = { ray.origin, ray.direction / length, ray.maxDistance, ray.maxDistance, ray.collisionMask, includeTriggers, &hits[i] };
+			broadphase.RayCast(info.origin, info.direction, ray.maxDistance, OnBroadphaseRay, &info, ray.collisionMask);
+			if (hits[i].body)
+				hitCount++;
+		}
+		return hitCount;
+	}
+
+	struct ShapeCastInfo
+	{
+		Shape* shape;
+		Transform* transform;
+		Vector2 translation;
+		//the AABB of the shape over the whole cast
+		AABB sweep;
+		unsigned short collisionMask;
+		bool includeTriggers;
+		ShapeCastHit* hit;
+	};
+
+	bool PhysicsSystem::OnBroadphaseShapeCast(PhysicsObject* body, void* infoPtr)
+	{
+		ShapeCastInfo* info = (ShapeCastInfo*)infoPtr;
+
+		for (unsigned char i = 0; i < body->GetColliderCount(); i++)
+		{
+			Collider& c = body->GetCollider(i);
+			if (!(c.collisionLayer & info->collisionMask) || (c.isTrigger && !info->includeTriggers))
+				continue;
+			if (c.aABB.min.x > info->sweep.max.x || c.aABB.min.y > info->sweep.max.y || c.aABB.max.x < info->sweep.min.x || c.aABB.max.y < info->sweep.min.y)
+				continue;
+
+			//only look for hits closer than the closest one so far
+			Real fraction = info->hit->body ? info->hit->fraction : 1;
+			Vector2 point, normal;
+			Transform world = c.GetWorldTransform(body->transform);
+			if (TimeOfImpact(info->shape, *info->transform, info->translation, c.shape, world, fraction, point, normal))
+			{
+				info->hit->body = body;
+				info->hit->colliderIndex = i;
+				info->hit->point = point;
+				info->hit->normal = normal;
+				info->hit->fraction = fraction;
+			}
+		}
+		return true;
+	}
+
+	bool PhysicsSystem::ShapeCast(Shape* shape, Transform& transform, Vector2 translation, ShapeCastHit& hit, unsigned short collisionMask, bool includeTriggers)
+	{
+		hit.body = nullptr;
+
+		if (shape->GetType() == SHAPE_TYPE::PLANE || translation == Vector2(0, 0))
+			return false;
+
+		UpdateBroadphase();
+
+		Transform end = transform;
+		end.position += translation;
+		AABB start = shape->CalculateAABB(transform);
+		AABB finish = shape->CalculateAABB(end);
+		AABB sweep = { glm::max(start.max, finish.max), glm::min(start.min, finish.min) };
+
+		ShapeCastInfo info = { shape, &transform, translation, sweep, collisionMask, includeTriggers, &hit };
+		broadphase.Query(sweep, OnBroadphaseShapeCast, &info, collisionMask);
+		return hit.body != nullptr;
+	}
+
+	template<typename Event>
+	static bool EventKeyEqual(const Event& l, const Event& r)
+	{
+		return l.a == r.a && l.b == r.b && l.colliderIndexA == r.colliderIndexA && l.colliderIndexB == r.colliderIndexB;
+	}
+
+	//current and last are both sorted, so begin/end can be found with a single merge
+	template<typename Event, typename EventType>
+	static void MergeEvents(std::vector<Event>& current, std::vector<Event>& last, std::vector<Event>& events, EventType begin, EventType persist, EventType end)
+	{
+		events.clear();
+		size_t i = 0, j = 0;
+		while (i < current.size() || j < last.size())
+		{
+			if (j == last.size() || (i < current.size() && EventKeyLess(current[i], last[j])))
+			{
+				current[i].type = begin;
+				events.push_back(current[i++]);
+			}
+			else if (i == current.size() || EventKeyLess(last[j], current[i]))
+			{
+				last[j].type = end;
+				events.push_back(last[j++]);
+			}
+			else
+			{
+				current[i].type = persist;
+				events.push_back(current[i++]);
+				j++;
+			}
+		}
+	}
+
+	void PhysicsSystem::RecordContact(CollisionData& data, std::vector<ContactEvent>& contacts)
+	{
+		ContactEvent e;
+		e.type = CONTACT_EVENT_TYPE::PERSIST;
+		e.point = data.pointCount == 2 ? (Real)0.5 * (data.collisionPoints[0] + data.collisionPoints[1]) : data.collisionPoints[0];
+		e.penetration = data.penetration;
+
+		//the collide functions can flip a and b, so order by ID to get the same key no matter what
+		if (data.a->id < data.b->id)
+		{
+			e.a = data.a; e.b = data.b;
+			e.colliderIndexA = data.colliderIndexA; e.colliderIndexB = data.colliderIndexB;
+			e.normal = data.collisionNormal;
+		}
+		else
+		{
+			e.a = data.b; e.b = data.a;
+			e.colliderIndexA = data.colliderIndexB; e.colliderIndexB = data.colliderIndexA;
+			e.normal = -data.collisionNormal;
+		}
+		contacts.push_back(e);
+	}
+
+	void PhysicsSystem::GenerateContactEvents()
+	{
+		//sleeping bodies aren't collided, so their contacts carry on from last step. if one was also found this step, the new one comes first and is kept
+		for (auto& e : lastContacts)
+		{
+			if (IsResting(e.a) && IsResting(e.b))
+				stepContacts.push_back(e);
+		}
+
+		//stable sort + unique keeps the first time each pair was found this step
+		std::stable_sort(stepContacts.begin(), stepContacts.end(), EventKeyLess<ContactEvent>);
+		stepContacts.erase(std::unique(stepContacts.begin(), stepContacts.end(), EventKeyEqual<ContactEvent>), stepContacts.end());
+
+		MergeEvents(stepContacts, lastContacts, contactEvents, CONTACT_EVENT_TYPE::BEGIN, CONTACT_EVENT_TYPE::PERSIST, CONTACT_EVENT_TYPE::END);
+		lastContacts.swap(stepContacts);
+	}
+
+	void PhysicsSystem::UpdateTriggers()
+	{
+		//test each pair once, with the final transforms of this step
+		size_t overlapCount = 0;
+		for (size_t i = 0; i < triggerPairs.size(); i++)
+		{
+			TriggerEvent& t = triggerPairs[i];
+			Collider& cA = t.a->GetCollider(t.colliderIndexA);
+			Collider& cB = t.b->GetCollider(t.colliderIndexB);
+			Transform tA = cA.GetWorldTransform(t.a->transform), tB = cB.GetWorldTransform(t.b->transform);
+			if (TestOverlap(cA.GetShape(), cB.GetShape(), tA, tB))
+			{
+				triggerPairs[overlapCount++] = t;
+			}
+		}
+		triggerPairs.resize(overlapCount);
+
+		std::sort(triggerPairs.begin(), triggerPairs.end(), EventKeyLess<TriggerEvent>);
+		MergeEvents(triggerPairs, triggerOverlaps, triggerEvents, TRIGGER_EVENT_TYPE::ENTER, TRIGGER_EVENT_TYPE::STAY, TRIGGER_EVENT_TYPE::EXIT);
+		triggerOverlaps.swap(triggerPairs);
 	}
 
 	void PhysicsSystem::UpdatePhysics()
 	{
-		//do physics
-		for (auto* body : bodies)
+		//kinematic bodies go first, so anything they wake up is moved this step too.
+		//their trees are only refit if one of them has moved (or been moved with a setter, which wakes it)
+		bool kinematicMoved = false;
+		for (auto* body : kinematicBodies)
 		{
+			bool moving = body->velocity != Vector2(0, 0) || body->angularVelocity != 0;
+			if (moving)
+				body->Update(deltaTime);
+			if (moving || body->isAwake)
+			{
+				body->GenerateAABB();
+				body->isAwake = true;
+				kinematicMoved = true;
+
+				//a body can fall asleep just off the surface it rests on, so this wakes anything near it rather than only what it touches
+				AABB aabb = body->colliderAABB;
+				aabb.min -= Vector2((Real)FZX_SLEEP_LINEAR_TOLERANCE);
+				aabb.max += Vector2((Real)FZX_SLEEP_LINEAR_TOLERANCE);
+				broadphase.Query(aabb, OnKinematicQuery, nullptr);
+			}
+		}
+		if (kinematicMoved)
+		{
+			broadphase.RefitKinematic();
+			for (auto* joint : joints)
+			{
+				if ((joint->a->isKinematic && joint->a->isAwake) || (joint->b && joint->b->isKinematic && joint->b->isAwake))
+				{
+					joint->a->Wake();
+					if (joint->b)
+						joint->b->Wake();
+				}
+			}
+		}
+
+		//do physics. static bodies don't move on their own, only when they are set
+		for (auto* body : movingBodies)
+		{
+			if (!body->isAwake)
+				continue;
+
 			body->Update(deltaTime);
 
+			//not AddVelocity, since that would wake the body up and stop it ever falling asleep
 			if (body->GetInverseMass() != 0)
 			{
-				body->AddVelocity(gravity * deltaTime);
+				body->velocity += gravity * deltaTime;
+			}
+		}
+	}
+
+	void PhysicsSystem::UpdateSleep()
+	{
+		size_t bodyCount = bodies.size();
+		islandParents.resize(bodyCount);
+		for (size_t i = 0; i < bodyCount; i++)
+			islandParents[i] = (unsigned int)i;
+
+		//these islands are built from everything touching at the end of the step (including sleeping contacts), not just this iteration's pairs
+		for (auto& e : lastContacts)
+			UnionIslands(e.a, e.b);
+		for (auto* joint : joints)
+			UnionIslands(joint->a, joint->b);
+
+		//kinematic bodies aren't in islands, they wake what's around them in UpdatePhysics. they stay awake into next step only if they're still going to move
+		for (auto* body : kinematicBodies)
+			body->isAwake = body->velocity != Vector2(0, 0) || body->angularVelocity != 0;
+
+		Real linearTolerance = (Real)FZX_SLEEP_LINEAR_TOLERANCE * (Real)FZX_SLEEP_LINEAR_TOLERANCE;
+		islandSleepTimes.assign(bodyCount, std::numeric_limits<Real>::max());
+		for (auto* body : movingBodies)
+		{
+			if (body->IsFixed())
+				continue;
+
+			if (body->isAwake)
+			{
+				Vector2 moved = body->transform.position - body->sleepPosition;
+				if (glm::dot(moved, moved) > linearTolerance || std::abs(body->transform.rotation - body->sleepRotation) > (Real)FZX_SLEEP_ANGULAR_TOLERANCE)
+					body->sleepTime = 0;
+				//it has just started resting (or was just woken up), so it rests from here
+				if (body->sleepTime == 0)
+				{
+					body->sleepPosition = body->transform.position;
+					body->sleepRotation = body->transform.rotation;
+				}
+				body->sleepTime += deltaTime;
+			}
+			Real& islandTime = islandSleepTimes[FindIsland(body->solverIndex)];
+			islandTime = std::min(islandTime, body->sleepTime);
+		}
+
+		//an island sleeps once all of it has rested for long enough. a sleeping body in an island that is moving has been touched, so it wakes up
+		for (auto* body : movingBodies)
+		{
+			if (body->IsFixed())
+				continue;
+
+			if (islandSleepTimes[FindIsland(body->solverIndex)] >= (Real)FZX_TIME_TO_SLEEP)
+			{
+				//even if it was already asleep, it might have been pushed by a body that fell asleep with it
+				Real sleepTime = body->sleepTime;
+				body->SetAwake(false);
+				body->sleepTime = sleepTime;
 			}
+			else if (!body->isAwake)
+				body->Wake();
 		}
 	}
 
+	void PhysicsSystem::PrepareJoints()
+	{
+		//joints between sleeping (or fixed) bodies are left alone, warm starting them would give the sleeping bodies velocity
+		activeJoints.clear();
+		for (auto* joint : joints)
+		{
+			bool awakeA = joint->a->isAwake && !joint->a->IsFixed();
+			bool awakeB = joint->b && joint->b->isAwake && !joint->b->IsFixed();
+			if (awakeA || awakeB)
+				activeJoints.push_back(joint);
+		}
+
+		for (auto* joint : activeJoints)
+			joint->Prepare(deltaTime);
+	}
+
+	void PhysicsSystem::SolveJoints()
+	{
+		for (auto* joint : activeJoints)
+			joint->Solve();
+	}
+
 	PhysicsObject* PhysicsSystem::CreatePhysicsObject(PhysicsData& data)
 	{
-		PhysicsObject* body = new PhysicsObject(data);
-		bodies.push_back(body);
-		return bodies[bodies.size() - 1];
+		PhysicsObject* body = new (bodyPool.Allocate()) PhysicsObject(data);
+		body->id = nextBodyID++;
+		body->system = this;
+		AddBody(body);
+		return body;
+	}
+
+	void PhysicsSystem::CreateBodies(const BodyDesc* descs, size_t count, PhysicsObject** results)
+	{
+		bodies.reserve(bodies.size() + count);
+		bodyPool.Reserve(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			PhysicsData data = descs[i].data;
+			PhysicsObject* body = new (bodyPool.Allocate()) PhysicsObject(data);
+			body->id = nextBodyID++;
+			body->system = this;
+			body->pointer = descs[i].infoPointer;
+
+			//mass and centring are done once per body instead of once per collider
+			body->AddColliders(descs[i].colliders, descs[i].colliderCount);
+
+			AddBody(body);
+			if (results)
+				results[i] = body;
+		}
+
+		UpdateBroadphase();
 	}
 
 	void PhysicsSystem::DeletePhysicsBody(PhysicsObject* body)
 	{
 		if (!body) return;
 
-		bodies.erase(std::remove(bodies.begin(), bodies.end(), body));
-		delete body;
+		auto it = std::find(bodies.begin(), bodies.end(), body);
+		size_t index = it - bodies.begin();
+		bodies.erase(it);
+		for (size_t i = index; i < bodies.size(); i++)
+			bodies[i]->solverIndex = (unsigned int)i;
+		//only the tree the body was in still points at it, and that one is rebuilt before it's used again
+		std::vector<PhysicsObject*>& list = GetBodyList(body);
+		list.erase(std::remove(list.begin(), list.end(), body), list.end());
+		if (body->isDynamic || body->isKinematic)
+			broadphaseDirty = true;
+		else
+			staticDirty = true;
+
+		//wake anything resting on (or hanging off) the body, then forget contacts with it so no END event is made with a dangling pointer
+		WakeTouching(body);
+		if (body->staticMoved)
+			movedStaticBodies.erase(std::remove(movedStaticBodies.begin(), movedStaticBodies.end(), body), movedStaticBodies.end());
+		auto removeBody = [body](const ContactEvent& e) { return e.a == body || e.b == body; };
+		lastContacts.erase(std::remove_if(lastContacts.begin(), lastContacts.end(), removeBody), lastContacts.end());
+		contactEvents.erase(std::remove_if(contactEvents.begin(), contactEvents.end(), removeBody), contactEvents.end());
+		auto removeBodyTrigger = [body](const TriggerEvent& e) { return e.a == body || e.b == body; };
+		triggerOverlaps.erase(std::remove_if(triggerOverlaps.begin(), triggerOverlaps.end(), removeBodyTrigger), triggerOverlaps.end());
+		triggerEvents.erase(std::remove_if(triggerEvents.begin(), triggerEvents.end(), removeBodyTrigger), triggerEvents.end());
+
+		for (size_t i = joints.size(); i-- > 0;)
+		{
+			if (joints[i]->a == body || joints[i]->b == body)
+				DeleteJoint(joints[i]);
+		}
+
+		DestroyBody(body);
+	}
+
+	void PhysicsSystem::WakeTouching(PhysicsObject* body)
+	{
+		for (auto& e : lastContacts)
+		{
+			if (e.a == body)
+				e.b->Wake();
+			else if (e.b == body)
+				e.a->Wake();
+		}
+		for (auto* joint : joints)
+		{
+			if (joint->a == body || joint->b == body)
+			{
+				joint->a->Wake();
+				if (joint->b)
+					joint->b->Wake();
+			}
+		}
+	}
+
+	Joint* PhysicsSystem::CreateJoint(const JointDesc& desc)
+	{
+		if (!desc.a || desc.a == desc.b)
+			return nullptr;
+
+		Joint* joint = new (jointPool.Allocate()) Joint(desc);
+		joint->id = nextJointID++;
+		joints.push_back(joint);
+		AddJointFilter(joint);
+		return joint;
+	}
+
+	void PhysicsSystem::AddJointFilter(Joint* joint)
+	{
+		if (joint->collideConnected || !joint->b)
+			return;
+
+		auto pair = std::make_pair(std::min(joint->a->id, joint->b->id), std::max(joint->a->id, joint->b->id));
+		jointFilter.insert(std::lower_bound(jointFilter.begin(), jointFilter.end(), pair), pair);
+	}
+
+	void PhysicsSystem::DeleteJoint(Joint* joint)
+	{
+		if (!joint) return;
+
+		joints.erase(std::remove(joints.begin(), joints.end(), joint));
+		if (!joint->collideConnected && joint->b)
+		{
+			auto pair = std::make_pair(std::min(joint->a->id, joint->b->id), std::max(joint->a->id, joint->b->id));
+			auto it = std::lower_bound(jointFilter.begin(), jointFilter.end(), pair);
+			if (it != jointFilter.end() && *it == pair)
+				jointFilter.erase(it);
+		}
+		DestroyJoint(joint);
+	}
+
+	void PhysicsSystem::DestroyJoint(Joint* joint)
+	{
+		joint->~Joint();
+		jointPool.Free(joint);
+	}
+
+	void PhysicsSystem::DestroyBody(PhysicsObject* body)
+	{
+		body->~PhysicsObject();
+		bodyPool.Free(body);
+	}
+
+	unsigned long long PhysicsSystem::HashState()
+	{
+		//FNV-1a over the raw bytes, so any difference at all changes the hash
+		unsigned long long hash = 14695981039346656037ull;
+		auto add = [&hash](const void* data, size_t size)
+		{
+			const unsigned char* bytes = (const unsigned char*)data;
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+
+		for (size_t i = 0; i < bodies.size(); i++)
+		{
+			PhysicsObject* body = bodies[i];
+			add(&body->id, sizeof(body->id));
+			add(&body->transform.position, sizeof(body->transform.position));
+			add(&body->transform.rotation, sizeof(body->transform.rotation));
+			add(&body->velocity, sizeof(body->velocity));
+			add(&body->angularVelocity, sizeof(body->angularVelocity));
+			//sleep state, so a body that falls asleep a step earlier shows up straight away instead of when something wakes it
+			add(&body->isAwake, sizeof(body->isAwake));
+			add(&body->sleepTime, sizeof(body->sleepTime));
+		}
+		//warm starting impulses carry over between steps, so they can go different before any body does
+		for (auto* joint : joints)
+		{
+			add(&joint->id, sizeof(joint->id));
+			add(&joint->impulse, sizeof(joint->impulse));
+			add(&joint->angularImpulse, sizeof(joint->angularImpulse));
+		}
+		return hash;
+	}
+
+	PhysicsPoolStats PhysicsSystem::GetPoolStats()
+	{
+		return PhysicsPoolStats{ bodyPool.GetStats(), jointPool.GetStats(), CircleShape::GetPoolStats(), PolygonShape::GetPoolStats(), CapsuleShape::GetPoolStats(), PlaneShape::GetPoolStats() };
 	}
 
 	void PhysicsSystem::ClearPhysicsBodies()
 	{
+		for (auto* joint : joints)
+			DestroyJoint(joint);
+		joints.clear();
+		jointFilter.clear();
+
 		for (size_t i = 0; i < bodies.size(); i++)
 		{
-			delete bodies[i];
+			DestroyBody(bodies[i]);
 		}
 		bodies.clear();
+		movingBodies.clear();
+		kinematicBodies.clear();
+		staticBodies.clear();
+		movedStaticBodies.clear();
+		broadphase.Clear();
+		broadphaseDirty = true;
+		staticDirty = true;
+		lastContacts.clear();
+		contactEvents.clear();
+		triggerOverlaps.clear();
+		triggerEvents.clear();
 	}
 
-	static Vector2 GetVelocityAtPoint(Vector2 centre, Vector2 point, float angularVelocity, Vector2 velocity)
+	static Vector2 GetVelocityAtPoint(Vector2 centre, Vector2 point, Real angularVelocity, Vector2 velocity)
 	{
 		//radius vector works as both a distance from centre multiplier and an object normal
 		Vector2 radiusVector = point - centre;
 		Vector2 angularVelocityVector = angularVelocity * Vector2{ -radiusVector.y, radiusVector.x };
 		//this^ is the perpendicular vector multiplied by  angular velocity, but it is also the 2D equivelant of Cross(angularVelocity, radiusVector)
-		//this is different from the current em::Cross function because is simplified from when cross takes two vector3 values like this: Vector3(X,X,0), Vector3(X,X,0). returns a float because only the z component of the return value is nonzero
+		//this is different from the current em::Cross function because is simplified from when cross takes two vector3 values like this: Vector3(X,X,0), Vector3(X,X,0). returns a Real because only the z component of the return value is nonzero
 		//This 'cross' simplifies from when cross takes two vector3 values like this: vector3(0,0,X), Vector3(X,X,0). it returns a vector2 because in that case, the x and y values of the return value are nonzero
 		return angularVelocityVector + velocity;
 	}
 
 
-	void PhysicsSystem::ResolveCollision(CollisionData& data)
+	void PhysicsSystem::ApplyContactImpulse(PhysicsObject* body, Vector2 impulse, Vector2 point)
+	{
+		//fixed bodies can be in more than one island at once, so they must never be written to while solving.
+		//the velocities are set directly so sleeping bodies aren't woken here, UpdateSleep does that for the whole island
+		if (body->IsFixed())
+			return;
+		body->velocity += impulse * body->iMass;
+#ifdef FZX_COLLISIONROTATION
+		body->angularVelocity += em::Cross(point - body->transform.position, impulse) * body->iInertia;
+#endif
+	}
+
+	void PhysicsSystem::ResolveCollision(CollisionData& data, SolverScratch& scratch)
 	{
-		//if collision happened (data is added into manifold about collision)
-		if ((data.a->iMass + data.b->iMass != 0) &&
-			EvaluateCollision(data))
+		if (cCallback && !cCallback(data, cCallbackPtr))
 		{
-			if ((cCallback && !cCallback(data, cCallbackPtr)) || data.a->GetCollider(data.colliderIndexA).GetIsTrigger() || data.b->GetCollider(data.colliderIndexB).GetIsTrigger())
-			{
-				//if the callback returns false, or one of the colliders is a trigger, the collision isn't evaluated
-				return;
-			}
+			//if the callback returns false, the collision isn't evaluated
+			return;
+		}
+		RecordContact(data, scratch.contacts);
 
-			Vector2 collisionPoint;
-			if (data.pointCount == 2)
-				collisionPoint = 0.5f * (data.collisionPoints[0] + data.collisionPoints[1]);
-			else
-				collisionPoint = data.collisionPoints[0];
+		Vector2 collisionPoint;
+		if (data.pointCount == 2)
+			collisionPoint = (Real)0.5 * (data.collisionPoints[0] + data.collisionPoints[1]);
+		else
+			collisionPoint = data.collisionPoints[0];
 
 #ifdef FZX_COLLISIONROTATION
-			Vector2 radiusA = collisionPoint - data.a->transform.position,
-				radiusB = collisionPoint - data.b->transform.position;
-			//explanation for this \/ in GetVelocityAtPoint
-			Vector2 angularVelocityA = data.a->GetAngularVelocity() * Vector2 { -radiusA.y, radiusA.x };
-			Vector2 angularVelocityB = data.b->GetAngularVelocity() * Vector2 { -radiusB.y, radiusB.x };
-			Vector2 rV = (data.b->GetVelocity() + angularVelocityB)
-				- (data.a->GetVelocity() + angularVelocityA);
+		Vector2 radiusA = collisionPoint - data.a->transform.position,
+			radiusB = collisionPoint - data.b->transform.position;
+		//explanation for this \/ in GetVelocityAtPoint
+		Vector2 angularVelocityA = data.a->GetAngularVelocity() * Vector2 { -radiusA.y, radiusA.x };
+		Vector2 angularVelocityB = data.b->GetAngularVelocity() * Vector2 { -radiusB.y, radiusB.x };
+		Vector2 rV = (data.b->GetVelocity() + angularVelocityB)
+			- (data.a->GetVelocity() + angularVelocityA);
 
-			float projectedRV = glm::dot(data.collisionNormal, rV);
+		Real projectedRV = glm::dot(data.collisionNormal, rV);
 
-			if (projectedRV > 0) // this check stops objects from 'sticking' together
-			{
-				//bounciness is average of the two
-				float e = 0.5f * (data.a->bounciness + data.b->bounciness);
+		if (projectedRV > 0) // this check stops objects from 'sticking' together
+		{
+			//bounciness is average of the two
+			Real e = 0.5f * (data.a->bounciness + data.b->bounciness);
 
-				float rACrossN = em::Cross(radiusA, data.collisionNormal);
-				float rBCrossN = em::Cross(radiusB, data.collisionNormal);
+			Real rACrossN = em::Cross(radiusA, data.collisionNormal);
+			Real rBCrossN = em::Cross(radiusB, data.collisionNormal);
 
-				float massDistribution = 1.0f / (data.a->iMass + data.b->iMass
-					+ (rACrossN * rACrossN * data.a->iInertia) + (rBCrossN * rBCrossN * data.b->iInertia));
-				float impulseMagnitude = (-(1 + e) * projectedRV) * massDistribution;
+			Real massDistribution = 1.0f / (data.a->iMass + data.b->iMass
+				+ (rACrossN * rACrossN * data.a->iInertia) + (rBCrossN * rBCrossN * data.b->iInertia));
+			Real impulseMagnitude = (-(1 + e) * projectedRV) * massDistribution;
 
-				//turn into vector
-				Vector2 impulse = data.collisionNormal * impulseMagnitude;
+			//turn into vector
+			Vector2 impulse = data.collisionNormal * impulseMagnitude;
 
-				//calculate impulse to add
-				data.a->AddImpulseAtPosition(-impulse, collisionPoint);
-				data.b->AddImpulseAtPosition(impulse, collisionPoint);
+			//calculate impulse to add
+			ApplyContactImpulse(data.a, -impulse, collisionPoint);
+			ApplyContactImpulse(data.b, impulse, collisionPoint);
 
 #ifdef FZX_FRICTION
-				//FRICTION
-				//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-
-				//this is how box2D calculates friction coefficients (so that low coefficients seriously lower overall friction)
-				float staticFriction = sqrtf(data.a->staticFriction * data.b->staticFriction);
-				float dynamicFriction = sqrtf(data.a->dynamicFriction * data.b->dynamicFriction);
-
-
-				Vector2 tangent;
-				//calculate the tangent here. if there is no relative velocity than there is zero friction too (or at least zero friction that can be modelled using the coloumb model)
-				Vector2 t = rV - projectedRV * data.collisionNormal;
-				if (t == Vector2(0, 0))
-					tangent = Vector2(0, 0);
-				else
-					tangent = glm::normalize(t);
-				float tangentRV = glm::dot(tangent, rV);
-
-				float rACrossT = em::Cross(radiusA, tangent);
-				float rBCrossT = em::Cross(radiusB, tangent);
-				massDistribution = 1.0f / (data.a->iMass + data.b->iMass
-					+ (rACrossT * rACrossT * data.a->iInertia) + (rBCrossT * rBCrossT * data.b->iInertia));
-
-				//the magnitude of friction in a static friction situation
-				float frictionMagnitude = dynamicFriction * -tangentRV * massDistribution;
-				//if overcomes static friction, set to dynamic friction
-				// impulseMag is always negative, so the comparer is flipped into less than from more than 
-				if (frictionMagnitude <= staticFriction * impulseMagnitude)
-					frictionMagnitude = dynamicFriction * impulseMagnitude;
-
-				data.a->AddImpulseAtPosition(-frictionMagnitude * tangent, collisionPoint);
-				data.b->AddImpulseAtPosition(frictionMagnitude * tangent, collisionPoint);
-				//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-#endif
-#else
-			//resolve collision
-			Vector2 rV = data.b->GetVelocity() - data.a->GetVelocity();
+			//FRICTION
+			//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-			float projectedRV = glm::dot(data.collisionNormal, rV);
+			//this is how box2D calculates friction coefficients (so that low coefficients seriously lower overall friction)
+			Real staticFriction = em::Sqrt(data.a->staticFriction * data.b->staticFriction);
+			Real dynamicFriction = em::Sqrt(data.a->dynamicFriction * data.b->dynamicFriction);
 
-			if (projectedRV > 0)
-			{
-				//bounciness is average of the two
-				float e = 0.5f * (data.a->bounciness + data.b->bounciness);
 
-				//calculate impulse magnitude
-				float impulseMagnitude = -(1 + e) * projectedRV;
-				impulseMagnitude /= (data.a->GetInverseMass() + data.b->GetInverseMass());
+			Vector2 tangent;
+			//calculate the tangent here. if there is no relative velocity than there is zero friction too (or at least zero friction that can be modelled using the coloumb model)
+			Vector2 t = rV - projectedRV * data.collisionNormal;
+			if (t == Vector2(0, 0))
+				tangent = Vector2(0, 0);
+			else
+				tangent = glm::normalize(t);
+			Real tangentRV = glm::dot(tangent, rV);
+
+			Real rACrossT = em::Cross(radiusA, tangent);
+			Real rBCrossT = em::Cross(radiusB, tangent);
+			massDistribution = 1.0f / (data.a->iMass + data.b->iMass
+				+ (rACrossT * rACrossT * data.a->iInertia) + (rBCrossT * rBCrossT * data.b->iInertia));
 
-				//turn into vector
-				Vector2 impulse = data.collisionNormal * impulseMagnitude;
+			//the magnitude of friction in a static friction situation
+			Real frictionMagnitude = dynamicFriction * -tangentRV * massDistribution;
+			//if overcomes static friction, set to dynamic friction
+			// impulseMag is always negative, so the comparer is flipped into less than from more than 
+			if (frictionMagnitude <= staticFriction * impulseMagnitude)
+				frictionMagnitude = dynamicFriction * impulseMagnitude;
 
-				data.a->AddImpulse(-impulse);
-				data.b->AddImpulse(impulse);
+			ApplyContactImpulse(data.a, -frictionMagnitude * tangent, collisionPoint);
+			ApplyContactImpulse(data.b, frictionMagnitude * tangent, collisionPoint);
+			//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 #endif
-			}
+#else
+		//resolve collision
+		Vector2 rV = data.b->GetVelocity() - data.a->GetVelocity();
+
+		Real projectedRV = glm::dot(data.collisionNormal, rV);
+
+		if (projectedRV > 0)
+		{
+			//bounciness is average of the two
+			Real e = 0.5f * (data.a->bounciness + data.b->bounciness);
 
-			//teleport shapes out of each other based on mass
-			Vector2 offsetA = data.collisionNormal * (data.penetration * data.a->GetInverseMass() / (data.a->GetInverseMass() + data.b->GetInverseMass()));
-			data.a->SetPosition(data.a->GetPosition() + offsetA);
-			Vector2 offsetB = -data.collisionNormal * (data.penetration * data.b->GetInverseMass() / (data.a->GetInverseMass() + data.b->GetInverseMass()));
-			data.b->SetPosition(data.b->GetPosition() + offsetB);
+			//calculate impulse magnitude
+			Real impulseMagnitude = -(1 + e) * projectedRV;
+			impulseMagnitude /= (data.a->GetInverseMass() + data.b->GetInverseMass());
 
-			//[debug] add collision point for rendering
-			//program->collisionPoints.push_back(collisionPoint);
+			//turn into vector
+			Vector2 impulse = data.collisionNormal * impulseMagnitude;
+
+			ApplyContactImpulse(data.a, -impulse, collisionPoint);
+			ApplyContactImpulse(data.b, impulse, collisionPoint);
+#endif
 		}
-	}
 
-	bool PhysicsSystem::EvaluateCollision(CollisionData & data)
-	{
-		int x = (int)data.a->GetCollider(data.colliderIndexA).GetShape()->GetType();
-		int y = (int)data.b->GetCollider(data.colliderIndexB).GetShape()->GetType();
-		return (collisionFunctions[x][y])(data);
+		//teleport shapes out of each other based on mass
+		Vector2 offsetA = data.collisionNormal * (data.penetration * data.a->GetInverseMass() / (data.a->GetInverseMass() + data.b->GetInverseMass()));
+		if (!data.a->IsFixed())
+			data.a->transform.position += offsetA;
+		Vector2 offsetB = -data.collisionNormal * (data.penetration * data.b->GetInverseMass() / (data.a->GetInverseMass() + data.b->GetInverseMass()));
+		if (!data.b->IsFixed())
+			data.b->transform.position += offsetB;
+
+		//[debug] add collision point for rendering
+		//program->collisionPoints.push_back(collisionPoint);
 	}
 
 	PhysicsSystem::~PhysicsSystem()
 	{
+		for (auto* joint : joints)
+			DestroyJoint(joint);
+		joints.clear();
+
 		for (size_t i = 0; i < bodies.size(); i++)
 		{
-			delete bodies[i];
+			DestroyBody(bodies[i]);
 			bodies[i] = nullptr;
 		}
 	}
@@ -4,30 +4,143 @@
 
 namespace fzx
 {
-	typedef bool (*CollideFunction)(fzx::CollisionData& data);
-
 	constexpr int FZX_DEFAULT_GRAVITY = 5;
 	constexpr int FZX_DEFAULT_COLLISION_ITERATIONS = 1;
 
+	struct PhysicsPoolStats
+	{
+		PoolStats bodies;
+		PoolStats joints;
+		//shape pools are shared between every physics system
+		PoolStats circles;
+		//every polygon tier added together
+		PoolStats polygons;
+		PoolStats capsules;
+		PoolStats planes;
+	};
+
+	//used to create lots of bodies at once
+	struct BodyDesc
+	{
+		PhysicsData data;
+		//the shapes in these are owned by the body once it is created
+		const ColliderDesc* colliders = nullptr;
+		unsigned char colliderCount = 0;
+		void* infoPointer = nullptr;
+	};
+
+	//input to the batched circle kernels, one entry per pair (structure of arrays so they can be loaded 4 at a time)
+	//a is always a circle in world space. b is a circle too, or for planes b is the normal and bRadius is the plane distance
+	struct CircleBatch
+	{
+		std::vector<Real> ax, ay, aRadius;
+		std::vector<Real> bx, by, bRadius;
+
+		void Resize(size_t count)
+		{
+			ax.resize(count); ay.resize(count); aRadius.resize(count);
+			bx.resize(count); by.resize(count); bRadius.resize(count);
+		}
+	};
+
+	//compact contact written by the batched kernels, only for pairs that are touching
+	struct CircleContact
+	{
+		Vector2 normal;
+		Vector2 point;
+		Real penetration;
+		//index of the pair in the batch
+		unsigned int pairIndex;
+	};
+
+	//what each thread needs to solve islands on its own
+	struct SolverScratch
+	{
+		CircleBatch circleBatch;
+		std::vector<CircleContact> circleContacts;
+		//contacts resolved by this thread, added to the step's contacts once every island is done
+		std::vector<ContactEvent> contacts;
+	};
+
 	class PhysicsSystem
 	{
 	public:
-		PhysicsSystem(float deltaTime, Vector2 gravity = Vector2{ 0, -FZX_DEFAULT_GRAVITY }, int collisionIterations = FZX_DEFAULT_COLLISION_ITERATIONS) : deltaTime(deltaTime), gravity(gravity), collisionIterations(collisionIterations) {}
+		PhysicsSystem(Real deltaTime, Vector2 gravity = Vector2{ 0, -FZX_DEFAULT_GRAVITY }, int collisionIterations = FZX_DEFAULT_COLLISION_ITERATIONS) : deltaTime(deltaTime), gravity(gravity), collisionIterations(collisionIterations) {}
 		
-		PhysicsObject* PointCast(Vector2 point, bool includeStatic = false, bool includeTriggers = false, short collisionMask = 0xFFFF);
-		std::vector<PhysicsObject*>&& PointCastMultiple(Vector2 point, bool includeStatic = false, bool includeTriggers = false, short collisionMask = 0xFFFF);
+		//returns the first body with a collider containing the point
+		PhysicsObject* PointCast(Vector2 point, bool includeStatic = false, bool includeTriggers = false, unsigned short collisionMask = 0xFFFF);
+
+		//these call the callback for every collider containing the point (or with an AABB overlapping the aabb). they return false if the callback stopped the query early
+		//a round polygon's AABB is the box around its bounding circle, so it can be a little bigger than the polygon
+		bool QueryPoint(Vector2 point, QueryCallback callback, void* infoPtr, bool includeStatic = false, bool includeTriggers = false, unsigned short collisionMask = 0xFFFF);
+		bool QueryAABB(const AABB& aabb, QueryCallback callback, void* infoPtr, bool includeStatic = false, bool includeTriggers = false, unsigned short collisionMask = 0xFFFF);
+		//these write each body found once into results, stopping when maxResults is reached. they return the number of bodies written
+		size_t QueryPoint(Vector2 point, PhysicsObject** results, size_t maxResults, bool includeStatic = false, bool includeTriggers = false, unsigned short collisionMask = 0xFFFF);
+		size_t QueryAABB(const AABB& aabb, PhysicsObject** results, size_t maxResults, bool includeStatic = false, bool includeTriggers = false, unsigned short collisionMask = 0xFFFF);
+
+		//returns true if something was hit. rays that start inside a shape ignore that shape
+		bool RayCast(Vector2 origin, Vector2 direction, Real maxDistance, RayCastHit& hit, unsigned short collisionMask = 0xFFFF, bool includeTriggers = false);
+		//casts count rays, writing the closest hit of each into hits (which must be at least count long). returns the number of rays that hit something
+		size_t RayCastMany(const Ray* rays, RayCastHit* hits, size_t count, bool includeTriggers = false);
+
+		//sweeps shape from transform along translation and returns true if it hits something on the way. like rays, shapes that are already overlapping at the start are ignored
+		//the shape stops just short of the surface it hits. planes can't be cast
+		bool ShapeCast(Shape* shape, Transform& transform, Vector2 translation, ShapeCastHit& hit, unsigned short collisionMask = 0xFFFF, bool includeTriggers = false);
 
 		void Update();
 		
 		PhysicsObject* CreatePhysicsObject(PhysicsData& data);
+		//creates count bodies with their colliders already added, then builds the broadphase once for all of them
+		//if results isn't nullptr the created bodies are written into it, so it must be at least count long
+		void CreateBodies(const BodyDesc* descs, size_t count, PhysicsObject** results = nullptr);
 		void DeletePhysicsBody(PhysicsObject* body);
 		void ClearPhysicsBodies();
+		//returns nullptr if the desc has no body a, or joins a body to itself. joints are deleted with either of their bodies
+		Joint* CreateJoint(const JointDesc& desc);
+		void DeleteJoint(Joint* joint);
+		inline const std::vector<Joint*>& GetJoints() { return joints; }
+		PhysicsPoolStats GetPoolStats();
+		//hash of every body's id, position, rotation, velocities and sleep state, and every joint's warm starting impulses. two systems that have been through the same steps have the same hash,
+		//so it can be compared between machines or runs to find desyncs (only guaranteed to match with FZX_DETERMINISTIC)
+		unsigned long long HashState();
 
-		inline float GetDeltaTime() { return deltaTime; }
-		inline void SetDeltaTime(float newDeltaTime) { deltaTime = newDeltaTime; }
+		//writes every body, collider, shape and velocity, plus the contact and trigger caches, to a binary blob (overwriting what's in it)
+		//the blob uses this build's memory layout, so it should only be restored by the same build (it's for rollback and checkpoints, not saving to disk)
+		void SaveSnapshot(std::vector<unsigned char>& snapshot);
+		//puts the world back exactly how it was when the snapshot was saved. bodies and joints are matched by ID, so ones that still exist keep their pointers,
+		//info pointers and (if they haven't changed) colliders. info pointers aren't saved, so ones that are made again have none
+		//returns false and leaves the world empty if the snapshot is broken
+		bool RestoreSnapshot(const unsigned char* snapshot, size_t size);
 
+		//adds every body in a scene file (see Scene.h) to the world. the file is memory mapped and its tables are used in place
+		//returns false without adding anything if the file can't be opened or isn't a valid scene
+		bool LoadScene(const char* path);
+		//same as above, for a scene that is already in memory (it must be 4 byte aligned)
+		bool LoadScene(const void* data, size_t size);
+		//writes every body in the world to a scene file. shapes shared between colliders are only written once
+		bool SaveScene(const char* path);
+
+		inline Real GetDeltaTime() { return deltaTime; }
+		inline void SetDeltaTime(Real newDeltaTime) { deltaTime = newDeltaTime; }
+		inline Vector2 GetGravity() { return gravity; }
+		inline void SetGravity(Vector2 newGravity) { gravity = newGravity; }
+		inline int GetCollisionIterations() { return collisionIterations; }
+		inline void SetCollisionIterations(int iterations) { collisionIterations = iterations; }
+		inline size_t GetPhysicsObjectCount() { return bodies.size(); }
+		//islands are solved on this many threads (including the one calling Update). the result is the same with any number of threads
+		inline void SetThreadCount(unsigned int count) { workers.SetThreadCount(count); }
+		inline unsigned int GetThreadCount() { return workers.GetThreadCount(); }
+		//the number of islands with contacts in the last collision iteration
+		inline size_t GetIslandCount() { return islandCount; }
+
+		//the collision callback is a pre-solve filter, it can reject contacts but should not be used to react to them (use GetContactEvents for that)
+		//with more than one thread it is called from several threads at once (but never for two bodies in the same island at once)
 		inline void SetCollisionCallback(CollisionCallback callback, void* infoPointer) { this->cCallback = callback; cCallbackPtr = infoPointer; };
 		inline CollisionCallback GetCollisionCallback() { return cCallback; };
+		//begin/persist/end events from the last Update(), valid until the next Update() or until one of the bodies is deleted
+		inline const std::vector<ContactEvent>& GetContactEvents() { return contactEvents; }
+		//enter/stay/exit events from the last Update(), same lifetime as contact events
+		inline const std::vector<TriggerEvent>& GetTriggerEvents() { return triggerEvents; }
 
 		//seperate function from destructor just so it is clear what order things are destroyed in
 		~PhysicsSystem();
@@ -35,48 +148,166 @@ namespace fzx
 		PhysicsSystem& operator=(const PhysicsSystem& other) = delete;
 
 	private:
+		//these read the body list directly
+		friend class StateEncoder;
+		friend class StateDecoder;
+		//bodies tell the system when their colliders change or a static body is moved
+		friend PhysicsObject;
 
-		void ResolveCollisions();
+		//trigger pairs are only collected on the first iteration
+		void ResolveCollisions(bool firstIteration);
 		void UpdatePhysics();
+		void UpdateTriggers();
+		void PrepareJoints();
+		void SolveJoints();
+		//puts bodies that have stopped moving to sleep, a whole island at a time, and wakes islands that something has touched
+		void UpdateSleep();
+		//wakes every body touching or joined to this one
+		void WakeTouching(PhysicsObject* body);
+
+		//union-find over the bodies' solver indices. fixed bodies are never joined, so everything resting on the floor isn't one island
+		unsigned int FindIsland(unsigned int index);
+		void UnionIslands(PhysicsObject* a, PhysicsObject* b);
+		//splits this iteration's pairs into islands, so each island's pairs are together (in the same order as before) in every bucket
+		void BuildIslands();
+		void SolveIsland(size_t island, SolverScratch& scratch);
+		static void SolveIslandJob(size_t island, unsigned int thread, void* infoPtr);
 		
 		bool CheckAABBCollision(AABB& a, AABB& b);
+		//runs one narrowphase kernel over pairs from a bucket, resolving each contact as it is found
+		template<typename ShapeA, typename ShapeB, bool (*Collide)(ShapeA*, ShapeB*, CollisionData&)>
+		void ResolveBucket(CollisionData* pairs, size_t count, SolverScratch& scratch);
+		//circle-circle and circle-plane pairs are collided all at once with the batched kernels, then resolved
+		void ResolveCircleCircleBucket(CollisionData* pairs, size_t count, SolverScratch& scratch);
+		void ResolveCirclePlaneBucket(CollisionData* pairs, size_t count, SolverScratch& scratch);
+		//sleeping, static, and kinematic bodies that aren't moving. pairs of these aren't collided
+		static bool IsResting(PhysicsObject* body);
+		static void OnBroadphasePair(PhysicsObject* a, PhysicsObject* b, void* infoPtr);
+		static Real OnBroadphaseRay(PhysicsObject* body, void* infoPtr);
+		static bool OnBroadphaseQuery(PhysicsObject* body, void* infoPtr);
+		//wakes the sleeping bodies around a moving kinematic body
+		static bool OnKinematicQuery(PhysicsObject* body, void* infoPtr);
+		static bool OnBroadphaseShapeCast(PhysicsObject* body, void* infoPtr);
+		bool Query(const AABB& aabb, bool testPoint, QueryCallback callback, void* infoPtr, bool includeStatic, bool includeTriggers, unsigned short collisionMask);
+		//makes sure the body lists and broadphase match the bodies before stepping or running a query outside of Update()
+		void UpdateBroadphase();
+		//the list (moving, kinematic or static) the body belongs in
+		std::vector<PhysicsObject*>& GetBodyList(PhysicsObject* body);
+		void AddBody(PhysicsObject* body);
+		//marks the part of the broadphase the body is in as dirty, or all the lists if it has stopped being dynamic
+		void OnCollidersChanged(PhysicsObject* body, bool wasDynamic);
 
-		void ResolveCollision(CollisionData& data);
-		bool EvaluateCollision(CollisionData& data);
+		void ResolveCollision(CollisionData& data, SolverScratch& scratch);
+		void RecordContact(CollisionData& data, std::vector<ContactEvent>& contacts);
+		//contacts change bodies without waking them, so resting bodies can fall asleep. fixed bodies aren't written at all, since islands on other threads can share them
+		static void ApplyContactImpulse(PhysicsObject* body, Vector2 impulse, Vector2 point);
+		void GenerateContactEvents();
+		void DestroyBody(PhysicsObject* body);
+		void DestroyJoint(Joint* joint);
+		//puts the pair of bodies in jointFilter if the joint stops them colliding
+		void AddJointFilter(Joint* joint);
 
 		//individual bodies could be accessed from other scripts, so this should mean they are kept in the same place no matter what
 		std::vector<PhysicsObject*> bodies;
-		std::vector<CollisionData> collisions;
+		//bodies split up by how they move, kept in the same order as bodies. static bodies are never integrated,
+		//and their AABBs and trees are only updated when one of them is added, removed or moved. kinematic ones only move by their velocity
+		std::vector<PhysicsObject*> movingBodies;
+		std::vector<PhysicsObject*> kinematicBodies;
+		std::vector<PhysicsObject*> staticBodies;
+		//bodies are allocated from here, so they don't move and creating/deleting lots of them doesn't go through the heap
+		Pool<PhysicsObject> bodyPool;
+		//pairs found by the broadphase, bucketed by the type of shape pair so each bucket only uses one collide function
+		std::vector<CollisionData> collisions[(int)COLLISION_TYPE::COUNT];
+		Broadphase broadphase;
+		//set when a body changes type or the bodies are all replaced, so every body is put back in the right list
+		bool bodyListsDirty = false;
+		//set when moving or kinematic bodies are added or removed, since then their trees have to be rebuilt before they can be queried
+		bool broadphaseDirty = true;
+		//set when a static body is added, removed or moved, so the static trees are rebuilt
+		bool staticDirty = true;
+		//static bodies moved since last step, whatever is touching them is woken up
+		std::vector<PhysicsObject*> movedStaticBodies;
+		bool collectTriggers = false;
+		//after the first iteration, pairs between bodies that didn't move last iteration are skipped
+		bool skipSettled = false;
 
-		float deltaTime;
-		Vector2 gravity;
-		const int collisionIterations;
+		//one per thread, reused so solving doesn't allocate every step
+		std::vector<SolverScratch> solverScratch;
+		WorkerPool workers;
 
-		static CollideFunction collisionFunctions[4][4];
+		//island data, indexed by the bodies' solver indices
+		std::vector<unsigned int> islandParents;
+		std::vector<unsigned int> islandOfRoot;
+		//UINT_MAX for fixed bodies and bodies without any pairs this iteration
+		std::vector<unsigned int> bodyIslands;
+		//bodies that haven't moved since their AABB was made, because their island had no contacts last iteration
+		std::vector<unsigned char> settledBodies;
+		//the smallest sleep time in each island
+		std::vector<Real> islandSleepTimes;
+		size_t islandCount = 0;
+		//where each island's pairs start in each bucket, islandCount + 1 long
+		std::vector<unsigned int> islandRanges[(int)COLLISION_TYPE::COUNT];
+		//whether each island resolved a contact this iteration
+		std::vector<unsigned char> islandContacts;
+		std::vector<CollisionData> islandSortScratch;
+
+		//every contact found this step, including duplicates from multiple collision iterations
+		std::vector<ContactEvent> stepContacts;
+		//the unique contacts from last step, sorted by body ID. used to find which contacts began or ended
+		std::vector<ContactEvent> lastContacts;
+		std::vector<ContactEvent> contactEvents;
+
+		//trigger pairs with overlapping AABBs this step
+		std::vector<TriggerEvent> triggerPairs;
+		//the trigger pairs that were overlapping last step, sorted by body ID
+		std::vector<TriggerEvent> triggerOverlaps;
+		std::vector<TriggerEvent> triggerEvents;
+		unsigned int nextBodyID = 1;
+
+		//solved in creation order
+		std::vector<Joint*> joints;
+		//joints with at least one awake body this step
+		std::vector<Joint*> activeJoints;
+		Pool<Joint> jointPool;
+		unsigned int nextJointID = 1;
+		//body ID pairs (lowest first) that a joint stops from colliding, sorted so the broadphase can binary search it.
+		//a pair is in here once for each joint between them
+		std::vector<std::pair<unsigned int, unsigned int>> jointFilter;
+
+		//scratch storage for snapshots, kept so saving and restoring don't allocate every time
+		std::vector<std::pair<unsigned int, unsigned int>> snapshotIndices;
+		std::vector<PhysicsObject*> snapshotBodies;
+		std::vector<bool> snapshotClaimed;
+		std::vector<Joint*> snapshotJoints;
+		std::vector<unsigned char> snapshotScratch;
+
+		Real deltaTime;
+		Vector2 gravity;
+		int collisionIterations;
 
 		//called when two objects are colliding. If this returns false, the collision will not be evaluated.
 		CollisionCallback cCallback = nullptr;
 		void* cCallbackPtr = nullptr;
 
-		//return true if collision occured
-		static bool CollideCircleCircle(CollisionData& data);
-		static bool CollideCirclePolygon(CollisionData& data);
-		static bool CollideCircleCapsule(CollisionData& data);
-		static bool CollideCirclePlane(CollisionData& data);
-		static bool CollidePolygonPolygon(CollisionData& data);
-		static bool CollidePolygonCapsule(CollisionData& data);
-		static bool CollidePolygonPlane(CollisionData& data);
-		static bool CollideCapsuleCapsule(CollisionData& data);
-		static bool CollideCapsulePlane(CollisionData& data);
-		static bool CollideInvalid(CollisionData& data);
-
-		//flipped functions
-		static bool CollidePolygonCircle(CollisionData& data);
-		static bool CollideCapsuleCircle(CollisionData& data);
-		static bool CollidePlaneCircle(CollisionData& data);
-		static bool CollideCapsulePolygon(CollisionData& data);
-		static bool CollidePlanePolygon(CollisionData& data);
-		static bool CollidePlaneCapsule(CollisionData& data);
+		//return true if collision occured. the shape types are always in enum order, so there are no flipped versions
+		//the world transforms of the shapes are in data.transformA and data.transformB
+		static bool CollideCircleCircle(CircleShape* a, CircleShape* b, CollisionData& data);
+		static bool CollideCirclePolygon(CircleShape* a, PolygonShape* b, CollisionData& data);
+		static bool CollideCircleCapsule(CircleShape* a, CapsuleShape* b, CollisionData& data);
+		static bool CollideCirclePlane(CircleShape* a, PlaneShape* b, CollisionData& data);
+		static bool CollidePolygonPolygon(PolygonShape* a, PolygonShape* b, CollisionData& data);
+		static bool CollidePolygonCapsule(PolygonShape* a, CapsuleShape* b, CollisionData& data);
+		static bool CollidePolygonPlane(PolygonShape* a, PlaneShape* b, CollisionData& data);
+		//specialised for each polygon tier's capacity (0 for any other), like PolygonShape::GetSupportIndex
+		template<int CAPACITY>
+		static bool CollidePolygonPlane(PolygonShape* a, PlaneShape* b, CollisionData& data);
+		static bool CollideCapsuleCapsule(CapsuleShape* a, CapsuleShape* b, CollisionData& data);
+		static bool CollideCapsulePlane(CapsuleShape* a, PlaneShape* b, CollisionData& data);
+
+		//batched versions of the circle functions, 4 pairs at a time when SIMD is available
+		//they write a contact for each pair that is touching, and return how many were written
+		static size_t CollideCircleCircleBatch(const CircleBatch& batch, size_t count, CircleContact* contacts);
+		static size_t CollideCirclePlaneBatch(const CircleBatch& batch, size_t count, CircleContact* contacts);
 
 		//epa + gjk + other stuff
 		struct Simplex
@@ -86,7 +317,7 @@ namespace fzx
 		};
 		struct EPACollisionData
 		{
-			float depth;
+			Real depth;
 			Vector2 collisionNormal;
 		};
 		struct PolygonEdge {
@@ -107,8 +338,16 @@ namespace fzx
 		static Vector2 GetSupport(Shape* a, Shape* b, Transform& tA, Transform& tB, Vector2 d);
 		static	Vector2 ClosestPointToOrigin(Vector2 a, Vector2 b);
 		static	bool GJK(Shape* a, Shape* b, Transform& tA, Transform& tB, Simplex* finalSimplex);
+		//boolean overlap test for triggers, no EPA
+		static	bool TestOverlap(Shape* a, Shape* b, Transform& tA, Transform& tB);
 		static	bool EPA(Shape* a, Shape* b, Transform& tA, Transform& tB, EPACollisionData* data);
+		//distance between two shapes that aren't overlapping, along with the closest point on each. returns 0 if they are overlapping
+		static	Real GJKDistance(Shape* a, Shape* b, Transform& tA, Transform& tB, Vector2& pointA, Vector2& pointB);
+		//moves a along translation until it touches b. fraction is the max fraction to check going in and the time of impact coming out
+		static	bool TimeOfImpact(Shape* a, Transform& tA, Vector2 translation, Shape* b, Transform& tB, Real& fraction, Vector2& point, Vector2& normal);
+		static	PolygonEdge FindPolygonCollisionEdge(PolygonShape* pS, Transform& t, Vector2 normal);
+		template<int CAPACITY>
 		static	PolygonEdge FindPolygonCollisionEdge(PolygonShape* pS, Transform& t, Vector2 normal);
-		static	ClipInfo Clip(Vector2 pointToClip1, Vector2 pointToClip2, Vector2 clippingNormal, float clipDist);
+		static	ClipInfo Clip(Vector2 pointToClip1, Vector2 pointToClip2, Vector2 clippingNormal, Real clipDist);
 	};
 }
\ No newline at end of file
@@ -6,7 +6,30 @@
 
 namespace fzx
 {
-	PlaneShape::PlaneShape(Vector2 normal, float d) : normal(normal), distance(d)
+	//never destroyed, so shapes can still be deleted during static destruction
+	static SharedPool<PlaneShape>& GetShapePool()
+	{
+		static SharedPool<PlaneShape>* pool = new SharedPool<PlaneShape>();
+		return *pool;
+	}
+
+	void* PlaneShape::operator new(size_t size)
+	{
+		assert(size == sizeof(PlaneShape));
+		return GetShapePool().Allocate();
+	}
+
+	void PlaneShape::operator delete(void* ptr)
+	{
+		GetShapePool().Free(ptr);
+	}
+
+	PoolStats PlaneShape::GetPoolStats()
+	{
+		return GetShapePool().GetStats();
+	}
+
+	PlaneShape::PlaneShape(Vector2 normal, Real d) : normal(normal), distance(d)
 	{}
 
 	PlaneShape::PlaneShape(Vector2 normal, Vector2 startPosition)
@@ -27,7 +50,7 @@ namespace fzx
 		return glm::dot(transform.InverseTransformPoint(point), normal) < distance;
 	}
 
-	void PlaneShape::CalculateMass(float& mass, float& inertia, float density)
+	void PlaneShape::CalculateMass(Real& mass, Real& inertia, Real density)
 	{
 		mass = 0;
 		inertia = 0;
@@ -58,8 +81,33 @@ namespace fzx
 			return Vector2(INFINITY, INFINITY);
 	}
 
+	bool PlaneShape::RayCast(Vector2 origin, Vector2 direction, Real maxDistance, Transform& transform, Real& distance, Vector2& normal)
+	{
+		Vector2 worldNormal = transform.TransformDirection(this->normal);
+		Real worldDistance = glm::dot(transform.TransformPoint(this->distance * this->normal), worldNormal);
+
+		//everything behind the plane is inside it
+		Real height = glm::dot(origin, worldNormal) - worldDistance;
+		Real speed = glm::dot(direction, worldNormal);
+		if (height <= 0 || speed >= 0)
+			return false;
+
+		Real t = -height / speed;
+		if (t > maxDistance)
+			return false;
+
+		distance = t;
+		normal = worldNormal;
+		return true;
+	}
+
 	Vector2 PlaneShape::GetCentrePoint()
 	{
 		return normal * distance;
 	}
+
+	Real PlaneShape::GetBoundingRadius()
+	{
+		return INFINITY;
+	}
 }
\ No newline at end of file
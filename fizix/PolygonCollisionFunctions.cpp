@@ -2,9 +2,11 @@
 
 namespace fzx
 {
-	constexpr float DISTANCE_TOLERANCE = 0.0001f;
-	constexpr float CLIP_TOLERANCE = 0.001f;
+	constexpr Real DISTANCE_TOLERANCE = 0.0001f;
+	constexpr Real CLIP_TOLERANCE = 0.001f;
 	constexpr int MAXMINKOWSKIPOINTS = 50;
+	//shapes that are only just touching can leave GJK going back and forth between the same two edges forever
+	constexpr int MAX_GJK_ITERATIONS = 32;
 
 	Vector2 PhysicsSystem::GetPerpendicularTowardOrigin(Vector2 a, Vector2 b)
 	{
@@ -12,7 +14,7 @@ namespace fzx
 		// ((b-a) x ((0,0)-a)) x (b-a)
 
 		Vector2 delta = b - a;
-		float cross = em::Cross(delta, -a);
+		Real cross = em::Cross(delta, -a);
 		return glm::normalize(Vector2(-cross * delta.y, cross * delta.x));
 
 		//triple cross product can be converted into dot product. kinda cool
@@ -24,10 +26,10 @@ namespace fzx
 		//is perpendicular to line, facing in the direction of direction
 		// (direction x line) x line
 
-		float cross = em::Cross(direction, line);
+		Real cross = em::Cross(direction, line);
 
 		Vector2 tripleCross = Vector2(-cross * line.y, cross * line.x);
-		float len = glm::length(tripleCross);
+		Real len = glm::length(tripleCross);
 
 		//this happens when line and direction are exactly parallel and when direction or line are 0,0
 		if (len == 0)
@@ -79,7 +81,7 @@ namespace fzx
 		//This is because all the points on the other side of the line AB are moving away from the origin 
 		tri.dir = GetPerpendicularTowardOrigin(tri.a, tri.b);
 
-		while (true)
+		for (int iteration = 0; iteration < MAX_GJK_ITERATIONS; iteration++)
 		{
 			//at this point in the loop, tri.c is always undefined.
 			tri.c = GetSupport(a, b, tA, tB, tri.dir);
@@ -119,6 +121,30 @@ namespace fzx
 
 			return true;
 		}
+		//it never got any closer, so the origin is on the edge of the minkowski difference and the shapes are only touching
+		return false;
+	}
+
+	bool PhysicsSystem::TestOverlap(Shape* a, Shape* b, Transform& tA, Transform& tB)
+	{
+		//GJK doesn't work with planes (their support points are at infinity), so test the furthest point of the other shape against the plane instead
+		bool aIsPlane = a->GetType() == SHAPE_TYPE::PLANE, bIsPlane = b->GetType() == SHAPE_TYPE::PLANE;
+		if (aIsPlane && bIsPlane)
+			return false;
+
+		if (aIsPlane || bIsPlane)
+		{
+			PlaneShape* plane = (PlaneShape*)(aIsPlane ? a : b);
+			Transform& tPlane = aIsPlane ? tA : tB;
+			Shape* other = aIsPlane ? b : a;
+			Transform& tOther = aIsPlane ? tB : tA;
+
+			Vector2 planeNormal = tPlane.TransformDirection(plane->normal);
+			Real planeDistance = glm::dot(tPlane.TransformPoint(plane->distance * plane->normal), planeNormal);
+			return glm::dot(other->Support(-planeNormal, tOther), planeNormal) < planeDistance;
+		}
+
+		return GJK(a, b, tA, tB, nullptr);
 	}
 
 	//the final version of this function is based on this video: https://www.youtube.com/watch?v=0XQ2FSz3EK8 and this page: https://dyn4j.org/2010/04/gjk-distance-closest-points/
@@ -141,10 +167,14 @@ namespace fzx
 		polytope.push_back(gjkSimplex.b);
 		polytope.push_back(gjkSimplex.c);
 
+		//edge normals point out of the polytope based on which way it winds, rather than away from the origin.
+		//when the shapes are only just touching the origin is on an edge, and which side of it the origin is on can't be trusted
+		Real winding = em::Cross(polytope[1] - polytope[0], polytope[2] - polytope[0]);
+
 		//temp variables containing edge information
-		float lastDepth = INFINITY;
+		Real lastDepth = INFINITY;
 		Vector2 edgeNormal = Vector2(0, 0);
-		float dist;
+		Real dist;
 		int index;
 
 		while (true)
@@ -158,9 +188,10 @@ namespace fzx
 			{
 
 				Vector2 delta = polytope[j] - polytope[i];
-				Vector2 norm = glm::normalize(em::TripleCross(delta, polytope[i], delta));
+				Vector2 norm = winding > 0 ? Vector2(delta.y, -delta.x) : winding < 0 ? Vector2(-delta.y, delta.x) : em::TripleCross(delta, polytope[i], delta);
+				norm = glm::normalize(norm);
 
-				float d = glm::dot(norm, polytope[i]);
+				Real d = glm::dot(norm, polytope[i]);
 				if (d < dist)
 				{
 					//distance
@@ -185,7 +216,7 @@ namespace fzx
 
 			Vector2 support = GetSupport(a, b, tA, tB, edgeNormal);
 
-			float depth = glm::dot(support, edgeNormal);
+			Real depth = glm::dot(support, edgeNormal);
 			if (depth - dist < DISTANCE_TOLERANCE)
 			{
 				//we have found the edge nearest the origin (or something close to it)
@@ -200,45 +231,281 @@ namespace fzx
 				//add the support point into the polytope vector, in between the points that created the edge
 				polytope.insert(polytope.begin() + index, support);
 
+				//the polytope stopped converging, so give up with a rough answer rather than keep growing it
 				if (polytope.size() > MAXMINKOWSKIPOINTS)
 				{
 					data->depth = 0.1f;
-
 					data->collisionNormal = isnan(edgeNormal.x) ? Vector2(1, 0) : edgeNormal;
-					std::cout << "went over maximum\n";
 					return true;
 				}
 			}
 		}
 	}
 
+	constexpr int MAX_DISTANCE_ITERATIONS = 20;
+	//shape casts stop when the shapes are this far apart, so the hit shape isn't already overlapping when it is placed there
+	constexpr Real TOI_TARGET = 0.005f;
+	constexpr Real TOI_TOLERANCE = 0.001f;
+	constexpr int MAX_TOI_ITERATIONS = 20;
 
-	//returns index 
+	struct DistanceVertex
+	{
+		//support points on shape a and b
+		Vector2 a, b;
+		//a - b, the point on the minkowski difference
+		Vector2 w;
+		//barycentric coordinate of the closest point
+		Real u;
+	};
+
+	//finds the closest point to the origin on the simplex, removing vertices that don't contribute to it and setting the barycentric coordinates of the rest
+	//returns false if the origin is inside the simplex
+	static bool SolveDistanceSimplex(DistanceVertex* simplex, int& count)
+	{
+		if (count == 1)
+		{
+			simplex[0].u = 1;
+			return true;
+		}
 
-	PhysicsSystem::PolygonEdge PhysicsSystem::FindPolygonCollisionEdge(PolygonShape* pS, Transform& t, Vector2 normal)
+		Vector2 w1 = simplex[0].w, w2 = simplex[1].w;
+		Vector2 e12 = w2 - w1;
+		Real d12_1 = glm::dot(w2, e12);
+		Real d12_2 = -glm::dot(w1, e12);
+
+		if (count == 2)
+		{
+			if (d12_2 <= 0)
+			{
+				simplex[0].u = 1;
+				count = 1;
+			}
+			else if (d12_1 <= 0)
+			{
+				simplex[0] = simplex[1];
+				simplex[0].u = 1;
+				count = 1;
+			}
+			else
+			{
+				Real inv = 1 / (d12_1 + d12_2);
+				simplex[0].u = d12_1 * inv;
+				simplex[1].u = d12_2 * inv;
+			}
+			return true;
+		}
+
+		//triangle case, check each vertex and edge region before the inside
+		Vector2 w3 = simplex[2].w;
+		Vector2 e13 = w3 - w1;
+		Real d13_1 = glm::dot(w3, e13);
+		Real d13_2 = -glm::dot(w1, e13);
+		Vector2 e23 = w3 - w2;
+		Real d23_1 = glm::dot(w3, e23);
+		Real d23_2 = -glm::dot(w2, e23);
+
+		Real n123 = em::Cross(e12, e13);
+		Real d123_1 = n123 * em::Cross(w2, w3);
+		Real d123_2 = n123 * em::Cross(w3, w1);
+		Real d123_3 = n123 * em::Cross(w1, w2);
+
+		if (d12_2 <= 0 && d13_2 <= 0)
+		{
+			simplex[0].u = 1;
+			count = 1;
+		}
+		else if (d12_1 > 0 && d12_2 > 0 && d123_3 <= 0)
+		{
+			Real inv = 1 / (d12_1 + d12_2);
+			simplex[0].u = d12_1 * inv;
+			simplex[1].u = d12_2 * inv;
+			count = 2;
+		}
+		else if (d13_1 > 0 && d13_2 > 0 && d123_2 <= 0)
+		{
+			Real inv = 1 / (d13_1 + d13_2);
+			simplex[0].u = d13_1 * inv;
+			simplex[1] = simplex[2];
+			simplex[1].u = d13_2 * inv;
+			count = 2;
+		}
+		else if (d12_1 <= 0 && d23_2 <= 0)
+		{
+			simplex[0] = simplex[1];
+			simplex[0].u = 1;
+			count = 1;
+		}
+		else if (d13_1 <= 0 && d23_1 <= 0)
+		{
+			simplex[0] = simplex[2];
+			simplex[0].u = 1;
+			count = 1;
+		}
+		else if (d23_1 > 0 && d23_2 > 0 && d123_1 <= 0)
+		{
+			Real inv = 1 / (d23_1 + d23_2);
+			simplex[0] = simplex[2];
+			simplex[0].u = d23_2 * inv;
+			simplex[1].u = d23_1 * inv;
+			count = 2;
+		}
+		else
+			return false;
+
+		return true;
+	}
+
+	//GJK again, but instead of just checking for the origin it walks the simplex towards the closest point to it
+	//based on the distance version of GJK in box2d
+	Real PhysicsSystem::GJKDistance(Shape* a, Shape* b, Transform& tA, Transform& tB, Vector2& pointA, Vector2& pointB)
 	{
-		//Get the point furthest along the collision normal
-		Vector2 collisionNormal = t.InverseTransformDirection(normal);
-		int pointIndex = 0;
-		float d = glm::dot(collisionNormal, pS->points[0]);
-		float d1;
+		DistanceVertex simplex[3];
+		int count = 1;
+
+		Vector2 dir = tB.position - tA.position;
+		dir = em::SquareLength(dir) > 0 ? glm::normalize(dir) : Vector2(1, 0);
+		simplex[0].a = a->Support(dir, tA);
+		simplex[0].b = b->Support(-dir, tB);
+		simplex[0].w = simplex[0].a - simplex[0].b;
+
+		Vector2 closest;
+		for (int i = 0; i < MAX_DISTANCE_ITERATIONS; i++)
+		{
+			if (!SolveDistanceSimplex(simplex, count))
+				return 0;
+
+			closest = Vector2(0, 0);
+			for (int j = 0; j < count; j++)
+				closest += simplex[j].u * simplex[j].w;
+
+			Real distance = glm::length(closest);
+			if (distance < DISTANCE_TOLERANCE)
+				return 0;
+
+			//search towards the origin from the closest point
+			dir = -closest / distance;
+			DistanceVertex next;
+			next.a = a->Support(dir, tA);
+			next.b = b->Support(-dir, tB);
+			next.w = next.a - next.b;
+
+			//stop when the new point doesn't get any closer to the origin than the simplex already is
+			if (glm::dot(next.w, dir) + distance <= DISTANCE_TOLERANCE)
+				break;
+
+			bool duplicate = false;
+			for (int j = 0; j < count; j++)
+				duplicate |= simplex[j].w == next.w;
+			if (duplicate)
+				break;
+
+			simplex[count++] = next;
+		}
+
+		pointA = Vector2(0, 0);
+		pointB = Vector2(0, 0);
+		for (int j = 0; j < count; j++)
+		{
+			pointA += simplex[j].u * simplex[j].a;
+			pointB += simplex[j].u * simplex[j].b;
+		}
+		return glm::length(pointA - pointB);
+	}
+
+	//conservative advancement: the shapes can't touch before a has moved the distance between them along the normal, so step that far and repeat until they are touching
+	bool PhysicsSystem::TimeOfImpact(Shape* a, Transform& tA, Vector2 translation, Shape* b, Transform& tB, Real& fraction, Vector2& point, Vector2& normal)
+	{
+		Real maxFraction = fraction;
 
-		for (char i = 1; i < pS->pointCount; i++)
+		//planes have support points at infinity, so they are solved directly
+		if (b->GetType() == SHAPE_TYPE::PLANE)
 		{
-			d1 = glm::dot(collisionNormal, pS->points[i]);
-			if (d1 > d)
+			PlaneShape* plane = (PlaneShape*)b;
+			Vector2 planeNormal = tB.TransformDirection(plane->normal);
+			Real planeDistance = glm::dot(tB.TransformPoint(plane->distance * plane->normal), planeNormal);
+
+			Vector2 deepest = a->Support(-planeNormal, tA);
+			Real height = glm::dot(deepest, planeNormal) - planeDistance;
+			Real approach = -glm::dot(translation, planeNormal);
+			if (height <= 0 || approach <= 0)
+				return false;
+
+			Real t = glm::max(height - TOI_TARGET, (Real)0) / approach;
+			if (t > maxFraction)
+				return false;
+
+			fraction = t;
+			point = deepest + translation * t - planeNormal * glm::max(glm::min(height, TOI_TARGET), (Real)0);
+			normal = planeNormal;
+			return true;
+		}
+
+		Transform moved = tA;
+		Vector2 pointA, pointB;
+		Real t = 0;
+		for (int i = 0; i < MAX_TOI_ITERATIONS; i++)
+		{
+			moved.position = tA.position + translation * t;
+			Real distance = GJKDistance(a, b, moved, tB, pointA, pointB);
+			if (distance == 0)
+			{
+				//overlapping at the start means it is ignored, otherwise the last step went a tiny bit too far and the last normal is still good
+				if (i == 0)
+					return false;
+				fraction = t;
+				return true;
+			}
+
+			normal = (pointA - pointB) / distance;
+			point = pointB;
+			if (distance <= TOI_TARGET + TOI_TOLERANCE)
 			{
-				pointIndex = i;
-				d = d1;
+				fraction = t;
+				return true;
 			}
+
+			Real approach = -glm::dot(translation, normal);
+			if (approach <= 0)
+				return false;
+
+			t += (distance - TOI_TARGET) / approach;
+			if (t > maxFraction)
+				return false;
 		}
 
+		//ran out of iterations without getting close enough, so it can't be said that they touch
+		return false;
+	}
+
+
+	//returns index 
+
+	PhysicsSystem::PolygonEdge PhysicsSystem::FindPolygonCollisionEdge(PolygonShape* pS, Transform& t, Vector2 normal)
+	{
+		switch (pS->capacity)
+		{
+		case 4: return FindPolygonCollisionEdge<4>(pS, t, normal);
+		case 8: return FindPolygonCollisionEdge<8>(pS, t, normal);
+		case 16: return FindPolygonCollisionEdge<16>(pS, t, normal);
+		default: return FindPolygonCollisionEdge<0>(pS, t, normal);
+		}
+	}
+
+	template<int CAPACITY>
+	PhysicsSystem::PolygonEdge PhysicsSystem::FindPolygonCollisionEdge(PolygonShape* pS, Transform& t, Vector2 normal)
+	{
+		//Get the point furthest along the collision normal
+		Vector2 collisionNormal = t.InverseTransformDirection(normal);
+		int pointIndex = pS->GetSupportIndex<CAPACITY>(collisionNormal);
+
 		//now see which of the two edges connected to this vertex are most perpendicular to the normal (aka the one with the dot product closest to zero
-		Vector2 pointBack = pS->points[pointIndex == 0 ? pS->pointCount - 1 : pointIndex - 1];
+		int backIndex = pointIndex == 0 ? pS->pointCount - 1 : pointIndex - 1;
+		Vector2 pointBack = pS->points[backIndex];
 		Vector2 pointFront = pS->points[pointIndex + 1 == pS->pointCount ? 0 : pointIndex + 1];
 
-		Vector2 backLine = glm::normalize(pS->points[pointIndex] - pointBack);
-		Vector2 frontLine = glm::normalize(pS->points[pointIndex] - pointFront);
+		//the edge directions are the cached normals rotated back
+		Vector2 backLine = em::GetPerpendicularCounterClockwise(pS->normals[backIndex]);
+		Vector2 frontLine = -em::GetPerpendicularCounterClockwise(pS->normals[pointIndex]);
 
 		Vector2 transformedMaxVert = t.TransformPoint(pS->points[pointIndex]);
 
@@ -250,16 +517,22 @@ namespace fzx
 			return { transformedMaxVert, t.TransformPoint(pointFront),transformedMaxVert };
 	}
 
+	//CollidePolygonPlane's tiers use these
+	template PhysicsSystem::PolygonEdge PhysicsSystem::FindPolygonCollisionEdge<4>(PolygonShape* pS, Transform& t, Vector2 normal);
+	template PhysicsSystem::PolygonEdge PhysicsSystem::FindPolygonCollisionEdge<8>(PolygonShape* pS, Transform& t, Vector2 normal);
+	template PhysicsSystem::PolygonEdge PhysicsSystem::FindPolygonCollisionEdge<16>(PolygonShape* pS, Transform& t, Vector2 normal);
+	template PhysicsSystem::PolygonEdge PhysicsSystem::FindPolygonCollisionEdge<0>(PolygonShape* pS, Transform& t, Vector2 normal);
+
 
 	//clips 2 points so that they are more than or equal to clip distance along the clipping normal
-	PhysicsSystem::ClipInfo PhysicsSystem::Clip(Vector2 pointToClip1, Vector2 pointToClip2, Vector2 clippingNormal, float clipDist)
+	PhysicsSystem::ClipInfo PhysicsSystem::Clip(Vector2 pointToClip1, Vector2 pointToClip2, Vector2 clippingNormal, Real clipDist)
 	{
 		ClipInfo c;
 		c.pointCount = 0;
 
 		//along normal relative to clipDist
-		float point1AlongNormal = glm::dot(clippingNormal, pointToClip1) - clipDist;
-		float point2AlongNormal = glm::dot(clippingNormal, pointToClip2) - clipDist;
+		Real point1AlongNormal = glm::dot(clippingNormal, pointToClip1) - clipDist;
+		Real point2AlongNormal = glm::dot(clippingNormal, pointToClip2) - clipDist;
 
 		//the point is more than
 		if (point1AlongNormal >= 0)
@@ -278,7 +551,7 @@ namespace fzx
 		{
 			Vector2 line = pointToClip2 - pointToClip1;
 			//percentage along the line (uncapped, so it's not between 0 and 1)
-			float t = point1AlongNormal / (point1AlongNormal - point2AlongNormal);
+			Real t = point1AlongNormal / (point1AlongNormal - point2AlongNormal);
 			Vector2 point = line * t + pointToClip1;
 			c.points[c.pointCount] = point; //<-- ignore warning, this will not overrun
 			c.pointCount++;
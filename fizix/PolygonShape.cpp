@@ -1,5 +1,6 @@
 #include "fzx.h"
 #include <stdexcept>
+#include <algorithm>
 #include <format>
 #include <string>
 
@@ -8,12 +9,104 @@
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 namespace fzx
 {
-	PolygonShape::PolygonShape(Vector2* vertices, int vertexCount)
+	//a polygon with inline storage for CAPACITY points and normals. each tier has its own pool, so every slot in it is only as big as it needs to be
+	template<int CAPACITY>
+	class PolygonTier final : public PolygonShape
+	{
+	public:
+		PolygonTier(const Vector2* hull, int hullCount) : PolygonShape(pointStorage, normalStorage, CAPACITY)
+		{
+			SetPoints(hull, hullCount);
+		}
+		PolygonTier(const PolygonTier& other) : PolygonShape(other)
+		{
+			std::copy(other.pointStorage, other.pointStorage + CAPACITY, pointStorage);
+			std::copy(other.normalStorage, other.normalStorage + CAPACITY, normalStorage);
+			points = pointStorage;
+			normals = normalStorage;
+		}
+
+		Shape* Clone() { return new PolygonTier(*this); }
+
+		//never destroyed, so shapes can still be deleted during static destruction
+		static SharedPool<PolygonTier>& GetShapePool()
+		{
+			static SharedPool<PolygonTier>* pool = new SharedPool<PolygonTier>();
+			return *pool;
+		}
+
+		static void* operator new(size_t size)
+		{
+			assert(size == sizeof(PolygonTier));
+			return GetShapePool().Allocate();
+		}
+
+		static void operator delete(void* ptr)
+		{
+			GetShapePool().Free(ptr);
+		}
+
+	private:
+		Vector2 pointStorage[CAPACITY];
+		Vector2 normalStorage[CAPACITY];
+	};
+
+	//the tiers that exist in this build. any that are bigger than FZX_MAX_VERTICES are replaced by the FZX_MAX_VERTICES tier
+	constexpr int SMALL_TIER = FZX_MAX_VERTICES < 4 ? FZX_MAX_VERTICES : 4;
+	constexpr int MEDIUM_TIER = FZX_MAX_VERTICES < 8 ? FZX_MAX_VERTICES : 8;
+	constexpr int LARGE_TIER = FZX_MAX_VERTICES < 16 ? FZX_MAX_VERTICES : 16;
+
+	PolygonShape* PolygonShape::Create(Vector2* vertices, int vertexCount)
 	{
 		//(this function organises vertices, calculates concave hull and centerpoint)
-		OrganisePoints(vertices, vertexCount);
+		Vector2 hull[FZX_MAX_VERTICES];
+		int hullCount = OrganisePoints(vertices, vertexCount, hull);
+
+		//the tier is picked from the hull, which can have fewer points than were passed in
+		if (hullCount <= SMALL_TIER)
+			return new PolygonTier<SMALL_TIER>(hull, hullCount);
+		if (hullCount <= MEDIUM_TIER)
+			return new PolygonTier<MEDIUM_TIER>(hull, hullCount);
+		if (hullCount <= LARGE_TIER)
+			return new PolygonTier<LARGE_TIER>(hull, hullCount);
+		return new PolygonTier<FZX_MAX_VERTICES>(hull, hullCount);
+	}
+
+	PoolStats PolygonShape::GetPoolStats()
+	{
+		PoolStats tiers[] = { PolygonTier<SMALL_TIER>::GetShapePool().GetStats(), PolygonTier<MEDIUM_TIER>::GetShapePool().GetStats(),
+			PolygonTier<LARGE_TIER>::GetShapePool().GetStats(), PolygonTier<FZX_MAX_VERTICES>::GetShapePool().GetStats() };
 
-		//CalculateNormals();
+		//tiers that are capped at FZX_MAX_VERTICES are the same pool, so they're only counted once
+		const int capacities[] = { SMALL_TIER, MEDIUM_TIER, LARGE_TIER, FZX_MAX_VERTICES };
+		PoolStats total{ 0, 0, 0 };
+		for (int i = 0; i < 4; i++)
+		{
+			if (i > 0 && capacities[i] == capacities[i - 1])
+				continue;
+			total.used += tiers[i].used;
+			total.capacity += tiers[i].capacity;
+			total.blockCount += tiers[i].blockCount;
+		}
+		return total;
+	}
+
+	PolygonShape::PolygonShape(Vector2* pointStorage, Vector2* normalStorage, int capacity)
+		: points(pointStorage), normals(normalStorage), pointCount(0), capacity((unsigned char)capacity)
+	{
+	}
+
+	void PolygonShape::SetPoints(const Vector2* hull, int hullCount)
+	{
+		assert(hullCount <= capacity);
+		std::copy(hull, hull + hullCount, points);
+		pointCount = (unsigned char)hullCount;
+
+		CalculateGeometry();
+
+		//the tier's specialised loops go over every slot, so the spare ones repeat the first point and normal, which never win
+		std::fill(points + pointCount, points + capacity, points[0]);
+		std::fill(normals + pointCount, normals + capacity, normals[0]);
 	}
 
 	bool PolygonShape::PointCast(Vector2 point, Transform& transform)
@@ -44,33 +137,12 @@ namespace fzx
 
 	}
 
-	void PolygonShape::CalculateMass(float& mass, float& inertia, float density)
+	void PolygonShape::CalculateMass(Real& mass, Real& inertia, Real density)
 	{
-		//centrepoint is the average of the compositional triangles centrepoints, weighted by area
-		Vector2 polyCentre = Vector2(0, 0);
-		//mass moment of inertia is equal to the sum of the compositional triangle's mass moments
-		float in = 0;
-		float area = 0;
-
-		for (size_t i = 0; i < pointCount; i++)
-		{
-			Vector2& a = this->points[i], b = this->points[(i + 1) % pointCount];
-
-			Vector2 triCentre = (a + b) / 3.0f;
-			float triArea = 0.5f * em::Cross(a, b);
-			area += triArea;
-
-			//fun fact: the squared length of a vector is the same as the dot product of it with itself
-			in += (em::SquareLength(a) + em::SquareLength(b) + glm::dot(a, b)) * triArea / 6;
-			//triangle area * triangle centre
-			polyCentre += triArea * triCentre;
-		}
-		in = density * in;
-
-		//set final values
-		centrePoint = polyCentre / (area); //divide by total area to get the centrepoint
-		mass = area * density; //multiply by density
-		inertia = in - mass * em::SquareLength(centrePoint);//(translate mass moment of inertia to be relative to centrepoint)
+		//the geometry was cached at construction, so this just scales it
+		mass = area * density;
+		//about the shape's origin, like the other shapes (the collider moves it to be about the body's origin)
+		inertia = unitInertia * density;
 	}
 
 	AABB PolygonShape::CalculateAABB(Transform& transform)
@@ -79,11 +151,11 @@ namespace fzx
 
 		Vector2 point = transform.TransformPoint(points[0]);
 
-		float xMax = point.x;
-		float xMin = point.x;
+		Real xMax = point.x;
+		Real xMin = point.x;
 
-		float yMax = point.y;
-		float yMin = point.y;
+		Real yMax = point.y;
+		Real yMin = point.y;
 
 		for (size_t i = 1; i < pointCount; i++)
 		{
@@ -107,33 +179,106 @@ namespace fzx
 		return centrePoint;
 	}
 
-	Shape* PolygonShape::Clone()
+	Real PolygonShape::GetBoundingRadius()
 	{
-		return new PolygonShape(*this);
+		return boundingRadius;
 	}
 
 	Vector2 PolygonShape::Support(Vector2 v, Transform& transform)
 	{
 		v = transform.InverseTransformDirection(v);
+		return transform.TransformPoint(points[GetSupportIndex(v)]);
+	}
+
+	int PolygonShape::GetSupportIndex(Vector2 v)
+	{
+		switch (capacity)
+		{
+		case 4: return GetSupportIndex<4>(v);
+		case 8: return GetSupportIndex<8>(v);
+		case 16: return GetSupportIndex<16>(v);
+		default: return GetSupportIndex<0>(v);
+		}
+	}
+
+	int PolygonShape::HillClimbSupportIndex(Vector2 v)
+	{
+		int index = 0;
+		Real d = glm::dot(v, points[0]);
+
+		//going around a convex polygon the dot products only go up and then down once,
+		//so walk towards whichever neighbour is further along until neither is
+		int step;
+		if (glm::dot(v, points[1]) > d)
+			step = 1;
+		else if (glm::dot(v, points[pointCount - 1]) > d)
+			step = pointCount - 1;
+		else
+			return 0;
+
+		while (true)
+		{
+			//wrapping with a compare instead of % keeps a divide out of every step
+			int next = index + step;
+			if (next >= pointCount)
+				next -= pointCount;
+			Real dNext = glm::dot(v, points[next]);
+			if (dNext <= d)
+				return index;
+			index = next;
+			d = dNext;
+		}
+	}
 
-		Vector2 p = points[0];
-		float d = glm::dot(v, p);
-		float d1;
+	bool PolygonShape::RayCast(Vector2 origin, Vector2 direction, Real maxDistance, Transform& transform, Real& distance, Vector2& normal)
+	{
+		//clip the ray against every edge, in local space
+		origin = transform.InverseTransformPoint(origin);
+		direction = transform.InverseTransformDirection(direction);
+
+		Real lower = 0, upper = maxDistance;
+		int edge = -1;
 
-		for (char i = 1; i < pointCount; i++)
+		for (int i = 0; i < pointCount; i++)
 		{
-			d1 = glm::dot(v, points[i]);
-			if (d1 > d)
+			Vector2 a = points[i];
+			Vector2 edgeNormal = normals[i];
+
+			Real numerator = glm::dot(edgeNormal, a - origin);
+			Real denominator = glm::dot(edgeNormal, direction);
+
+			if (denominator == 0)
+			{
+				//parallel to the edge and outside of it
+				if (numerator < 0)
+					return false;
+			}
+			else if (denominator < 0 && numerator < lower * denominator)
+			{
+				//entering through this edge
+				lower = numerator / denominator;
+				edge = i;
+			}
+			else if (denominator > 0 && numerator < upper * denominator)
 			{
-				p = points[i];
-				d = d1;
+				//leaving through this edge
+				upper = numerator / denominator;
 			}
+
+			if (upper < lower)
+				return false;
 		}
 
-		return transform.TransformPoint(p);
+		//if no edge was entered through, the ray started inside
+		if (edge < 0)
+			return false;
+
+		distance = lower;
+		normal = transform.TransformDirection(normals[edge]);
+		return true;
 	}
 
-	PolygonShape* PolygonShape::GetRegularPolygonCollider(float radius, int pointCount)
+	PolygonShape* PolygonShape::GetRegularPolygonCollider(Real radius, int pointCount)
 	{
 		if (pointCount > FZX_MAX_VERTICES) {
 
@@ -144,16 +289,18 @@ namespace fzx
 
 		Vector2 points[FZX_MAX_VERTICES];
 
-		float iPointCount = glm::two_pi<float>() / pointCount;
+		Real iPointCount = glm::two_pi<Real>() / pointCount;
 		for (size_t i = 0; i < pointCount; i++)
 		{
-			points[i] = Vector2(radius * cos((i + 0.5f) * iPointCount), radius * sin((i + 0.5f) * iPointCount));
+			Real s, c;
+			em::SinCos((i + 0.5f) * iPointCount, s, c);
+			points[i] = Vector2(radius * c, radius * s);
 		}
 
-		return new PolygonShape(points, pointCount);
+		return Create(points, pointCount);
 	}
 
-	bool PolygonShape::OrganisePoints(Vector2* points, int pointCount, bool clipPoints)
+	int PolygonShape::OrganisePoints(Vector2* points, int pointCount, Vector2* hull, bool clipPoints)
 	{
 		//first create convex hull using gift wrapping algorithm https://en.wikipedia.org/wiki/Gift_wrapping_algorithm
 		//this should both discard all points that make the shape concave, and organise the points in a counterclockwise manner
@@ -161,7 +308,7 @@ namespace fzx
 		//the minimum and maximum on any axis is guaranteed to be on the convex hull, so find that for the first point
 
 		int startPoint = 0;
-		float minX = points[0].x;
+		Real minX = points[0].x;
 		for (int i = 1; i < pointCount; i++)
 		{
 			if (points[i].x < minX)
@@ -186,11 +333,11 @@ namespace fzx
 				break;
 			}
 
-			this->points[size] = points[lastPointOnHull];
+			hull[size] = points[lastPointOnHull];
 			endPoint = 0;
 			for (int i = 0; i < pointCount; i++)
 			{
-				float cross = em::CheckOrder(points[lastPointOnHull], points[endPoint], points[i]);
+				Real cross = em::CheckOrder(points[lastPointOnHull], points[endPoint], points[i]);
 
 				// if:
 				// the endpoint is the last hull point
@@ -207,35 +354,41 @@ namespace fzx
 			size++;
 			lastPointOnHull = endPoint;
 		} while (endPoint != startPoint);
-		//now set correct pointCount
-		this->pointCount = size;
-
-		//returns whether point count changed or not
-		return size != pointCount;
+		return size;
 	}
 
 	//WINDING ORDER: COUNTER CLOCKWISE
-	//void PolygonShape::CalculateNormals()
-	//{
-	//	//calculate normals, assuming counter clockwise order
-	//	for (size_t i = 0; i < pointCount; i++)
-	//	{
-	//		int j = (i + 1) % pointCount;
-	//		Vector2 delta = glm::normalize(points[i] - points[j]);
-	//		delta = Vector2(-delta.y, delta.x);
-	//		normals[i] = delta;
-	//	}
-	//}
-
-	void PolygonShape::CalculateCentrePoint()
-	{
-		Vector2 average = Vector2(0, 0);
+	void PolygonShape::CalculateGeometry()
+	{
+		//centrepoint is the average of the compositional triangles centrepoints, weighted by area
+		Vector2 polyCentre = Vector2(0, 0);
+		//mass moment of inertia is equal to the sum of the compositional triangle's mass moments
+		Real in = 0;
+		area = 0;
+
 		for (size_t i = 0; i < pointCount; i++)
 		{
-			average += points[i];
+			Vector2& a = this->points[i], b = this->points[(i + 1) % pointCount];
+
+			//points are counter clockwise, so this faces out
+			normals[i] = glm::normalize(em::GetPerpendicularClockwise(b - a));
+
+			Vector2 triCentre = (a + b) / (Real)3;
+			Real triArea = 0.5f * em::Cross(a, b);
+			area += triArea;
+
+			//fun fact: the squared length of a vector is the same as the dot product of it with itself
+			in += (em::SquareLength(a) + em::SquareLength(b) + glm::dot(a, b)) * triArea / 6;
+			//triangle area * triangle centre
+			polyCentre += triArea * triCentre;
 		}
-		average /= pointCount;
 
-		centrePoint = average;
+		centrePoint = polyCentre / (area); //divide by total area to get the centrepoint
+		unitInertia = in;
+
+		Real maxDistanceSq = 0;
+		for (size_t i = 0; i < pointCount; i++)
+			maxDistanceSq = std::max(maxDistanceSq, em::SquareLength(points[i] - centrePoint));
+		boundingRadius = em::Sqrt(maxDistanceSq);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <mutex>
+
+namespace fzx
+{
+	struct PoolStats
+	{
+		//objects currently allocated
+		size_t used;
+		//objects that fit in the blocks allocated so far
+		size_t capacity;
+		size_t blockCount;
+	};
+
+	//free list allocator for one type of object
+	//memory is allocated in blocks that are never moved or released until the pool is destroyed, so pointers into the pool stay valid
+	template<typename T, size_t BLOCK_SIZE = 64>
+	class Pool
+	{
+	public:
+		Pool() = default;
+		~Pool()
+		{
+			for (auto* block : blocks)
+				::operator delete(block);
+		}
+		Pool(const Pool& other) = delete;
+		Pool& operator=(const Pool& other) = delete;
+
+		//returns uninitialised memory big enough for a T, construct into it with placement new
+		void* Allocate()
+		{
+			if (freeList == nullptr)
+				AddBlock();
+
+			Slot* slot = freeList;
+			freeList = slot->next;
+			used++;
+			return slot;
+		}
+
+		//the object should already be destructed
+		void Free(void* ptr)
+		{
+			if (ptr == nullptr)
+				return;
+
+			Slot* slot = (Slot*)ptr;
+			slot->next = freeList;
+			freeList = slot;
+			used--;
+		}
+
+		//makes sure count more objects can be allocated without adding another block
+		void Reserve(size_t count)
+		{
+			while (blocks.size() * BLOCK_SIZE < used + count)
+				AddBlock();
+		}
+
+		inline PoolStats GetStats() { return PoolStats{ used, blocks.size() * BLOCK_SIZE, blocks.size() }; }
+
+	private:
+		union Slot
+		{
+			Slot* next;
+			alignas(T) unsigned char data[sizeof(T)];
+		};
+
+		void AddBlock()
+		{
+			Slot* block = (Slot*)::operator new(sizeof(Slot) * BLOCK_SIZE);
+			blocks.push_back(block);
+
+			//linked backwards so slots are handed out in address order
+			for (size_t i = BLOCK_SIZE; i > 0; i--)
+			{
+				block[i - 1].next = freeList;
+				freeList = &block[i - 1];
+			}
+		}
+
+		std::vector<Slot*> blocks;
+		Slot* freeList = nullptr;
+		size_t used = 0;
+	};
+
+	//a pool that can be used from more than one thread at once, for things shared between physics systems (like shapes)
+	//every call takes a lock, so it's slower than Pool and shouldn't be used from anything that runs every step
+	template<typename T, size_t BLOCK_SIZE = 64>
+	class SharedPool
+	{
+	public:
+		void* Allocate()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return pool.Allocate();
+		}
+
+		void Free(void* ptr)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pool.Free(ptr);
+		}
+
+		PoolStats GetStats()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return pool.GetStats();
+		}
+
+	private:
+		Pool<T, BLOCK_SIZE> pool;
+		std::mutex mutex;
+	};
+}
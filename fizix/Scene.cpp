@@ -0,0 +1,328 @@
+#include "fzx.h"
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fzx
+{
+	//scene files are little-endian, and are used in place, so big-endian machines can't load them
+	static bool IsLittleEndian()
+	{
+		uint16_t value = 1;
+		unsigned char firstByte;
+		memcpy(&firstByte, &value, 1);
+		return firstByte == 1;
+	}
+
+	//checks a table fits inside the file, without overflowing
+	static bool TableFits(uint32_t offset, uint32_t count, size_t elementSize, size_t size)
+	{
+		return offset % 4 == 0 && offset <= size && (uint64_t)count * elementSize <= size - offset;
+	}
+
+	bool PhysicsSystem::LoadScene(const char* path)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		bool loaded = data && LoadScene(data, (size_t)size.QuadPart);
+
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return loaded;
+#else
+		int file = open(path, O_RDONLY);
+		if (file < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size == 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		//the mapping stays valid after the file is closed
+		close(file);
+		if (data == MAP_FAILED)
+			return false;
+
+		bool loaded = LoadScene(data, (size_t)info.st_size);
+		munmap(data, (size_t)info.st_size);
+		return loaded;
+#endif
+	}
+
+	bool PhysicsSystem::LoadScene(const void* data, size_t size)
+	{
+		//the tables are read in place, so the data has to be aligned like the structs are
+		if (!IsLittleEndian() || ((uintptr_t)data & 3) != 0 || size < sizeof(SceneHeader))
+			return false;
+
+		const unsigned char* bytes = (const unsigned char*)data;
+		const SceneHeader& header = *(const SceneHeader*)bytes;
+		if (header.magic != SCENE_MAGIC || header.version != SCENE_VERSION
+			|| !TableFits(header.shapeOffset, header.shapeCount, sizeof(SceneShape), size)
+			|| !TableFits(header.bodyOffset, header.bodyCount, sizeof(SceneBody), size)
+			|| !TableFits(header.colliderOffset, header.colliderCount, sizeof(SceneCollider), size)
+			|| !TableFits(header.pointOffset, header.pointCount, sizeof(float) * 2, size))
+			return false;
+
+		const SceneShape* shapes = (const SceneShape*)(bytes + header.shapeOffset);
+		const SceneBody* sceneBodies = (const SceneBody*)(bytes + header.bodyOffset);
+		const SceneCollider* colliders = (const SceneCollider*)(bytes + header.colliderOffset);
+		const float* points = (const float*)(bytes + header.pointOffset);
+
+		//check every index before anything is created, so a broken file doesn't leave half a level behind
+		for (uint32_t i = 0; i < header.shapeCount; i++)
+		{
+			const SceneShape& s = shapes[i];
+			if (s.type >= (uint32_t)SHAPE_TYPE::COUNT)
+				return false;
+			if (s.type == (uint32_t)SHAPE_TYPE::POLYGON && (s.pointCount < 3 || s.pointCount > FZX_MAX_VERTICES
+				|| s.firstPoint > header.pointCount || s.pointCount > header.pointCount - s.firstPoint))
+				return false;
+		}
+		for (uint32_t i = 0; i < header.bodyCount; i++)
+		{
+			const SceneBody& b = sceneBodies[i];
+			if (b.colliderCount > UCHAR_MAX || b.firstCollider > header.colliderCount || b.colliderCount > header.colliderCount - b.firstCollider)
+				return false;
+		}
+		for (uint32_t i = 0; i < header.colliderCount; i++)
+		{
+			if (colliders[i].shape >= header.shapeCount)
+				return false;
+		}
+
+		std::vector<Shape*> sceneShapes(header.shapeCount);
+		for (uint32_t i = 0; i < header.shapeCount; i++)
+		{
+			const SceneShape& s = shapes[i];
+			Vector2 a = Vector2(s.a[0], s.a[1]);
+			Vector2 b = Vector2(s.b[0], s.b[1]);
+			switch ((SHAPE_TYPE)s.type)
+			{
+			case SHAPE_TYPE::CIRCLE:
+				sceneShapes[i] = new CircleShape(s.radius, a);
+				break;
+			case SHAPE_TYPE::POLYGON:
+			{
+				Vector2 polygonPoints[FZX_MAX_VERTICES];
+				for (uint32_t p = 0; p < s.pointCount; p++)
+					polygonPoints[p] = Vector2(points[(s.firstPoint + p) * 2], points[(s.firstPoint + p) * 2 + 1]);
+				sceneShapes[i] = PolygonShape::Create(polygonPoints, s.pointCount);
+				break;
+			}
+			case SHAPE_TYPE::CAPSULE:
+				sceneShapes[i] = new CapsuleShape(a, b, s.radius);
+				break;
+			default:
+				sceneShapes[i] = new PlaneShape(a, (Real)s.radius);
+				break;
+			}
+		}
+
+		std::vector<ColliderDesc> colliderDescs(header.colliderCount);
+		for (uint32_t i = 0; i < header.colliderCount; i++)
+		{
+			const SceneCollider& c = colliders[i];
+			colliderDescs[i] = ColliderDesc(sceneShapes[c.shape], c.density, (c.flags & SCENE_COLLIDER_TRIGGER) != 0,
+				c.collisionLayer, c.collisionMask, Vector2(c.offset[0], c.offset[1]), c.rotation);
+		}
+
+		std::vector<BodyDesc> bodyDescs(header.bodyCount);
+		for (uint32_t i = 0; i < header.bodyCount; i++)
+		{
+			const SceneBody& b = sceneBodies[i];
+			BodyDesc& desc = bodyDescs[i];
+			desc.data = PhysicsData(Vector2(b.position[0], b.position[1]), b.rotation, (b.flags & SCENE_BODY_DYNAMIC) != 0, (b.flags & SCENE_BODY_ROTATABLE) != 0,
+				b.bounciness, b.drag, b.angularDrag, -1, b.staticFriction, b.dynamicFriction);
+			desc.data.isKinematic = (b.flags & SCENE_BODY_KINEMATIC) != 0;
+			desc.colliders = colliderDescs.data() + b.firstCollider;
+			desc.colliderCount = (unsigned char)b.colliderCount;
+		}
+
+		CreateBodies(bodyDescs.data(), bodyDescs.size());
+
+		//shapes that no collider used would never be released otherwise
+		for (Shape* shape : sceneShapes)
+		{
+			if (shape->GetRefCount() == 0)
+				delete shape;
+		}
+		return true;
+	}
+
+	template<typename T>
+	static void WriteTable(std::vector<unsigned char>& out, uint32_t offset, const std::vector<T>& table)
+	{
+		if (!table.empty())
+			memcpy(&out[offset], table.data(), table.size() * sizeof(T));
+	}
+
+	bool PhysicsSystem::SaveScene(const char* path)
+	{
+		if (!IsLittleEndian())
+			return false;
+
+		std::vector<SceneShape> shapes;
+		std::vector<SceneBody> sceneBodies;
+		std::vector<SceneCollider> colliders;
+		std::vector<float> points;
+		//shapes shared between colliders are only written once
+		std::unordered_map<Shape*, uint32_t> shapeIndices;
+
+		sceneBodies.reserve(bodies.size());
+		for (PhysicsObject* body : bodies)
+		{
+			SceneBody b;
+			memset(&b, 0, sizeof(b));
+			b.position[0] = (float)body->transform.position.x;
+			b.position[1] = (float)body->transform.position.y;
+			b.rotation = (float)body->transform.rotation;
+			b.bounciness = (float)body->bounciness;
+			b.drag = (float)body->drag;
+			b.angularDrag = (float)body->angularDrag;
+			b.staticFriction = (float)body->staticFriction;
+			b.dynamicFriction = (float)body->dynamicFriction;
+			b.flags = (body->isDynamic ? (uint32_t)SCENE_BODY_DYNAMIC : 0u) | (body->isRotatable ? (uint32_t)SCENE_BODY_ROTATABLE : 0u) | (body->isKinematic ? (uint32_t)SCENE_BODY_KINEMATIC : 0u);
+			b.firstCollider = (uint32_t)colliders.size();
+			b.colliderCount = body->colliderCount;
+			sceneBodies.push_back(b);
+
+			for (unsigned char i = 0; i < body->colliderCount; i++)
+			{
+				Collider& collider = body->colliders[i];
+				Shape* shape = collider.shape;
+
+				auto found = shapeIndices.find(shape);
+				uint32_t shapeIndex;
+				if (found != shapeIndices.end())
+					shapeIndex = found->second;
+				else
+				{
+					shapeIndex = (uint32_t)shapes.size();
+					shapeIndices[shape] = shapeIndex;
+
+					SceneShape s;
+					memset(&s, 0, sizeof(s));
+					s.type = (uint32_t)collider.shapeType;
+					switch (collider.shapeType)
+					{
+					case SHAPE_TYPE::CIRCLE:
+					{
+						CircleShape* circle = (CircleShape*)shape;
+						s.radius = (float)circle->radius;
+						s.a[0] = (float)circle->centrePoint.x;
+						s.a[1] = (float)circle->centrePoint.y;
+						break;
+					}
+					case SHAPE_TYPE::POLYGON:
+					{
+						PolygonShape* polygon = (PolygonShape*)shape;
+						s.firstPoint = (uint32_t)(points.size() / 2);
+						s.pointCount = polygon->pointCount;
+						for (int p = 0; p < polygon->pointCount; p++)
+						{
+							points.push_back((float)polygon->points[p].x);
+							points.push_back((float)polygon->points[p].y);
+						}
+						break;
+					}
+					case SHAPE_TYPE::CAPSULE:
+					{
+						CapsuleShape* capsule = (CapsuleShape*)shape;
+						s.radius = (float)capsule->radius;
+						s.a[0] = (float)capsule->pointA.x;
+						s.a[1] = (float)capsule->pointA.y;
+						s.b[0] = (float)capsule->pointB.x;
+						s.b[1] = (float)capsule->pointB.y;
+						break;
+					}
+					default:
+					{
+						PlaneShape* plane = (PlaneShape*)shape;
+						s.radius = (float)plane->distance;
+						s.a[0] = (float)plane->normal.x;
+						s.a[1] = (float)plane->normal.y;
+						break;
+					}
+					}
+					shapes.push_back(s);
+				}
+
+				SceneCollider c;
+				memset(&c, 0, sizeof(c));
+				c.shape = shapeIndex;
+				c.density = (float)collider.density;
+				c.offset[0] = (float)collider.localTransform.position.x;
+				c.offset[1] = (float)collider.localTransform.position.y;
+				c.rotation = (float)collider.localTransform.rotation;
+				c.collisionLayer = collider.collisionLayer;
+				c.collisionMask = collider.collisionMask;
+				c.flags = collider.isTrigger ? (uint32_t)SCENE_COLLIDER_TRIGGER : 0u;
+				colliders.push_back(c);
+			}
+		}
+
+		SceneHeader header;
+		header.magic = SCENE_MAGIC;
+		header.version = SCENE_VERSION;
+		header.shapeCount = (uint32_t)shapes.size();
+		header.bodyCount = (uint32_t)sceneBodies.size();
+		header.colliderCount = (uint32_t)colliders.size();
+		header.pointCount = (uint32_t)(points.size() / 2);
+		//every struct is a multiple of 4 bytes, so the tables stay aligned one after another
+		header.shapeOffset = sizeof(SceneHeader);
+		header.bodyOffset = header.shapeOffset + header.shapeCount * sizeof(SceneShape);
+		header.colliderOffset = header.bodyOffset + header.bodyCount * sizeof(SceneBody);
+		header.pointOffset = header.colliderOffset + header.colliderCount * sizeof(SceneCollider);
+
+		std::vector<unsigned char> out(header.pointOffset + points.size() * sizeof(float));
+		memcpy(out.data(), &header, sizeof(header));
+		WriteTable(out, header.shapeOffset, shapes);
+		WriteTable(out, header.bodyOffset, sceneBodies);
+		WriteTable(out, header.colliderOffset, colliders);
+		WriteTable(out, header.pointOffset, points);
+
+		//fopen counts as unsafe with SDL checks on
+#ifdef _WIN32
+		FILE* file = nullptr;
+		if (fopen_s(&file, path, "wb") != 0)
+			file = nullptr;
+#else
+		FILE* file = fopen(path, "wb");
+#endif
+		if (!file)
+			return false;
+		bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+		return fclose(file) == 0 && written;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+
+namespace fzx
+{
+	//flat binary level format, loaded with PhysicsSystem::LoadScene
+	//every struct here has a fixed size and layout, and the whole file is little-endian with 32 bit floats,
+	//so it can be used straight from a memory mapped file without parsing anything
+	//
+	//layout: SceneHeader, then each table at the offset the header gives (all 4 byte aligned)
+
+	//"FZXL"
+	constexpr uint32_t SCENE_MAGIC = 0x4C585A46;
+	//bump this whenever a struct below changes
+	constexpr uint32_t SCENE_VERSION = 1;
+
+	struct SceneHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t shapeCount;
+		uint32_t bodyCount;
+		uint32_t colliderCount;
+		uint32_t pointCount;
+		//byte offsets of each table from the start of the file
+		uint32_t shapeOffset;
+		uint32_t bodyOffset;
+		uint32_t colliderOffset;
+		uint32_t pointOffset;
+	};
+
+	//one shape, shared by every collider that uses its index
+	struct SceneShape
+	{
+		//same values as SHAPE_TYPE
+		uint32_t type;
+		//polygons use points [firstPoint, firstPoint + pointCount) from the point table
+		uint32_t firstPoint;
+		uint32_t pointCount;
+		//circle: radius, centre in a
+		//capsule: radius, ends in a and b
+		//plane: distance in radius, normal in a
+		float radius;
+		float a[2];
+		float b[2];
+	};
+
+	enum SCENE_BODY_FLAGS : uint32_t
+	{
+		SCENE_BODY_DYNAMIC = 1,
+		SCENE_BODY_ROTATABLE = 2,
+		SCENE_BODY_KINEMATIC = 4
+	};
+
+	struct SceneBody
+	{
+		float position[2];
+		float rotation;
+		float bounciness;
+		float drag;
+		float angularDrag;
+		float staticFriction;
+		float dynamicFriction;
+		uint32_t flags;
+		//uses colliders [firstCollider, firstCollider + colliderCount) from the collider table
+		uint32_t firstCollider;
+		uint32_t colliderCount;
+	};
+
+	enum SCENE_COLLIDER_FLAGS : uint32_t
+	{
+		SCENE_COLLIDER_TRIGGER = 1
+	};
+
+	struct SceneCollider
+	{
+		uint32_t shape;
+		float density;
+		float offset[2];
+		float rotation;
+		uint16_t collisionLayer;
+		uint16_t collisionMask;
+		uint32_t flags;
+	};
+
+	static_assert(sizeof(SceneHeader) == 40 && sizeof(SceneShape) == 32 && sizeof(SceneBody) == 44 && sizeof(SceneCollider) == 28,
+		"scene structs must have the same layout on every compiler");
+}
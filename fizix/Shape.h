@@ -1,10 +1,16 @@
 #pragma once
 #include "Maths.h"
+#include "Pool.h"
+#include <atomic>
 
+//the most points a polygon can have. polygons are stored in tiers with room for 4, 8 or 16 points (and one with room for
+//FZX_MAX_VERTICES if that's more than 16), and each polygon uses the smallest tier it fits in, so a triangle isn't as big as an octagon
 #ifndef FZX_MAX_VERTICES
 #define FZX_MAX_VERTICES 8
 #endif // !FZX_MAX_VERTICES
 
+static_assert(FZX_MAX_VERTICES >= 3 && FZX_MAX_VERTICES <= 255, "FZX_MAX_VERTICES must be between 3 and 255");
+
 namespace fzx
 {
 	class Transform;
@@ -36,21 +42,43 @@ namespace fzx
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	// BASE CLASS
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+	//threading: shapes can be created, shared and released from any thread, including by physics systems being updated on
+	//different threads at the same time. the shape pools are locked and the reference count is atomic, so that's all safe.
+	//the shape itself isn't locked though, so a shape must not be changed while anything else could be reading it
 	class Shape
 	{
 	public:
 		virtual bool PointCast(Vector2 point, Transform& transform) = 0;
-		virtual void CalculateMass(float& mass, float& inertia, float density) = 0;
+		virtual void CalculateMass(Real& mass, Real& inertia, Real density) = 0;
 		virtual Vector2 GetCentrePoint() = 0;
+		//radius of a circle around GetCentrePoint() that holds the whole shape (infinite for planes)
+		virtual Real GetBoundingRadius() = 0;
 		virtual AABB CalculateAABB(Transform& transform) = 0;
 		virtual SHAPE_TYPE GetType() = 0;
 		virtual Shape* Clone() = 0;
 		virtual Vector2 Support(Vector2 v, Transform& transform) = 0;
+		//direction must be normalised. rays that start inside the shape don't hit it
+		virtual bool RayCast(Vector2 origin, Vector2 direction, Real maxDistance, Transform& transform, Real& distance, Vector2& normal) = 0;
+
+		//shapes are reference counted by the colliders using them, so one shape can be shared between lots of colliders and bodies
+		//a shape that is being shared shouldn't be changed, Clone() it and change the clone instead
+		inline void AddRef() { refCount.fetch_add(1, std::memory_order_relaxed); }
+		//deletes the shape once nothing is using it anymore
+		inline void Release() { if (refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this; }
+		inline unsigned int GetRefCount() { return refCount.load(std::memory_order_relaxed); }
+
+		Shape() = default;
+		//clones start off unused
+		Shape(const Shape&) : refCount(0) {}
+		Shape& operator=(const Shape&) { return *this; }
 
 		virtual ~Shape() = default;
 	private:
 		friend PhysicsSystem;
 
+		std::atomic<unsigned int> refCount{ 0 };
+
 	};
 
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -60,57 +88,118 @@ namespace fzx
 	class PolygonShape : public Shape
 	{
 	public:
-
-		PolygonShape(Vector2* vertices, int vertexCount);
+		//makes the convex hull of the vertices, in the smallest tier it fits in. polygons can only be made through this
+		static PolygonShape* Create(Vector2* vertices, int vertexCount);
 
 		bool PointCast(Vector2 point, Transform& transform);
-		void CalculateMass(float& mass, float& inertia, float density);
+		void CalculateMass(Real& mass, Real& inertia, Real density);
 		Vector2 GetCentrePoint();
+		Real GetBoundingRadius();
 		AABB CalculateAABB(Transform& transform);
 		SHAPE_TYPE GetType();
-		Shape* Clone();
 		Vector2 Support(Vector2 v, Transform& transform);
-
-		static PolygonShape* GetRegularPolygonCollider(float radius, int pointCount);
-		Vector2 points[FZX_MAX_VERTICES];
-		//Vector2 normals[max_vertices];
-		char pointCount;
+		bool RayCast(Vector2 origin, Vector2 direction, Real maxDistance, Transform& transform, Real& distance, Vector2& normal);
+
+		static PolygonShape* GetRegularPolygonCollider(Real radius, int pointCount);
+		//index of the point furthest along v, in local space
+		int GetSupportIndex(Vector2 v);
+		//the same, for a polygon in the tier with room for CAPACITY points. every slot is checked (the spare ones repeat points[0]), so the
+		//loop has a fixed length the compiler can unroll. 0 is for any capacity that isn't 4, 8 or 16, and only checks pointCount points
+		template<int CAPACITY>
+		int GetSupportIndex(Vector2 v);
+
+		//the points should not be changed after construction, everything below is calculated from them once
+		//both point into the tier's storage, which has room for capacity of each. the slots after pointCount repeat the first point and normal
+		Vector2* points;
+		//normals[i] is the outward normal of the edge from points[i] to points[i + 1]
+		Vector2* normals;
 		Vector2 centrePoint;
+		Real area;
+		//about the shape's origin, for a density of 1
+		Real unitInertia;
+		//distance from the centrepoint to the furthest point
+		Real boundingRadius;
+		unsigned char pointCount;
+		//4, 8, 16 or FZX_MAX_VERTICES
+		unsigned char capacity;
+
+		virtual ~PolygonShape() = default;
+
+		//every tier is allocated from its own locked pool, shared by all physics systems. these are the tiers added together
+		static PoolStats GetPoolStats();
 
-		~PolygonShape() = default;
+	protected:
+		PolygonShape(Vector2* pointStorage, Vector2* normalStorage, int capacity);
+		//the copy still points at the original's storage, the tier has to point it at its own
+		PolygonShape(const PolygonShape&) = default;
+
+		//copies the hull in, calculates the geometry from it and fills the spare slots
+		void SetPoints(const Vector2* hull, int hullCount);
 
 	private:
 		friend PhysicsSystem;
-		//void CalculateNormals();
-		void CalculateCentrePoint();
+		void CalculateGeometry();
+		//writes the convex hull of the points to hull (which needs room for FZX_MAX_VERTICES) and returns how many points it has
 		//clip points clips the points if they go over the max vertex count, instead of throwing an error
-		bool OrganisePoints(Vector2* points, int pointCount, bool clipPoints = true);
-
+		static int OrganisePoints(Vector2* points, int pointCount, Vector2* hull, bool clipPoints = true);
+		int HillClimbSupportIndex(Vector2 v);
 
+		//below this, checking every point is as fast or faster than hill climbing (they're about even from 12 to 20 points, hill climbing
+		//is ~1.5x faster at 32 and ~2x at 64). only the FZX_MAX_VERTICES tier can hold this many, so with the default of 8 it never happens
+		static constexpr int HILL_CLIMB_MIN_POINTS = 24;
 	};
 
+	template<int CAPACITY>
+	inline int PolygonShape::GetSupportIndex(Vector2 v)
+	{
+		if (CAPACITY == 0 && pointCount >= HILL_CLIMB_MIN_POINTS)
+			return HillClimbSupportIndex(v);
+
+		//the repeated points in the spare slots are never further than points[0], so they can't be picked
+		const int count = CAPACITY != 0 ? CAPACITY : pointCount;
+		int index = 0;
+		Real d = glm::dot(v, points[0]);
+		for (int i = 1; i < count; i++)
+		{
+			Real d1 = glm::dot(v, points[i]);
+			if (d1 > d)
+			{
+				index = i;
+				d = d1;
+			}
+		}
+		return index;
+	}
+
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	// CIRCLE CLASS
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-	class CircleShape : public Shape
+	class CircleShape final : public Shape
 	{
 	public:
-		CircleShape(float radius, Vector2 centrePoint);
+		CircleShape(Real radius, Vector2 centrePoint);
 
 		bool PointCast(Vector2 point, Transform& transform);
-		void CalculateMass(float& mass, float& inertia, float density);
+		void CalculateMass(Real& mass, Real& inertia, Real density);
 		Vector2 GetCentrePoint();
+		Real GetBoundingRadius();
 		AABB CalculateAABB(Transform& transform);
 		SHAPE_TYPE GetType();
 		Shape* Clone();
 		Vector2 Support(Vector2 v, Transform& transform);
+		bool RayCast(Vector2 origin, Vector2 direction, Real maxDistance, Transform& transform, Real& distance, Vector2& normal);
 
-		float radius;
+		Real radius;
 		Vector2 centrePoint;
 
 		~CircleShape() = default;
 
+		//every shape of this type is allocated from one locked pool, shared by all physics systems
+		static void* operator new(size_t size);
+		static void operator delete(void* ptr);
+		static PoolStats GetPoolStats();
+
 	private:
 		friend PhysicsSystem;
 
@@ -120,26 +209,33 @@ namespace fzx
 	// STADIUM CLASS
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-	class CapsuleShape : public Shape
+	class CapsuleShape final : public Shape
 	{
 	public:
 
-		CapsuleShape(Vector2 a, Vector2 b, float radius = 0.01f);
+		CapsuleShape(Vector2 a, Vector2 b, Real radius = 0.01f);
 
 		bool PointCast(Vector2 point, Transform& transform);
-		void CalculateMass(float& mass, float& inertia, float density); // change to 
+		void CalculateMass(Real& mass, Real& inertia, Real density); // change to 
 		AABB CalculateAABB(Transform& transform);
 		Vector2 GetCentrePoint();
+		Real GetBoundingRadius();
 		SHAPE_TYPE GetType();
 		Shape* Clone();
 		Vector2 Support(Vector2 v, Transform& transform);
+		bool RayCast(Vector2 origin, Vector2 direction, Real maxDistance, Transform& transform, Real& distance, Vector2& normal);
 
-		float radius;
+		Real radius;
 		Vector2 pointA;
 		Vector2 pointB;
 
 		~CapsuleShape() = default;
 
+		//every shape of this type is allocated from one locked pool, shared by all physics systems
+		static void* operator new(size_t size);
+		static void operator delete(void* ptr);
+		static PoolStats GetPoolStats();
+
 	private:
 		friend PhysicsSystem;
 
@@ -149,25 +245,32 @@ namespace fzx
 	// PLANE CLASS
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-	class PlaneShape : public Shape
+	class PlaneShape final : public Shape
 	{
 	public:
-		PlaneShape(Vector2 normal, float d);
+		PlaneShape(Vector2 normal, Real d);
 		PlaneShape(Vector2 normal, Vector2 startPosition);
 		PlaneShape(Vector2 pointA, Vector2 pointB, void* null);
 
 		bool PointCast(Vector2 point, Transform& transform);
-		void CalculateMass(float& mass, float& inertia, float density);
+		void CalculateMass(Real& mass, Real& inertia, Real density);
 		Vector2 GetCentrePoint();
+		Real GetBoundingRadius();
 		AABB CalculateAABB(Transform& transform);
 		SHAPE_TYPE GetType();
 		Shape* Clone();
 		Vector2 Support(Vector2 v, Transform& transform);
+		bool RayCast(Vector2 origin, Vector2 direction, Real maxDistance, Transform& transform, Real& distance, Vector2& normal);
 
 		Vector2 normal;
-		float distance;
+		Real distance;
 
 		~PlaneShape() = default;
+
+		//every shape of this type is allocated from one locked pool, shared by all physics systems
+		static void* operator new(size_t size);
+		static void operator delete(void* ptr);
+		static PoolStats GetPoolStats();
 	private:
 		friend PhysicsSystem;
 	};
@@ -0,0 +1,590 @@
+#include "fzx.h"
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <type_traits>
+
+namespace fzx
+{
+	//"FZXS"
+	static const unsigned int SNAPSHOT_MAGIC = 0x53585A46;
+	static const unsigned short SNAPSHOT_VERSION = 5;
+
+	//everything is written as raw bytes in the machine's layout, so snapshots are only meant to be restored by the same build
+	struct SnapshotHeader
+	{
+		unsigned int magic;
+		unsigned short version;
+		unsigned short realSize;
+		unsigned int nextBodyID;
+		unsigned int bodyCount;
+		unsigned int contactCount;
+		unsigned int triggerCount;
+		unsigned int nextJointID;
+		unsigned int jointCount;
+		Vector2 gravity;
+		Real deltaTime;
+	};
+
+	struct SnapshotBody
+	{
+		unsigned int id;
+		Vector2 position;
+		Real rotation;
+		Vector2 velocity;
+		Real angularVelocity;
+		Vector2 force;
+		Real torque;
+		Real bounciness;
+		Real drag;
+		Real angularDrag;
+		Real iMass;
+		Real iInertia;
+		Real staticFriction;
+		Real dynamicFriction;
+		Real sleepTime;
+		Vector2 sleepPosition;
+		Real sleepRotation;
+		bool isDynamic;
+		bool isRotatable;
+		bool isKinematic;
+		bool isAwake;
+		unsigned char colliderCount;
+		//size of the colliders written after this body, so they can be compared or skipped in one go
+		unsigned int colliderBytes;
+	};
+
+	struct SnapshotCollider
+	{
+		SHAPE_TYPE shapeType;
+		bool isTrigger;
+		unsigned short collisionLayer;
+		unsigned short collisionMask;
+		Real density;
+		Vector2 offset;
+		Real rotation;
+	};
+
+	//contacts and triggers point at bodies by their index in the snapshot
+	struct SnapshotContact
+	{
+		unsigned int bodyA;
+		unsigned int bodyB;
+		unsigned char colliderIndexA;
+		unsigned char colliderIndexB;
+		CONTACT_EVENT_TYPE type;
+		Vector2 point;
+		Vector2 normal;
+		Real penetration;
+	};
+
+	struct SnapshotTrigger
+	{
+		unsigned int bodyA;
+		unsigned int bodyB;
+		unsigned char colliderIndexA;
+		unsigned char colliderIndexB;
+		TRIGGER_EVENT_TYPE type;
+	};
+
+	//written before the joint's own bytes. bodies are indices in the snapshot like contacts, and b is UINT_MAX for the world
+	struct SnapshotJoint
+	{
+		unsigned int id;
+		unsigned int bodyA;
+		unsigned int bodyB;
+	};
+	//joints are copied as they are (with their warm starting impulses, but not their pointers), then pointed at the restored bodies
+	static_assert(std::is_trivially_copyable<Joint>::value, "joints are written straight to snapshots");
+
+	//the most bytes one collider can take up, so space can be reserved up front instead of checking every write
+	static const size_t MAX_COLLIDER_BYTES = sizeof(SnapshotCollider) + 1 + sizeof(Vector2) * FZX_MAX_VERTICES;
+
+	//writes into a vector without resizing it for every value. Reserve has to be called with enough space before writing
+	struct SnapshotWriter
+	{
+		std::vector<unsigned char>& out;
+		size_t size;
+
+		SnapshotWriter(std::vector<unsigned char>& out) : out(out), size(0) {}
+
+		void Reserve(size_t bytes)
+		{
+			if (out.size() < size + bytes)
+				out.resize(std::max(size + bytes, out.size() * 2));
+		}
+
+		template<typename T>
+		void Write(const T& value)
+		{
+			memcpy(&out[size], &value, sizeof(T));
+			size += sizeof(T);
+		}
+	};
+
+	template<typename T>
+	static bool Read(const unsigned char* data, size_t size, size_t& offset, T& value)
+	{
+		if (size - offset < sizeof(T))
+			return false;
+		memcpy(&value, data + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	static void WriteColliders(SnapshotWriter& out, PhysicsObject* body)
+	{
+		out.Reserve(body->GetColliderCount() * MAX_COLLIDER_BYTES);
+		for (unsigned char i = 0; i < body->GetColliderCount(); i++)
+		{
+			Collider& collider = body->GetCollider(i);
+			SnapshotCollider c;
+			//zero it so padding bytes are always the same, since colliders are compared with memcmp
+			memset(&c, 0, sizeof(c));
+			c.shapeType = collider.GetShapeType();
+			c.isTrigger = collider.GetIsTrigger();
+			c.collisionLayer = collider.GetCollisionLayer();
+			c.collisionMask = collider.GetCollisionMask();
+			c.density = collider.GetDensity();
+			c.offset = collider.GetLocalTransform().position;
+			c.rotation = collider.GetLocalTransform().rotation;
+			out.Write(c);
+
+			Shape* shape = collider.GetShape();
+			switch (c.shapeType)
+			{
+			case SHAPE_TYPE::CIRCLE:
+				out.Write(((CircleShape*)shape)->radius);
+				out.Write(((CircleShape*)shape)->centrePoint);
+				break;
+			case SHAPE_TYPE::POLYGON:
+			{
+				PolygonShape* polygon = (PolygonShape*)shape;
+				out.Write(polygon->pointCount);
+				for (int p = 0; p < polygon->pointCount; p++)
+					out.Write(polygon->points[p]);
+				break;
+			}
+			case SHAPE_TYPE::CAPSULE:
+				out.Write(((CapsuleShape*)shape)->pointA);
+				out.Write(((CapsuleShape*)shape)->pointB);
+				out.Write(((CapsuleShape*)shape)->radius);
+				break;
+			case SHAPE_TYPE::PLANE:
+				out.Write(((PlaneShape*)shape)->normal);
+				out.Write(((PlaneShape*)shape)->distance);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	//makes a new shape from the bytes written by WriteColliders, or returns nullptr if they're broken
+	static Shape* ReadShape(SHAPE_TYPE type, const unsigned char* data, size_t size, size_t& offset)
+	{
+		switch (type)
+		{
+		case SHAPE_TYPE::CIRCLE:
+		{
+			Real radius;
+			Vector2 centrePoint;
+			if (!Read(data, size, offset, radius) || !Read(data, size, offset, centrePoint))
+				return nullptr;
+			return new CircleShape(radius, centrePoint);
+		}
+		case SHAPE_TYPE::POLYGON:
+		{
+			unsigned char pointCount;
+			Vector2 points[FZX_MAX_VERTICES];
+			if (!Read(data, size, offset, pointCount) || pointCount < 3 || pointCount > FZX_MAX_VERTICES)
+				return nullptr;
+			for (int p = 0; p < pointCount; p++)
+			{
+				if (!Read(data, size, offset, points[p]))
+					return nullptr;
+			}
+			return PolygonShape::Create(points, pointCount);
+		}
+		case SHAPE_TYPE::CAPSULE:
+		{
+			Vector2 a, b;
+			Real radius;
+			if (!Read(data, size, offset, a) || !Read(data, size, offset, b) || !Read(data, size, offset, radius))
+				return nullptr;
+			return new CapsuleShape(a, b, radius);
+		}
+		case SHAPE_TYPE::PLANE:
+		{
+			Vector2 normal;
+			Real distance;
+			if (!Read(data, size, offset, normal) || !Read(data, size, offset, distance))
+				return nullptr;
+			return new PlaneShape(normal, distance);
+		}
+		default:
+			return nullptr;
+		}
+	}
+
+	void PhysicsSystem::SaveSnapshot(std::vector<unsigned char>& snapshot)
+	{
+		SnapshotWriter out(snapshot);
+		out.Reserve(sizeof(SnapshotHeader) + bodies.size() * sizeof(SnapshotBody) + lastContacts.size() * sizeof(SnapshotContact) + triggerOverlaps.size() * sizeof(SnapshotTrigger));
+
+		SnapshotHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = SNAPSHOT_MAGIC;
+		header.version = SNAPSHOT_VERSION;
+		header.realSize = sizeof(Real);
+		header.nextBodyID = nextBodyID;
+		header.bodyCount = (unsigned int)bodies.size();
+		header.contactCount = (unsigned int)lastContacts.size();
+		header.triggerCount = (unsigned int)triggerOverlaps.size();
+		header.nextJointID = nextJointID;
+		header.jointCount = (unsigned int)joints.size();
+		header.gravity = gravity;
+		header.deltaTime = deltaTime;
+		out.Write(header);
+
+		for (size_t i = 0; i < bodies.size(); i++)
+		{
+			PhysicsObject* body = bodies[i];
+			out.Reserve(sizeof(SnapshotBody));
+			size_t bodyOffset = out.size;
+
+			SnapshotBody b;
+			memset(&b, 0, sizeof(b));
+			b.id = body->id;
+			b.position = body->transform.position;
+			b.rotation = body->transform.rotation;
+			b.velocity = body->velocity;
+			b.angularVelocity = body->angularVelocity;
+			b.force = body->force;
+			b.torque = body->torque;
+			b.bounciness = body->bounciness;
+			b.drag = body->drag;
+			b.angularDrag = body->angularDrag;
+			b.iMass = body->iMass;
+			b.iInertia = body->iInertia;
+			b.staticFriction = body->staticFriction;
+			b.dynamicFriction = body->dynamicFriction;
+			b.sleepTime = body->sleepTime;
+			b.sleepPosition = body->sleepPosition;
+			b.sleepRotation = body->sleepRotation;
+			b.isDynamic = body->isDynamic;
+			b.isRotatable = body->isRotatable;
+			b.isKinematic = body->isKinematic;
+			b.isAwake = body->isAwake;
+			b.colliderCount = body->colliderCount;
+			out.Write(b);
+
+			size_t collidersOffset = out.size;
+			WriteColliders(out, body);
+			b.colliderBytes = (unsigned int)(out.size - collidersOffset);
+			memcpy(&snapshot[bodyOffset], &b, sizeof(b));
+		}
+
+		//contacts and triggers store the index of their bodies, found by binary searching (id, index) pairs
+		snapshotIndices.resize(bodies.size());
+		for (size_t i = 0; i < bodies.size(); i++)
+			snapshotIndices[i] = std::make_pair(bodies[i]->id, (unsigned int)i);
+		std::sort(snapshotIndices.begin(), snapshotIndices.end());
+		auto findIndex = [this](PhysicsObject* body)
+		{
+			return std::lower_bound(snapshotIndices.begin(), snapshotIndices.end(), std::make_pair(body->id, 0u))->second;
+		};
+
+		out.Reserve(lastContacts.size() * sizeof(SnapshotContact) + triggerOverlaps.size() * sizeof(SnapshotTrigger));
+		for (auto& e : lastContacts)
+		{
+			SnapshotContact c;
+			memset(&c, 0, sizeof(c));
+			c.bodyA = findIndex(e.a);
+			c.bodyB = findIndex(e.b);
+			c.colliderIndexA = e.colliderIndexA;
+			c.colliderIndexB = e.colliderIndexB;
+			c.type = e.type;
+			c.point = e.point;
+			c.normal = e.normal;
+			c.penetration = e.penetration;
+			out.Write(c);
+		}
+
+		for (auto& e : triggerOverlaps)
+		{
+			SnapshotTrigger t;
+			memset(&t, 0, sizeof(t));
+			t.bodyA = findIndex(e.a);
+			t.bodyB = findIndex(e.b);
+			t.colliderIndexA = e.colliderIndexA;
+			t.colliderIndexB = e.colliderIndexB;
+			t.type = e.type;
+			out.Write(t);
+		}
+
+		out.Reserve(joints.size() * (sizeof(SnapshotJoint) + sizeof(Joint)));
+		for (auto* joint : joints)
+		{
+			SnapshotJoint j;
+			j.id = joint->id;
+			j.bodyA = findIndex(joint->a);
+			j.bodyB = joint->b ? findIndex(joint->b) : UINT_MAX;
+			out.Write(j);
+			//pointers would be meaningless to whatever restores the snapshot (especially another process), so they're left out
+			Joint copy = *joint;
+			copy.a = nullptr;
+			copy.b = nullptr;
+			copy.pointer = nullptr;
+			out.Write(copy);
+		}
+		snapshot.resize(out.size);
+	}
+
+	bool PhysicsSystem::RestoreSnapshot(const unsigned char* snapshot, size_t size)
+	{
+		size_t offset = 0;
+		SnapshotHeader header;
+		if (!Read(snapshot, size, offset, header) || header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION || header.realSize != sizeof(Real))
+			return false;
+
+		//the restored bodies' contacts replace the current ones, so there's nothing to wake for static bodies moved before restoring
+		for (auto* body : movedStaticBodies)
+			body->staticMoved = false;
+		movedStaticBodies.clear();
+
+		//set once a body is claimed by the snapshot, so whatever is left over afterwards gets deleted
+		snapshotClaimed.assign(bodies.size(), false);
+		//(id, index) of every body that exists now. only sorted if a body isn't where it was when the snapshot was saved
+		snapshotIndices.clear();
+
+		std::vector<PhysicsObject*>& restored = snapshotBodies;
+		restored.clear();
+		restored.reserve(header.bodyCount);
+		bool valid = true;
+
+		for (unsigned int i = 0; i < header.bodyCount && valid; i++)
+		{
+			SnapshotBody b;
+			if (!Read(snapshot, size, offset, b) || size - offset < b.colliderBytes)
+			{
+				valid = false;
+				break;
+			}
+			const unsigned char* colliderData = snapshot + offset;
+			offset += b.colliderBytes;
+
+			//usually nothing has been added or removed, so the body is at the same index
+			size_t index = bodies.size();
+			if (i < bodies.size() && bodies[i]->id == b.id)
+				index = i;
+			else
+			{
+				if (snapshotIndices.empty())
+				{
+					for (size_t j = 0; j < bodies.size(); j++)
+						snapshotIndices.push_back(std::make_pair(bodies[j]->id, (unsigned int)j));
+					std::sort(snapshotIndices.begin(), snapshotIndices.end());
+				}
+				auto it = std::lower_bound(snapshotIndices.begin(), snapshotIndices.end(), std::make_pair(b.id, 0u));
+				if (it != snapshotIndices.end() && it->first == b.id)
+					index = it->second;
+			}
+
+			PhysicsObject* body = nullptr;
+			if (index < bodies.size() && !snapshotClaimed[index])
+			{
+				body = bodies[index];
+				snapshotClaimed[index] = true;
+			}
+
+			//a body that still exists keeps its colliders if they haven't changed, which is almost always the case for rollback
+			bool collidersMatch = false;
+			if (body && body->colliderCount == b.colliderCount)
+			{
+				SnapshotWriter scratch(snapshotScratch);
+				WriteColliders(scratch, body);
+				collidersMatch = scratch.size == b.colliderBytes && memcmp(snapshotScratch.data(), colliderData, b.colliderBytes) == 0;
+			}
+
+			if (!body)
+			{
+				PhysicsData data;
+				body = new (bodyPool.Allocate()) PhysicsObject(data);
+				body->id = b.id;
+				body->system = this;
+			}
+
+			if (!collidersMatch)
+			{
+				body->ClearColliders();
+				size_t colliderOffset = 0;
+				for (unsigned char c = 0; c < b.colliderCount; c++)
+				{
+					SnapshotCollider sc;
+					Shape* shape = nullptr;
+					if (Read(colliderData, b.colliderBytes, colliderOffset, sc))
+						shape = ReadShape(sc.shapeType, colliderData, b.colliderBytes, colliderOffset);
+					if (!shape)
+					{
+						valid = false;
+						break;
+					}
+
+					ColliderDesc desc(shape, sc.density, sc.isTrigger, sc.collisionLayer, sc.collisionMask, sc.offset, sc.rotation);
+					body->AddColliders(&desc, 1, false);
+				}
+			}
+
+			body->transform.position = b.position;
+			body->transform.rotation = b.rotation;
+			body->transform.UpdateData();
+			body->velocity = b.velocity;
+			body->angularVelocity = b.angularVelocity;
+			body->force = b.force;
+			body->torque = b.torque;
+			body->bounciness = b.bounciness;
+			body->drag = b.drag;
+			body->angularDrag = b.angularDrag;
+			body->iMass = b.iMass;
+			body->iInertia = b.iInertia;
+			body->staticFriction = b.staticFriction;
+			body->dynamicFriction = b.dynamicFriction;
+			body->isDynamic = b.isDynamic;
+			body->isRotatable = b.isRotatable;
+			body->isKinematic = b.isKinematic;
+			//after the colliders, since adding them wakes the body up
+			body->isAwake = b.isAwake;
+			body->sleepTime = b.sleepTime;
+			body->sleepPosition = b.sleepPosition;
+			body->sleepRotation = b.sleepRotation;
+			restored.push_back(body);
+		}
+
+		//bodies that weren't in the snapshot are deleted
+		for (size_t i = 0; i < bodies.size(); i++)
+		{
+			if (!snapshotClaimed[i])
+				DestroyBody(bodies[i]);
+		}
+		bodies.swap(restored);
+		broadphase.Clear();
+		movingBodies.clear();
+		kinematicBodies.clear();
+		staticBodies.clear();
+		bodyListsDirty = true;
+		broadphaseDirty = true;
+
+		nextBodyID = header.nextBodyID;
+		gravity = header.gravity;
+		deltaTime = header.deltaTime;
+
+		//the events from the last Update() don't belong to this state
+		contactEvents.clear();
+		triggerEvents.clear();
+		lastContacts.clear();
+		triggerOverlaps.clear();
+
+		for (unsigned int i = 0; i < header.contactCount && valid; i++)
+		{
+			SnapshotContact c;
+			if (!Read(snapshot, size, offset, c) || c.bodyA >= bodies.size() || c.bodyB >= bodies.size())
+			{
+				valid = false;
+				break;
+			}
+			ContactEvent e;
+			e.a = bodies[c.bodyA];
+			e.b = bodies[c.bodyB];
+			e.colliderIndexA = c.colliderIndexA;
+			e.colliderIndexB = c.colliderIndexB;
+			e.type = c.type;
+			e.point = c.point;
+			e.normal = c.normal;
+			e.penetration = c.penetration;
+			lastContacts.push_back(e);
+		}
+
+		for (unsigned int i = 0; i < header.triggerCount && valid; i++)
+		{
+			SnapshotTrigger t;
+			if (!Read(snapshot, size, offset, t) || t.bodyA >= bodies.size() || t.bodyB >= bodies.size())
+			{
+				valid = false;
+				break;
+			}
+			TriggerEvent e;
+			e.a = bodies[t.bodyA];
+			e.b = bodies[t.bodyB];
+			e.colliderIndexA = t.colliderIndexA;
+			e.colliderIndexB = t.colliderIndexB;
+			e.type = t.type;
+			triggerOverlaps.push_back(e);
+		}
+
+		//joints are matched by ID like bodies, so ones that still exist keep their pointers
+		std::vector<Joint*>& restoredJoints = snapshotJoints;
+		restoredJoints.clear();
+		restoredJoints.reserve(header.jointCount);
+		snapshotClaimed.assign(joints.size(), false);
+		for (unsigned int i = 0; i < header.jointCount && valid; i++)
+		{
+			SnapshotJoint j;
+			if (!Read(snapshot, size, offset, j) || size - offset < sizeof(Joint) || j.bodyA >= bodies.size() || (j.bodyB >= bodies.size() && j.bodyB != UINT_MAX))
+			{
+				valid = false;
+				break;
+			}
+
+			size_t index = joints.size();
+			if (i < joints.size() && joints[i]->id == j.id)
+				index = i;
+			else
+			{
+				for (size_t k = 0; k < joints.size(); k++)
+				{
+					if (joints[k]->id == j.id)
+						index = k;
+				}
+			}
+
+			Joint* joint;
+			void* pointer = nullptr;
+			if (index < joints.size() && !snapshotClaimed[index])
+			{
+				joint = joints[index];
+				pointer = joint->pointer;
+				snapshotClaimed[index] = true;
+			}
+			else
+				joint = (Joint*)jointPool.Allocate();
+
+			memcpy(joint, snapshot + offset, sizeof(Joint));
+			offset += sizeof(Joint);
+			joint->pointer = pointer;
+			joint->a = bodies[j.bodyA];
+			joint->b = j.bodyB == UINT_MAX ? nullptr : bodies[j.bodyB];
+			restoredJoints.push_back(joint);
+		}
+
+		//joints that weren't in the snapshot are deleted (if it's broken, the ones that were restored are cleared below)
+		for (size_t i = 0; i < joints.size(); i++)
+		{
+			if (!snapshotClaimed[i])
+				DestroyJoint(joints[i]);
+		}
+		joints.swap(restoredJoints);
+		nextJointID = header.nextJointID;
+		jointFilter.clear();
+		for (auto* joint : joints)
+			AddJointFilter(joint);
+
+		if (!valid)
+		{
+			//a broken snapshot leaves the world empty rather than half restored
+			ClearPhysicsBodies();
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,369 @@
+#include "fzx.h"
+#include "StateEncoder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace fzx
+{
+	//values are written least significant bit first, into bytes that are filled from the bottom
+	struct BitWriter
+	{
+		std::vector<unsigned char>& data;
+		unsigned long long bits = 0;
+		int bitCount = 0;
+
+		BitWriter(std::vector<unsigned char>& data) : data(data) {}
+
+		//count can be up to 32
+		void Write(unsigned int value, int count)
+		{
+			bits |= (unsigned long long)value << bitCount;
+			bitCount += count;
+			while (bitCount >= 8)
+			{
+				data.push_back((unsigned char)bits);
+				bits >>= 8;
+				bitCount -= 8;
+			}
+		}
+
+		//small numbers are much more common than big ones, so numbers get a 2 bit prefix saying how many bits they need
+		void WriteValue(unsigned int value)
+		{
+			if (value == 0)
+				Write(0, 2);
+			else if (value < (1u << 7))
+				Write(1 | value << 2, 9);
+			else if (value < (1u << 15))
+				Write(2 | value << 2, 17);
+			else
+			{
+				Write(3, 2);
+				Write(value, 32);
+			}
+		}
+
+		void Flush()
+		{
+			if (bitCount > 0)
+				data.push_back((unsigned char)bits);
+			bits = 0;
+			bitCount = 0;
+		}
+	};
+
+	struct BitReader
+	{
+		const unsigned char* data;
+		size_t size;
+		size_t byte = 0;
+		unsigned long long bits = 0;
+		int bitCount = 0;
+		//set when something tries to read past the end, after which everything reads as 0
+		bool overrun = false;
+
+		BitReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+
+		unsigned int Read(int count)
+		{
+			while (bitCount < count)
+			{
+				if (byte >= size)
+				{
+					overrun = true;
+					return 0;
+				}
+				bits |= (unsigned long long)data[byte++] << bitCount;
+				bitCount += 8;
+			}
+			unsigned int value = (unsigned int)(bits & ((1ull << count) - 1));
+			bits >>= count;
+			bitCount -= count;
+			return value;
+		}
+
+		unsigned int ReadValue()
+		{
+			switch (Read(2))
+			{
+			case 0:
+				return 0;
+			case 1:
+				return Read(7);
+			case 2:
+				return Read(15);
+			default:
+				return Read(32);
+			}
+		}
+
+		inline size_t BitsLeft() { return (size - byte) * 8 + bitCount; }
+	};
+
+	//turns small negative numbers into small positive ones, so they pack well too (0, -1, 1, -2 ... -> 0, 1, 2, 3 ...)
+	static inline unsigned int ZigZag(int value)
+	{
+		return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+	}
+
+	static inline int UnZigZag(unsigned int value)
+	{
+		return (int)((value >> 1) ^ (0u - (value & 1)));
+	}
+
+	static int Quantise(Real value, Real step)
+	{
+		//clamped well inside the range of an int, values this far out have lost all their precision anyway
+		const Real limit = (Real)(1 << 30);
+		Real q = std::round(value / step);
+		if (!(q > -limit))
+			q = -limit;
+		else if (q > limit)
+			q = limit;
+		return (int)q;
+	}
+
+	static bool BodyIDLess(PhysicsObject* a, PhysicsObject* b)
+	{
+		return a->GetID() < b->GetID();
+	}
+
+	static void SortBodies(std::vector<PhysicsObject*>& bodies)
+	{
+		//bodies are nearly always in id order already
+		if (!std::is_sorted(bodies.begin(), bodies.end(), BodyIDLess))
+			std::sort(bodies.begin(), bodies.end(), BodyIDLess);
+	}
+
+	void StateEncoder::Encode(PhysicsSystem& system, unsigned int frame, std::vector<unsigned char>& data)
+	{
+		Encode(system.bodies.data(), system.bodies.size(), frame, data);
+	}
+
+	void StateEncoder::Encode(PhysicsObject* const* bodies, size_t count, unsigned int frame, std::vector<unsigned char>& data)
+	{
+		sortedBodies.assign(bodies, bodies + count);
+		SortBodies(sortedBodies);
+
+		//the baseline has to be recent enough to still be remembered, and not in the slot this frame is about to take
+		const StateFrame* baseline = nullptr;
+		if (hasAck && frame != ackedFrame && frame - ackedFrame < FZX_STATE_HISTORY)
+		{
+			const StateFrame& acked = frames[ackedFrame % FZX_STATE_HISTORY];
+			if (acked.valid && acked.frame == ackedFrame)
+				baseline = &acked;
+		}
+
+		StateFrame& current = frames[frame % FZX_STATE_HISTORY];
+		current.frame = frame;
+		current.valid = true;
+		current.states.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			PhysicsObject* body = sortedBodies[i];
+			QuantisedState& state = current.states[i];
+			state.id = body->GetID();
+			state.values[0] = Quantise(body->GetPosition().x, precision.position);
+			state.values[1] = Quantise(body->GetPosition().y, precision.position);
+			state.values[2] = Quantise(body->GetRotation(), precision.rotation);
+			state.values[3] = Quantise(body->GetVelocity().x, precision.velocity);
+			state.values[4] = Quantise(body->GetVelocity().y, precision.velocity);
+			state.values[5] = Quantise(body->GetAngularVelocity(), precision.angularVelocity);
+		}
+
+		data.clear();
+		BitWriter writer(data);
+		writer.Write(frame, 32);
+		writer.Write(baseline ? 1 : 0, 1);
+		if (baseline)
+			writer.WriteValue(frame - baseline->frame);
+		writer.WriteValue((unsigned int)count);
+
+		//ids are only sent when the set of bodies has changed since the baseline
+		bool sameIDs = baseline && baseline->states.size() == count;
+		for (size_t i = 0; sameIDs && i < count; i++)
+			sameIDs = baseline->states[i].id == current.states[i].id;
+		writer.Write(sameIDs ? 1 : 0, 1);
+		if (!sameIDs)
+		{
+			unsigned int previous = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				//ids are sorted and unique, so after the first the gap is at least 1
+				unsigned int id = current.states[i].id;
+				writer.WriteValue(id - previous - (i > 0 ? 1 : 0));
+				previous = id;
+			}
+		}
+
+		static const QuantisedState zero = {};
+		size_t b = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const QuantisedState& state = current.states[i];
+			const QuantisedState* base = &zero;
+			if (baseline)
+			{
+				//both lists are sorted by id, so the matching baseline body is found by walking along with this one
+				while (b < baseline->states.size() && baseline->states[b].id < state.id)
+					b++;
+				if (b < baseline->states.size() && baseline->states[b].id == state.id)
+					base = &baseline->states[b];
+
+				//unchanged bodies are a single 0 bit
+				bool changed = memcmp(state.values, base->values, sizeof(state.values)) != 0;
+				writer.Write(changed ? 1 : 0, 1);
+				if (!changed)
+					continue;
+			}
+
+			for (int v = 0; v < 6; v++)
+				writer.WriteValue(ZigZag((int)((unsigned int)state.values[v] - (unsigned int)base->values[v])));
+		}
+		writer.Flush();
+	}
+
+	void StateEncoder::Acknowledge(unsigned int frame)
+	{
+		//acks can arrive out of order, and only the newest one matters
+		if (!hasAck || (int)(frame - ackedFrame) > 0)
+		{
+			ackedFrame = frame;
+			hasAck = true;
+		}
+	}
+
+	void StateEncoder::Reset()
+	{
+		for (StateFrame& frame : frames)
+			frame.valid = false;
+		hasAck = false;
+	}
+
+	bool StateDecoder::Decode(const unsigned char* data, size_t size)
+	{
+		BitReader reader(data, size);
+		unsigned int frame = reader.Read(32);
+		if (reader.overrun || (hasFrame && (int)(frame - lastFrame) <= 0))
+			return false;
+
+		const StateFrame* baseline = nullptr;
+		if (reader.Read(1))
+		{
+			unsigned int gap = reader.ReadValue();
+			if (gap == 0 || gap >= FZX_STATE_HISTORY)
+				return false;
+			const StateFrame& base = frames[(frame - gap) % FZX_STATE_HISTORY];
+			if (!base.valid || base.frame != frame - gap)
+				return false;
+			baseline = &base;
+		}
+
+		//every body takes at least a bit, so this stops broken data from asking for a huge allocation
+		unsigned int count = reader.ReadValue();
+		if (reader.overrun || count > reader.BitsLeft())
+			return false;
+
+		StateFrame& current = frames[frame % FZX_STATE_HISTORY];
+		current.valid = false;
+		current.frame = frame;
+		current.states.resize(count);
+
+		if (reader.Read(1))
+		{
+			if (!baseline || baseline->states.size() != count)
+				return false;
+			for (size_t i = 0; i < count; i++)
+				current.states[i].id = baseline->states[i].id;
+		}
+		else
+		{
+			unsigned int previous = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				previous += reader.ReadValue() + (i > 0 ? 1 : 0);
+				current.states[i].id = previous;
+			}
+		}
+
+		static const QuantisedState zero = {};
+		size_t b = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			QuantisedState& state = current.states[i];
+			const QuantisedState* base = &zero;
+			if (baseline)
+			{
+				while (b < baseline->states.size() && baseline->states[b].id < state.id)
+					b++;
+				if (b < baseline->states.size() && baseline->states[b].id == state.id)
+					base = &baseline->states[b];
+
+				if (!reader.Read(1))
+				{
+					memcpy(state.values, base->values, sizeof(state.values));
+					continue;
+				}
+			}
+
+			for (int v = 0; v < 6; v++)
+				state.values[v] = (int)((unsigned int)base->values[v] + (unsigned int)UnZigZag(reader.ReadValue()));
+		}
+		if (reader.overrun)
+			return false;
+
+		current.valid = true;
+		lastFrame = frame;
+		hasFrame = true;
+
+		states.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			const QuantisedState& q = current.states[i];
+			BodyState& state = states[i];
+			state.id = q.id;
+			state.position = Vector2(q.values[0] * precision.position, q.values[1] * precision.position);
+			state.rotation = q.values[2] * precision.rotation;
+			state.velocity = Vector2(q.values[3] * precision.velocity, q.values[4] * precision.velocity);
+			state.angularVelocity = q.values[5] * precision.angularVelocity;
+		}
+		return true;
+	}
+
+	void StateDecoder::Apply(PhysicsSystem& system)
+	{
+		sortedBodies.assign(system.bodies.begin(), system.bodies.end());
+		SortBodies(sortedBodies);
+
+		size_t s = 0;
+		for (PhysicsObject* body : sortedBodies)
+		{
+			while (s < states.size() && states[s].id < body->GetID())
+				s++;
+			if (s == states.size())
+				break;
+			if (states[s].id != body->GetID())
+				continue;
+
+			const BodyState& state = states[s];
+			body->SetPosition(state.position);
+			body->SetRotation(state.rotation);
+			body->GetTransform().UpdateData();
+			body->SetVelocity(state.velocity);
+			body->SetAngularVelocity(state.angularVelocity);
+			body->GenerateAABB();
+		}
+
+		//same as the end of Update(), so queries see the new positions
+		if (!system.broadphaseDirty)
+			system.broadphase.Refit();
+	}
+
+	void StateDecoder::Reset()
+	{
+		for (StateFrame& frame : frames)
+			frame.valid = false;
+		hasFrame = false;
+		states.clear();
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "fzx.h"
+
+//how many recent frames the encoder and decoder remember. frames can only be delta encoded against an acknowledged frame this recent
+#ifndef FZX_STATE_HISTORY
+#define FZX_STATE_HISTORY 32
+#endif
+
+namespace fzx
+{
+	//step sizes values are rounded to before they are sent. the encoder and decoder must use the same ones
+	struct StatePrecision
+	{
+		Real position = (Real)1 / 512;
+		//radians
+		Real rotation = (Real)1 / 1024;
+		Real velocity = (Real)1 / 256;
+		Real angularVelocity = (Real)1 / 256;
+	};
+
+	//a body's state after being decoded (so rounded to the precision)
+	struct BodyState
+	{
+		unsigned int id;
+		Vector2 position;
+		Real rotation;
+		Vector2 velocity;
+		Real angularVelocity;
+	};
+
+	//a body's transform and velocities rounded to whole steps of the precision
+	struct QuantisedState
+	{
+		unsigned int id;
+		//position x, position y, rotation, velocity x, velocity y, angular velocity
+		int values[6];
+	};
+
+	//one remembered frame, with its bodies sorted by id
+	struct StateFrame
+	{
+		unsigned int frame = 0;
+		bool valid = false;
+		std::vector<QuantisedState> states;
+	};
+
+	//compresses body transforms and velocities for sending to clients or writing to replays
+	//values are quantised, then each frame is sent as a delta against the newest frame the receiver has acknowledged,
+	//so bodies that haven't changed (like sleeping or static ones) cost a single bit. everything is bit packed
+	//
+	//frame numbers must go up (they don't have to be consecutive). it only carries transforms and velocities, so bodies have to be
+	//created and destroyed on the other side some other way (bodies are matched by id)
+	class StateEncoder
+	{
+	public:
+		StateEncoder(StatePrecision precision = StatePrecision()) : precision(precision) {}
+
+		//writes every body in the system to data (overwriting it)
+		void Encode(PhysicsSystem& system, unsigned int frame, std::vector<unsigned char>& data);
+		//same as above for a list of bodies, which doesn't have to be sorted
+		void Encode(PhysicsObject* const* bodies, size_t count, unsigned int frame, std::vector<unsigned char>& data);
+
+		//the receiver has decoded this frame, so later frames can be sent as deltas against it
+		void Acknowledge(unsigned int frame);
+		//forgets every frame, so the next one is sent in full
+		void Reset();
+
+		inline const StatePrecision& GetPrecision() { return precision; }
+
+	private:
+		StatePrecision precision;
+		StateFrame frames[FZX_STATE_HISTORY];
+		std::vector<PhysicsObject*> sortedBodies;
+		unsigned int ackedFrame = 0;
+		bool hasAck = false;
+	};
+
+	class StateDecoder
+	{
+	public:
+		StateDecoder(StatePrecision precision = StatePrecision()) : precision(precision) {}
+
+		//returns false if the data is broken, or if it's relative to a frame this decoder doesn't have (in which case the encoder
+		//should be Reset). frames older than the last decoded one are ignored and also return false
+		bool Decode(const unsigned char* data, size_t size);
+		//writes the last decoded frame into the system's bodies, matched by id. bodies the frame doesn't have are left alone
+		void Apply(PhysicsSystem& system);
+
+		//the last frame decoded, to send back as an acknowledgement
+		inline unsigned int GetFrame() { return lastFrame; }
+		inline const std::vector<BodyState>& GetStates() { return states; }
+
+		void Reset();
+
+	private:
+		StatePrecision precision;
+		StateFrame frames[FZX_STATE_HISTORY];
+		std::vector<BodyState> states;
+		std::vector<PhysicsObject*> sortedBodies;
+		unsigned int lastFrame = 0;
+		bool hasFrame = false;
+	};
+}
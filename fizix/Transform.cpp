@@ -1,14 +1,13 @@
 #include "fzx.h"
 namespace fzx
 {
-	Transform::Transform(Vector2 position, float rotation) : position(position), rotation(rotation)
+	Transform::Transform(Vector2 position, Real rotation) : position(position), rotation(rotation)
 	{
 		UpdateData();
 	}
 
 	void Transform::UpdateData() { //updates once per frame
-		s = sin(rotation);
-		c = cos(rotation);
+		em::SinCos(rotation, s, c);
 	}
 
 	Vector2 Transform::TransformPoint(Vector2 point)
@@ -37,6 +36,17 @@ namespace fzx
 		return Vector2(direction.x * c + direction.y * s, direction.y * c - direction.x * s);
 	}
 
+	Transform Transform::Combine(const Transform& local)
+	{
+		Transform combined;
+		combined.position = TransformPoint(local.position);
+		combined.rotation = rotation + local.rotation;
+		//angle addition, so sin and cos don't have to be calculated again
+		combined.s = s * local.c + c * local.s;
+		combined.c = c * local.c - s * local.s;
+		return combined;
+	}
+
 	Matrix3x3 Transform::GetTransformationMatrix()
 	{
 		return Matrix3x3(
@@ -7,7 +7,7 @@ namespace fzx
 	{
 	public:
 		Vector2 position;
-		float rotation;
+		Real rotation;
 
 		void UpdateData();
 		Vector2 TransformPoint(Vector2 point);
@@ -15,14 +15,17 @@ namespace fzx
 		Vector2 TransformDirection(Vector2 direction);
 		Vector2 InverseTransformDirection(Vector2 direction);
 
+		//puts a transform that is relative to this one into the same space as this one (used for collider offsets)
+		Transform Combine(const Transform& local);
+
 		Matrix3x3 GetTransformationMatrix();
 		Matrix4x4 Get3DTransformationMatrix();
 		Transform() = default;
-		Transform(Vector2 position, float rotation);
+		Transform(Vector2 position, Real rotation);
 
 	private:
 		//so that sine and cosine calculations only have to happen once per frame
-		float s;
-		float c;
+		Real s;
+		Real c;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "WorkerPool.h"
+
+namespace fzx
+{
+	WorkerPool::~WorkerPool()
+	{
+		StopWorkers();
+	}
+
+	void WorkerPool::SetThreadCount(unsigned int count)
+	{
+		if (count < 1)
+			count = 1;
+		if (count == GetThreadCount())
+			return;
+
+		StopWorkers();
+		stopping = false;
+		workers.reserve(count - 1);
+		for (unsigned int i = 1; i < count; i++)
+			workers.emplace_back(&WorkerPool::WorkerLoop, this, i, generation);
+	}
+
+	void WorkerPool::StopWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		startCondition.notify_all();
+		for (auto& worker : workers)
+			worker.join();
+		workers.clear();
+	}
+
+	void WorkerPool::Run(size_t count, WorkerJob newJob, void* infoPtr)
+	{
+		//not worth waking the workers for one job
+		if (workers.empty() || count < 2)
+		{
+			for (size_t i = 0; i < count; i++)
+				newJob(i, 0, infoPtr);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = newJob;
+			jobPtr = infoPtr;
+			jobCount = count;
+			nextJob = 0;
+			busyWorkers = (unsigned int)workers.size();
+			generation++;
+		}
+		startCondition.notify_all();
+
+		//this thread works too instead of just waiting
+		RunJobs(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+	}
+
+	void WorkerPool::RunJobs(unsigned int thread)
+	{
+		for (size_t i = nextJob++; i < jobCount; i = nextJob++)
+			job(i, thread, jobPtr);
+	}
+
+	void WorkerPool::WorkerLoop(unsigned int thread, unsigned int lastGeneration)
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				startCondition.wait(lock, [&] { return stopping || generation != lastGeneration; });
+				if (stopping)
+					return;
+				lastGeneration = generation;
+			}
+
+			RunJobs(thread);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				busyWorkers--;
+			}
+			doneCondition.notify_one();
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fzx
+{
+	//index is the job's number, thread is which thread is running it (0 is the one that called Run), so jobs can keep scratch memory per thread
+	typedef void (*WorkerJob)(size_t index, unsigned int thread, void* infoPtr);
+
+	//a few threads that are kept around between steps, so handing out work doesn't start new threads every time
+	class WorkerPool
+	{
+	public:
+		WorkerPool() = default;
+		~WorkerPool();
+		WorkerPool(const WorkerPool& other) = delete;
+		WorkerPool& operator=(const WorkerPool& other) = delete;
+
+		//count includes the calling thread, so 1 runs everything on it without any extra threads
+		void SetThreadCount(unsigned int count);
+		inline unsigned int GetThreadCount() { return (unsigned int)workers.size() + 1; }
+
+		//calls job for every index below count, spread over the threads, and returns once they have all finished
+		void Run(size_t count, WorkerJob job, void* infoPtr);
+
+	private:
+		//lastGeneration is the generation when the worker was made, so it doesn't run a batch that has already finished
+		void WorkerLoop(unsigned int thread, unsigned int lastGeneration);
+		void RunJobs(unsigned int thread);
+		void StopWorkers();
+
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable startCondition;
+		std::condition_variable doneCondition;
+
+		WorkerJob job = nullptr;
+		void* jobPtr = nullptr;
+		size_t jobCount = 0;
+		std::atomic<size_t> nextJob{ 0 };
+		//bumped every Run, so workers can tell a new batch of jobs from a spurious wake up
+		unsigned int generation = 0;
+		unsigned int busyWorkers = 0;
+		bool stopping = false;
+	};
+}
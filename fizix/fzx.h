@@ -6,11 +6,17 @@
 
 #include "Maths.h"
 #include "ExtraMath.hpp"
+#include "Pool.h"
 #include "Shape.h"
 #include "Collider.h"
 #include "Collision.h"
 #include "Transform.h"
 #include "PhysicsObject.h"
+#include "Joint.h"
+#include "Broadphase.h"
+#include "WorkerPool.h"
 #include "PhysicsSystem.h"
+#include "Scene.h"
+#include "StateEncoder.h"
 
 #endif
\ No newline at end of file